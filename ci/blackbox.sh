@@ -19,7 +19,7 @@ ROOT_DIR=$SCRIPT_DIR/..
 show_usage()
 {
     echo "Vortex BlackBox Test Driver v1.0"
-    echo "Usage: $0 [[--clusters=#n] [--cores=#n] [--warps=#n] [--threads=#n] [--l2cache] [--l3cache] [[--driver=#name] [--app=#app] [--args=#args] [--debug=#level] [--scope] [--perf=#class] [--rebuild=#n] [--log=logfile] [--help]]"
+    echo "Usage: $0 [[--clusters=#n] [--cores=#n] [--warps=#n] [--threads=#n] [--l2cache] [--l3cache] [[--driver=#name] [--app=#app] [--args=#args] [--debug=#level] [--scope] [--perf=#class] [--perf-format=#format] [--rebuild=#n] [--log=logfile] [--help]]"
 }
 
 show_help()
@@ -28,7 +28,8 @@ show_help()
     echo "  where"
     echo "--driver: gpu, simx, rtlsim, oape, xrt"
     echo "--app: any subfolder test under regression or opencl"
-    echo "--class: 0=disable, 1=pipeline, 2=memsys"
+    echo "--class: 0=disable, 1=pipeline, 2=memsys, 3=all"
+    echo "--perf-format: text, json, csv"
     echo "--rebuild: 0=disable, 1=force, 2=auto, 3=temp"
 }
 
@@ -48,6 +49,7 @@ DEFAULTS() {
     SCOPE=0
     HAS_ARGS=0
     PERF_CLASS=0
+    PERF_FORMAT=text
     CONFIGS="$CONFIGS"
     REBUILD=2
     TEMPBUILD=0
@@ -67,6 +69,7 @@ parse_args() {
             --l2cache)  CONFIGS=$(add_option "$CONFIGS" "-DL2_ENABLE") ;;
             --l3cache)  CONFIGS=$(add_option "$CONFIGS" "-DL3_ENABLE") ;;
             --perf=*)   CONFIGS=$(add_option "$CONFIGS" "-DPERF_ENABLE"); PERF_CLASS=${i#*=} ;;
+            --perf-format=*) PERF_FORMAT=${i#*=} ;;
             --debug=*)  DEBUG=1; DEBUG_LEVEL=${i#*=} ;;
             --scope)    SCOPE=1; ;;
             --args=*)   HAS_ARGS=1; ARGS=${i#*=} ;;
@@ -172,6 +175,7 @@ main() {
     fi
 
     export VORTEX_PROFILING=$PERF_CLASS
+    export VORTEX_PERF_FORMAT=$PERF_FORMAT
 
     make -C "$ROOT_DIR/hw" config > /dev/null
     make -C "$ROOT_DIR/runtime/stub" > /dev/null
@@ -264,7 +264,15 @@
 `ifndef IO_MPM_ADDR
 `define IO_MPM_ADDR     (`IO_COUT_ADDR + `IO_COUT_SIZE)
 `endif
-`define IO_MPM_SIZE     (8 * 32 * `NUM_CORES * `NUM_CLUSTERS)
+// each core dumps IO_MPM_BANKS banks of 32 64-bit counters below USER_BASE_ADDR,
+// which fits 127 cores with the core and memory banks. the prefetcher bank is
+// only reserved with MPM_PREFETCH_ENABLE and lowers the limit to 85 cores.
+`ifdef MPM_PREFETCH_ENABLE
+`define IO_MPM_BANKS    3
+`else
+`define IO_MPM_BANKS    2
+`endif
+`define IO_MPM_SIZE     (8 * 32 * `IO_MPM_BANKS * `NUM_CORES * `NUM_CLUSTERS)
 
 `ifndef STACK_LOG2_SIZE
 `define STACK_LOG2_SIZE 13
@@ -35,6 +35,13 @@
 `define VX_DCR_MPM_CLASS_NONE           0
 `define VX_DCR_MPM_CLASS_CORE           1
 `define VX_DCR_MPM_CLASS_MEM            2
+`define VX_DCR_MPM_CLASS_ALL            3   // core and memory, banked
+
+// Machine Performance-monitoring counters banks, selected with VX_CSR_MPM_BANK
+
+`define VX_MPM_BANK_CORE                0   // core class under MPM_CLASS_ALL
+`define VX_MPM_BANK_MEM                 1   // memory class under MPM_CLASS_ALL
+`define VX_MPM_BANK_PREFETCH            2   // prefetcher page of the memory class
 
 // User Floating-Point CSRs ///////////////////////////////////////////////////
 
@@ -64,6 +71,7 @@
 `define VX_CSR_MPM_BASE_H               12'hB80
 `define VX_CSR_MPM_USER                 12'hB03
 `define VX_CSR_MPM_USER_H               12'hB83
+`define VX_CSR_MPM_BANK                 12'hBC0     // VX_MPM_BANK_XXX mapped to hB03..hB1F
 
 // Machine Performance-monitoring core counters (Standard) ////////////////////
 
@@ -179,7 +187,29 @@
 `define VX_CSR_MPM_COALESCER_MISS       12'hB1F     // coalescer misses
 `define VX_CSR_MPM_COALESCER_MISS_H     12'hB9F
 
-// Machine Performance-monitoring memory counters (class 3) ///////////////////
+// Machine Performance-monitoring prefetcher counters (bank 4) ////////////////
+// <selected with VX_CSR_MPM_BANK under MPM_CLASS_MEM or MPM_CLASS_ALL>
+
+// PERF: dcache prefetcher
+`define VX_CSR_MPM_DCACHE_PF_ISSUED     12'hB03     // prefetches issued
+`define VX_CSR_MPM_DCACHE_PF_ISSUED_H   12'hB83
+`define VX_CSR_MPM_DCACHE_PF_USEFUL     12'hB04     // prefetched lines hit by a demand access
+`define VX_CSR_MPM_DCACHE_PF_USEFUL_H   12'hB84
+`define VX_CSR_MPM_DCACHE_PF_LATE       12'hB05     // demand misses waiting on a prefetch
+`define VX_CSR_MPM_DCACHE_PF_LATE_H     12'hB85
+`define VX_CSR_MPM_DCACHE_PF_POLLUTE    12'hB06     // prefetched lines evicted unused
+`define VX_CSR_MPM_DCACHE_PF_POLLUTE_H  12'hB86
+// PERF: l2cache prefetcher
+`define VX_CSR_MPM_L2CACHE_PF_ISSUED    12'hB07     // prefetches issued
+`define VX_CSR_MPM_L2CACHE_PF_ISSUED_H  12'hB87
+`define VX_CSR_MPM_L2CACHE_PF_USEFUL    12'hB08     // prefetched lines hit by a demand access
+`define VX_CSR_MPM_L2CACHE_PF_USEFUL_H  12'hB88
+`define VX_CSR_MPM_L2CACHE_PF_LATE      12'hB09     // demand misses waiting on a prefetch
+`define VX_CSR_MPM_L2CACHE_PF_LATE_H    12'hB89
+`define VX_CSR_MPM_L2CACHE_PF_POLLUTE   12'hB0A     // prefetched lines evicted unused
+`define VX_CSR_MPM_L2CACHE_PF_POLLUTE_H 12'hB8A
+
+// Machine Performance-monitoring memory counters (class 4) ///////////////////
 // <Add your own counters: use addresses hB03..B1F, hB83..hB9F>
 
 // Machine Information Registers //////////////////////////////////////////////
@@ -44,6 +44,9 @@ module Vortex import VX_gpu_pkg::*; (
     output wire                             busy
 );
 
+    // the per-core counter dump must stay within the IO region
+    `STATIC_ASSERT(((`IO_MPM_ADDR + `IO_MPM_SIZE) <= `IO_END_ADDR), ("invalid parameter: IO_MPM region overruns USER_BASE_ADDR"))
+
 `ifdef SCOPE
     localparam scope_cluster = 0;
     `SCOPE_IO_SWITCH (`NUM_CLUSTERS);
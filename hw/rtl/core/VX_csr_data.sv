@@ -76,6 +76,7 @@ import VX_fpu_pkg::*;
     // CSRs Write /////////////////////////////////////////////////////////////
 
     reg [`XLEN-1:0] mscratch;
+    reg [7:0] mpm_bank;
 
 `ifdef EXT_F_ENABLE
     reg [`NUM_WARPS-1:0][`INST_FRM_BITS+`FP_FLAGS_BITS-1:0] fcsr, fcsr_n;
@@ -123,6 +124,7 @@ import VX_fpu_pkg::*;
     always @(posedge clk) begin
         if (reset) begin
             mscratch <= base_dcrs.startup_arg;
+            mpm_bank <= `VX_MPM_BANK_CORE;
         end
         if (write_enable) begin
             case (write_addr)
@@ -146,6 +148,9 @@ import VX_fpu_pkg::*;
                 `VX_CSR_MSCRATCH: begin
                     mscratch <= write_data;
                 end
+                `VX_CSR_MPM_BANK: begin
+                    mpm_bank <= write_data[7:0];
+                end
                 default: begin
                     `ASSERT(0, ("%t: *** %s invalid CSR write address: %0h (#%0d)", $time, INSTANCE_ID, write_addr, write_uuid));
                 end
@@ -174,6 +179,7 @@ import VX_fpu_pkg::*;
             `VX_CSR_FCSR       : read_data_rw_w = `XLEN'(fcsr[read_wid]);
         `endif
             `VX_CSR_MSCRATCH   : read_data_rw_w = mscratch;
+            `VX_CSR_MPM_BANK   : read_data_rw_w = `XLEN'(mpm_bank);
 
             `VX_CSR_WARP_ID    : read_data_ro_w = `XLEN'(read_wid);
             `VX_CSR_CORE_ID    : read_data_ro_w = `XLEN'(CORE_ID);
@@ -208,7 +214,13 @@ import VX_fpu_pkg::*;
                  || (read_addr >= `VX_CSR_MPM_USER_H && read_addr < (`VX_CSR_MPM_USER_H + 32))) begin
                     read_addr_valid_w = 1;
                 `ifdef PERF_ENABLE
-                    case (base_dcrs.mpm_class)
+                    // under MPM_CLASS_ALL, the bank register selects the visible class.
+                    // there is no hardware prefetcher, its memory class page reads zero.
+                    case ((mpm_bank == `VX_MPM_BANK_PREFETCH
+                        && (base_dcrs.mpm_class == `VX_DCR_MPM_CLASS_MEM || base_dcrs.mpm_class == `VX_DCR_MPM_CLASS_ALL)) ? `VX_DCR_MPM_CLASS_NONE :
+                          (base_dcrs.mpm_class != `VX_DCR_MPM_CLASS_ALL) ? base_dcrs.mpm_class :
+                          (mpm_bank == `VX_MPM_BANK_CORE) ? `VX_DCR_MPM_CLASS_CORE :
+                          (mpm_bank == `VX_MPM_BANK_MEM) ? `VX_DCR_MPM_CLASS_MEM : `VX_DCR_MPM_CLASS_NONE)
                     `VX_DCR_MPM_CLASS_CORE: begin
                         case (read_addr)
                         // PERF: pipeline
@@ -17,6 +17,10 @@
 #include <vx_intrinsics.h>
 #include <stdint.h>
 
+#if (IO_MPM_ADDR + IO_MPM_SIZE) > IO_END_ADDR
+#error "IO_MPM region overruns USER_BASE_ADDR, reduce NUM_CORES * NUM_CLUSTERS"
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -30,9 +34,7 @@ extern "C" {
         csr_mem[(i*2)+1] = csr_read(VX_CSR_MPM_BASE + i + (VX_CSR_MPM_BASE_H - VX_CSR_MPM_BASE))
 #endif
 
-void vx_perf_dump() {
-    int core_id = vx_core_id();
-    uint32_t * const csr_mem = (uint32_t*)(IO_MPM_ADDR + 64 * sizeof(uint32_t) * core_id);
+static void dump_bank(uint32_t * const csr_mem) {
     DUMP_CSRS(0);
     //DUMP_CSRS(1); reserved for exitcode
     DUMP_CSRS(2);
@@ -67,6 +69,23 @@ void vx_perf_dump() {
     DUMP_CSRS(31);
 }
 
+void vx_perf_dump() {
+    int core_id = vx_core_id();
+    uint32_t * const csr_mem = (uint32_t*)(IO_MPM_ADDR + 64 * IO_MPM_BANKS * sizeof(uint32_t) * core_id);
+    // first bank: the active class, or the core counters under MPM_CLASS_ALL
+    csr_write(VX_CSR_MPM_BANK, VX_MPM_BANK_CORE);
+    dump_bank(csr_mem + 64 * VX_MPM_BANK_CORE);
+    // second bank: the memory counters under MPM_CLASS_ALL
+    csr_write(VX_CSR_MPM_BANK, VX_MPM_BANK_MEM);
+    dump_bank(csr_mem + 64 * VX_MPM_BANK_MEM);
+#if IO_MPM_BANKS > VX_MPM_BANK_PREFETCH
+    // third bank: the prefetcher counters under MPM_CLASS_MEM or MPM_CLASS_ALL
+    csr_write(VX_CSR_MPM_BANK, VX_MPM_BANK_PREFETCH);
+    dump_bank(csr_mem + 64 * VX_MPM_BANK_PREFETCH);
+#endif
+    csr_write(VX_CSR_MPM_BANK, VX_MPM_BANK_CORE);
+}
+
 #ifdef __cplusplus
 }
 #endif
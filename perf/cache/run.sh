@@ -25,14 +25,77 @@ CONFIGS="-DDCACHE_NUM_WAYS=8" ./ci/blackbox.sh --driver=rtlsim --app=sgemm --arg
 echo "cache tests done!"
 }
 
+# simx loads the cache geometry at startup, build once and sweep in parallel
+sgemm_simx()
+{
+echo "begin simx cache tests"
+
+./ci/blackbox.sh --driver=simx --app=sgemm --args="-n64" --perf=1 > /dev/null
+
+printf "%s\n" icache.ways=2 dcache.ways=2 icache.ways=4 dcache.ways=4 icache.ways=8 dcache.ways=8 > cache_points.cfg
+./perf/cache/sweep.sh -o cache_sweep cache_points.cfg make -s -C tests/opencl/sgemm run-simx OPTS="-n64"
+cp cache_sweep/summary.log cache_perf.log
+
+echo "simx cache tests done!"
+}
+
+# cache hit rates of each replacement policy on the regression apps
+policies()
+{
+echo "begin replacement policy tests"
+
+for p in lru plru srrip brrip fifo random; do
+    echo "icache.policy=$p,dcache.policy=$p,l2cache.policy=$p,l3cache.policy=$p"
+done > cache_points.cfg
+
+> cache_policy.log
+for app in sgemmx vecaddx sort stencil3d conv3x; do
+    ./ci/blackbox.sh --driver=simx --app=$app --perf=2 > /dev/null
+    VORTEX_PROFILING=2 ./perf/cache/sweep.sh -o cache_sweep_$app cache_points.cfg make -s -C tests/regression/$app run-simx
+    echo "## $app" >> cache_policy.log
+    grep -e '^==' -e 'hit ratio' cache_sweep_$app/summary.log >> cache_policy.log
+done
+
+echo "replacement policy tests done!"
+}
+
+# prefetcher counters and cycles of each dcache/l2cache prefetcher on the regression apps
+prefetchers()
+{
+echo "begin prefetcher tests"
+
+for p in none nextline stride stream; do
+    echo "dcache.prefetch=$p,l2cache.prefetch=$p"
+done > cache_points.cfg
+
+> cache_prefetch.log
+# the prefetcher counters bank is only dumped with MPM_PREFETCH_ENABLE
+export CONFIGS="-DMPM_PREFETCH_ENABLE"
+for app in sgemmx vecaddx sort stencil3d conv3x; do
+    ./ci/blackbox.sh --driver=simx --app=$app --perf=2 --rebuild=1 > /dev/null
+    VORTEX_PROFILING=2 ./perf/cache/sweep.sh -o cache_sweep_$app cache_points.cfg make -s -C tests/regression/$app run-simx
+    echo "## $app" >> cache_prefetch.log
+    grep -e '^==' -e 'prefetch' -e 'read misses' -e 'cycles=' cache_sweep_$app/summary.log >> cache_prefetch.log
+done
+unset CONFIGS
+
+echo "prefetcher tests done!"
+}
+
 usage()
 {
-    echo "usage: [-s] [-h|--help]"
+    echo "usage: [-s] [-x] [-p] [-f] [-h|--help]"
 }
 
 case $1 in
     -s ) sgemm
             ;;
+    -x ) sgemm_simx
+            ;;
+    -p ) policies
+            ;;
+    -f ) prefetchers
+            ;;
     -h | --help ) usage
                     ;;
     * ) sgemm
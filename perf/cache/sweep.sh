@@ -0,0 +1,63 @@
+#!/bin/bash
+
+# Run a command once per cache configuration, in parallel host processes.
+# Each non-empty line of the points file is a simx cache spec
+# (<cache>.<param>=<value>,...) exported as VORTEX_SIMX_CACHES,
+# e.g. "dcache.ways=2,l2cache.enabled=1,l2cache.size=256K".
+# Runtime applications pick it up directly; the standalone simulator
+# takes it as an option:
+#   sweep.sh points.cfg sh -c './simx -s --caches "$VORTEX_SIMX_CACHES" kernel.bin'
+
+usage()
+{
+    echo "usage: $0 [-j <jobs>] [-o <outdir>] <points-file> <command> [args...]"
+}
+
+JOBS=$(nproc)
+OUTDIR=cache_sweep
+
+while getopts "j:o:h" opt; do
+    case $opt in
+        j ) JOBS=$OPTARG ;;
+        o ) OUTDIR=$OPTARG ;;
+        h ) usage; exit 0 ;;
+        * ) usage; exit -1 ;;
+    esac
+done
+shift $((OPTIND - 1))
+
+if [ $# -lt 2 ]; then
+    usage
+    exit -1
+fi
+
+POINTS=$1
+shift
+
+mkdir -p $OUTDIR
+
+# runtime applications dump their counters with profiling on
+export VORTEX_PROFILING=${VORTEX_PROFILING:-1}
+
+n=0
+while IFS= read -r spec; do
+    spec=${spec%%#*}
+    spec=$(echo $spec)
+    [ -z "$spec" ] && continue
+    while [ $(jobs -rp | wc -l) -ge $JOBS ]; do
+        wait -n
+    done
+    echo "$spec" > $OUTDIR/point$n.spec
+    VORTEX_SIMX_CACHES="$spec" "$@" > $OUTDIR/point$n.log 2>&1 &
+    n=$((n + 1))
+done < $POINTS
+wait
+
+# collect the counters of each point in input order
+> $OUTDIR/summary.log
+for ((i = 0; i < n; ++i)); do
+    echo "== $(cat $OUTDIR/point$i.spec)" >> $OUTDIR/summary.log
+    grep 'PERF' $OUTDIR/point$i.log >> $OUTDIR/summary.log
+done
+
+echo "$n points done, see $OUTDIR/summary.log"
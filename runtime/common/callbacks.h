@@ -21,8 +21,11 @@ extern "C" {
 #endif
 
 typedef struct {
-  // open the device and connect to it
-  int (*dev_open) (vx_device_h* hdevice);
+  // return the number of devices this driver can open
+  int (*dev_count) (uint32_t* count);
+
+  // open the device at the given index and connect to it
+  int (*dev_open) (uint32_t index, vx_device_h* hdevice);
 
   // Close the device when all the operations are done
   int (*dev_close) (vx_device_h hdevice);
@@ -45,6 +48,12 @@ typedef struct {
   // return device memory address
   int (*mem_address) (vx_buffer_h hbuffer, uint64_t* address);
 
+  // map a pinned buffer into host memory
+  int (*mem_map) (vx_buffer_h hbuffer, void** host_ptr);
+
+  // release a host mapping
+  int (*mem_unmap) (vx_buffer_h hbuffer);
+
   // get device memory info
   int (*mem_info) (vx_device_h hdevice, uint64_t* mem_free, uint64_t* mem_used);
 
@@ -69,6 +78,39 @@ typedef struct {
   // query device performance counter
   int (*mpm_query) (vx_device_h hdevice, uint32_t addr, uint32_t core_id, uint64_t* value);
 
+  // read the raw performance counters of all cores, 32 per core and bank
+  int (*mpm_snapshot) (vx_device_h hdevice, uint64_t* counters);
+
+  // create a command queue
+  int (*queue_create) (vx_device_h hdevice, vx_queue_h* hqueue);
+
+  // release a command queue
+  int (*queue_destroy) (vx_queue_h hqueue);
+
+  // make a queue wait for an event
+  int (*queue_wait_event) (vx_queue_h hqueue, vx_event_h hevent);
+
+  // wait for all commands of a queue
+  int (*queue_finish) (vx_queue_h hqueue, uint64_t timeout);
+
+  // enqueue a copy from host to device memory
+  int (*enqueue_copy_to_dev) (vx_queue_h hqueue, vx_buffer_h hbuffer, const void* host_ptr, uint64_t dst_offset, uint64_t size, vx_event_h* hevent);
+
+  // enqueue a copy from device memory to host
+  int (*enqueue_copy_from_dev) (vx_queue_h hqueue, void* host_ptr, vx_buffer_h hbuffer, uint64_t src_offset, uint64_t size, vx_event_h* hevent);
+
+  // enqueue a kernel execution
+  int (*enqueue_start) (vx_queue_h hqueue, vx_buffer_h hkernel, vx_buffer_h harguments, vx_event_h* hevent);
+
+  // enqueue a device configuration register write
+  int (*enqueue_dcr_write) (vx_queue_h hqueue, uint32_t addr, uint32_t value, vx_event_h* hevent);
+
+  // wait for an event
+  int (*event_wait) (vx_event_h hevent, uint64_t timeout);
+
+  // release an event
+  int (*event_release) (vx_event_h hevent);
+
 } callbacks_t;
 
 int vx_dev_init(callbacks_t* callbacks);
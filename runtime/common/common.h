@@ -23,6 +23,9 @@
 #include <cstdint>
 #include <unordered_map>
 #include <array>
+#include <algorithm>
+#include <chrono>
+#include <time.h>
 
 #define CACHE_BLOCK_SIZE  64
 
@@ -75,4 +78,47 @@ inline uint64_t aligned_size(uint64_t size, uint64_t alignment) {
 inline bool is_aligned(uint64_t addr, uint64_t alignment) {
   assert(0 == (alignment & (alignment - 1)));
   return 0 == (addr & (alignment - 1));
-}
\ No newline at end of file
+}
+
+// Exponential backoff for device status polling.
+// The first polls are issued back-to-back so that short operations are seen
+// complete within microseconds, the interval then doubles up to max_delay
+// so that long waits do not burn the CPU.
+class PollBackoff {
+public:
+  // timeout in milliseconds, max_delay in nanoseconds
+  PollBackoff(uint64_t timeout, uint64_t max_delay = 1000000)
+    : deadline_(std::chrono::steady_clock::now()
+              + std::chrono::milliseconds(std::min<uint64_t>(timeout, VX_MAX_TIMEOUT)))
+    , delay_(0)
+    , max_delay_(max_delay)
+  {}
+
+  bool expired() const {
+    return std::chrono::steady_clock::now() >= deadline_;
+  }
+
+  // return the next wait interval in nanoseconds
+  uint64_t next() {
+    delay_ = delay_ ? std::min<uint64_t>(delay_ * 2, max_delay_) : 1000;
+    return delay_;
+  }
+
+  // restart from the shortest interval, e.g. when the device shows activity
+  void reset() {
+    delay_ = 0;
+  }
+
+  void sleep() {
+    auto delay = this->next();
+    struct timespec ts;
+    ts.tv_sec  = delay / 1000000000;
+    ts.tv_nsec = delay % 1000000000;
+    nanosleep(&ts, nullptr);
+  }
+
+private:
+  std::chrono::steady_clock::time_point deadline_;
+  uint64_t delay_;
+  uint64_t max_delay_;
+};
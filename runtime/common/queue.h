@@ -0,0 +1,144 @@
+// Copyright © 2019-2023
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Completion event of a queued command.
+// An event is shared by its queue and the host, and is released once both
+// have dropped their reference.
+class CommandEvent {
+public:
+  CommandEvent() : refs_(1), done_(false), status_(0) {}
+
+  void retain() {
+    ++refs_;
+  }
+
+  void release() {
+    if (0 == --refs_) {
+      delete this;
+    }
+  }
+
+  void signal(int status) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    status_ = status;
+    done_ = true;
+    cv_.notify_all();
+  }
+
+  // wait with milliseconds timeout, return the command status
+  int wait(uint64_t timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!cv_.wait_for(lock, std::chrono::milliseconds(timeout), [&]{ return done_; }))
+      return -1;
+    return status_;
+  }
+
+private:
+  std::atomic<uint32_t>   refs_;
+  std::mutex              mutex_;
+  std::condition_variable cv_;
+  bool                    done_;
+  int                     status_;
+};
+
+// In-order command queue.
+// Commands run on a worker thread in submission order, so the host thread
+// only blocks when it waits on an event.
+class CommandQueue {
+public:
+  typedef std::function<int()> command_t;
+
+  CommandQueue() : last_event_(nullptr), exit_(false) {
+    worker_ = std::thread([&]{ this->run(); });
+  }
+
+  ~CommandQueue() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      exit_ = true;
+      cv_.notify_one();
+    }
+    worker_.join();
+    if (last_event_) {
+      last_event_->release();
+    }
+  }
+
+  // submit a command, its event is returned retained when requested
+  void submit(const command_t& command, CommandEvent** event) {
+    auto _event = new CommandEvent();
+    if (event) {
+      _event->retain();
+      *event = _event;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (last_event_) {
+      last_event_->release();
+    }
+    _event->retain();
+    last_event_ = _event;
+    commands_.emplace_back(command, _event);
+    cv_.notify_one();
+  }
+
+  // wait for all submitted commands with milliseconds timeout
+  int finish(uint64_t timeout) {
+    CommandEvent* event;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      event = last_event_;
+      if (nullptr == event)
+        return 0;
+      event->retain();
+    }
+    int err = event->wait(timeout);
+    event->release();
+    return err;
+  }
+
+private:
+
+  void run() {
+    for (;;) {
+      std::pair<command_t, CommandEvent*> entry;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [&]{ return exit_ || !commands_.empty(); });
+        // pending commands are drained before exiting
+        if (commands_.empty())
+          break;
+        entry = std::move(commands_.front());
+        commands_.pop_front();
+      }
+      entry.second->signal(entry.first());
+      entry.second->release();
+    }
+  }
+
+  std::deque<std::pair<command_t, CommandEvent*>> commands_;
+  CommandEvent*           last_event_;
+  std::mutex              mutex_;
+  std::condition_variable cv_;
+  std::thread             worker_;
+  bool                    exit_;
+};
@@ -24,6 +24,62 @@ extern "C" {
 
 typedef void* vx_device_h;
 typedef void* vx_buffer_h;
+typedef void* vx_queue_h;
+typedef void* vx_event_h;
+
+// cache performance counters
+typedef struct {
+  uint64_t reads;
+  uint64_t writes;
+  uint64_t read_misses;
+  uint64_t write_misses;
+  uint64_t bank_stalls;
+  uint64_t mshr_stalls;
+  // prefetcher, dcache and l2cache only
+  uint64_t prefetches;
+  uint64_t prefetch_useful;
+  uint64_t prefetch_late;
+  uint64_t prefetch_polluting;
+} vx_mpm_cache_t;
+
+// per-core performance counters snapshot.
+// only the counters of the active VX_DCR_MPM_CLASS are populated (all of them
+// under VX_DCR_MPM_CLASS_ALL),
+// l3cache and memory counters are device-wide and reported by core 0.
+typedef struct {
+  uint64_t cycles;
+  uint64_t instrs;
+  // VX_DCR_MPM_CLASS_CORE
+  uint64_t sched_idles;
+  uint64_t sched_stalls;
+  uint64_t ibuffer_stalls;
+  uint64_t scrb_stalls;
+  uint64_t opds_stalls;
+  uint64_t scrb_alu;
+  uint64_t scrb_fpu;
+  uint64_t scrb_lsu;
+  uint64_t scrb_sfu;
+  uint64_t scrb_csrs;
+  uint64_t scrb_wctl;
+  uint64_t ifetches;
+  uint64_t loads;
+  uint64_t stores;
+  uint64_t ifetch_lat;
+  uint64_t load_lat;
+  // VX_DCR_MPM_CLASS_MEM
+  vx_mpm_cache_t icache;
+  vx_mpm_cache_t dcache;
+  vx_mpm_cache_t l2cache;
+  vx_mpm_cache_t l3cache;
+  uint64_t lmem_reads;
+  uint64_t lmem_writes;
+  uint64_t lmem_bank_stalls;
+  uint64_t coalescer_misses;
+  uint64_t mem_reads;
+  uint64_t mem_writes;
+  uint64_t mem_lat;
+  uint64_t mem_bank_stalls;
+} vx_mpm_core_t;
 
 // device caps ids
 #define VX_CAPS_VERSION             0x0
@@ -71,9 +127,16 @@ typedef void* vx_buffer_h;
 #define VX_MEM_READ_WRITE           0x3
 #define VX_MEM_PIN_MEMORY           0x4
 
-// open the device and connect to it
+// return the number of available devices
+int vx_dev_count(uint32_t* count);
+
+// open the first device and connect to it
 int vx_dev_open(vx_device_h* hdevice);
 
+// open the device at the given index and connect to it,
+// devices are independent and may be driven from separate threads
+int vx_dev_open_index(uint32_t index, vx_device_h* hdevice);
+
 // Close the device when all the operations are done
 int vx_dev_close(vx_device_h hdevice);
 
@@ -95,6 +158,14 @@ int vx_mem_access(vx_buffer_h hbuffer, uint64_t offset, uint64_t size, int flags
 // return device memory address
 int vx_mem_address(vx_buffer_h hbuffer, uint64_t* address);
 
+// map a buffer allocated with VX_MEM_PIN_MEMORY into host memory
+// the host pointer aliases device memory, so no copy is needed while mapped.
+// code written through it is only seen by the device after vx_mem_unmap
+int vx_mem_map(vx_buffer_h hbuffer, void** host_ptr);
+
+// release a host mapping before the device accesses the buffer again
+int vx_mem_unmap(vx_buffer_h hbuffer);
+
 // get device memory info
 int vx_mem_info(vx_device_h hdevice, uint64_t* mem_free, uint64_t* mem_used);
 
@@ -119,6 +190,43 @@ int vx_dcr_write(vx_device_h hdevice, uint32_t addr, uint32_t value);
 // query device performance counter
 int vx_mpm_query(vx_device_h hdevice, uint32_t addr, uint32_t core_id, uint64_t* value);
 
+// read all cores' performance counters at once,
+// buffer must hold VX_CAPS_NUM_CORES entries
+int vx_mpm_snapshot(vx_device_h hdevice, vx_mpm_core_t* buffer);
+
+/////////////////////////////// COMMAND QUEUES ////////////////////////////////
+
+// create a command queue, its commands execute in submission order
+int vx_queue_create(vx_device_h hdevice, vx_queue_h* hqueue);
+
+// release a command queue once its pending commands have completed
+int vx_queue_destroy(vx_queue_h hqueue);
+
+// make the next commands of a queue wait for an event of another queue
+int vx_queue_wait_event(vx_queue_h hqueue, vx_event_h hevent);
+
+// Wait for all commands of a queue with milliseconds timeout
+int vx_queue_finish(vx_queue_h hqueue, uint64_t timeout);
+
+// Enqueue a copy from host to device memory
+// the host buffer must stay valid until the command completes
+int vx_enqueue_copy_to_dev(vx_queue_h hqueue, vx_buffer_h hbuffer, const void* host_ptr, uint64_t dst_offset, uint64_t size, vx_event_h* hevent);
+
+// Enqueue a copy from device memory to host
+int vx_enqueue_copy_from_dev(vx_queue_h hqueue, void* host_ptr, vx_buffer_h hbuffer, uint64_t src_offset, uint64_t size, vx_event_h* hevent);
+
+// Enqueue a kernel execution, its event completes when the device is ready
+int vx_enqueue_start(vx_queue_h hqueue, vx_buffer_h hkernel, vx_buffer_h harguments, vx_event_h* hevent);
+
+// Enqueue a device configuration register write
+int vx_enqueue_dcr_write(vx_queue_h hqueue, uint32_t addr, uint32_t value, vx_event_h* hevent);
+
+// Wait for an event with milliseconds timeout, return its command status
+int vx_event_wait(vx_event_h hevent, uint64_t timeout);
+
+// release an event returned by an enqueue call
+int vx_event_release(vx_event_h hevent);
+
 ////////////////////////////// UTILITY FUNCTIONS //////////////////////////////
 
 // upload bytes to device
@@ -36,6 +36,12 @@ typedef fpga_result (*pfn_fpgaWriteMMIO64)(fpga_handle handle, uint32_t mmio_num
 typedef fpga_result (*pfn_fpgaReadMMIO64)(fpga_handle handle, uint32_t mmio_num, uint64_t offset, uint64_t *value);
 typedef const char *(*pfn_fpgaErrStr)(fpga_result e);
 
+typedef fpga_result (*pfn_fpgaCreateEventHandle)(fpga_event_handle *event_handle);
+typedef fpga_result (*pfn_fpgaDestroyEventHandle)(fpga_event_handle *event_handle);
+typedef fpga_result (*pfn_fpgaGetOSObjectFromEventHandle)(const fpga_event_handle eh, int *fd);
+typedef fpga_result (*pfn_fpgaRegisterEvent)(fpga_handle handle, fpga_event_type event_type, fpga_event_handle event_handle, uint32_t flags);
+typedef fpga_result (*pfn_fpgaUnregisterEvent)(fpga_handle handle, fpga_event_type event_type, fpga_event_handle event_handle);
+
 struct opae_drv_api_t {
 	pfn_fpgaGetProperties fpgaGetProperties;
 	pfn_fpgaPropertiesSetObjectType fpgaPropertiesSetObjectType;
@@ -53,6 +59,13 @@ struct opae_drv_api_t {
 	pfn_fpgaWriteMMIO64  	fpgaWriteMMIO64;
 	pfn_fpgaReadMMIO64    fpgaReadMMIO64;
 	pfn_fpgaErrStr     		fpgaErrStr;
+
+	// optional, null when the platform has no event support
+	pfn_fpgaCreateEventHandle          fpgaCreateEventHandle;
+	pfn_fpgaDestroyEventHandle         fpgaDestroyEventHandle;
+	pfn_fpgaGetOSObjectFromEventHandle fpgaGetOSObjectFromEventHandle;
+	pfn_fpgaRegisterEvent              fpgaRegisterEvent;
+	pfn_fpgaUnregisterEvent            fpgaUnregisterEvent;
 };
 
 int drv_init(opae_drv_api_t* opae_drv_funcs);
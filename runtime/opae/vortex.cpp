@@ -28,13 +28,16 @@
 #include <cstring>
 #include <iostream>
 #include <list>
+#include <map>
 #include <memory>
+#include <poll.h>
 #include <sstream>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <unordered_map>
 #include <uuid/uuid.h>
+#include <vector>
 
 using namespace vortex;
 
@@ -55,6 +58,11 @@ using namespace vortex;
 
 #define STATUS_STATE_BITS 8
 
+// large transfers are split into chunks that alternate between staging
+// buffers, so that the host copy of a chunk overlaps the DMA of the previous one
+#define STAGING_CHUNK_SIZE  (1 << 20)
+#define NUM_STAGING_BUFFERS 2
+
 #define CHECK_HANDLE(handle, _expr, _cleanup)                                  \
   auto handle = _expr;                                                         \
   if (handle == nullptr) {                                                     \
@@ -82,10 +90,10 @@ public:
                   GLOBAL_MEM_SIZE - ALLOC_BASE_ADDR,
                   RAM_PAGE_SIZE,
                   CACHE_BLOCK_SIZE)
-    , staging_wsid_(0)
-    , staging_ioaddr_(0)
-    , staging_ptr_(nullptr)
+    , staging_()
     , staging_size_(0)
+    , intr_event_(nullptr)
+    , intr_fd_(-1)
   {}
 
   ~vx_device() {
@@ -93,74 +101,67 @@ public:
     vx_scope_stop(this);
   #endif
     if (fpga_ != nullptr) {
-      if (staging_size_ != 0) {
-        api_.fpgaReleaseBuffer(fpga_, staging_wsid_);
-        staging_size_ = 0;
-      }
+      this->release_staging();
+      this->unregister_interrupt();
       api_.fpgaClose(fpga_);
     }
     drv_close();
   }
 
-  int init() {
-    fpga_token accel_token;
-    fpga_properties filter;
-    fpga_guid guid;
-    uint32_t num_matches;
-
+  static int device_count(uint32_t* count) {
+    opae_drv_api_t api_;
     memset(&api_, 0, sizeof(opae_drv_api_t));
     if (drv_init(&api_) != 0) {
       return -1;
     }
+    uint32_t num_matches;
+    int err = enumerate(api_, nullptr, 0, &num_matches);
+    drv_close();
+    if (err != 0)
+      return err;
+    *count = num_matches;
+    return 0;
+  }
 
-    // Set up a filter that will search for an accelerator
-    CHECK_FPGA_ERR(api_.fpgaGetProperties(nullptr, &filter), {
-      return -1;
-    });
-
-    CHECK_FPGA_ERR(api_.fpgaPropertiesSetObjectType(filter, FPGA_ACCELERATOR), {
-      api_.fpgaDestroyProperties(&filter);
-      return -1;
-    });
+  int init(uint32_t index) {
+    uint32_t num_matches;
 
-    // Add the desired UUID to the filter
-    std::string s_uuid(AFU_ACCEL_UUID);
-    std::replace(s_uuid.begin(), s_uuid.end(), '_', '-');
-    uuid_parse(s_uuid.c_str(), guid);
-    CHECK_FPGA_ERR(api_.fpgaPropertiesSetGUID(filter, guid), {
-      api_.fpgaDestroyProperties(&filter);
+    memset(&api_, 0, sizeof(opae_drv_api_t));
+    if (drv_init(&api_) != 0) {
       return -1;
-    });
+    }
 
     // Do the search across the available FPGA contexts
-    CHECK_FPGA_ERR(api_.fpgaEnumerate(&filter, 1, &accel_token, 1, &num_matches), {
-      api_.fpgaDestroyProperties(&filter);
-      return -1;
-    });
-
-    // Not needed anymore
-    CHECK_FPGA_ERR(api_.fpgaDestroyProperties(&filter), {
-      api_.fpgaDestroyToken(&accel_token);
-      return -1;
+    std::vector<fpga_token> tokens(index + 1, nullptr);
+    CHECK_ERR(enumerate(api_, tokens.data(), tokens.size(), &num_matches), {
+      return err;
     });
+    uint32_t num_tokens = std::min<uint32_t>(num_matches, tokens.size());
 
-    if (num_matches < 1) {
-      fprintf(stderr, "[VXDRV] Error: accelerator %s not found!\n", AFU_ACCEL_UUID);
-      api_.fpgaDestroyToken(&accel_token);
+    if (num_matches <= index) {
+      fprintf(stderr, "[VXDRV] Error: accelerator %s #%d not found!\n", AFU_ACCEL_UUID, index);
+      for (uint32_t i = 0; i < num_tokens; ++i) {
+        api_.fpgaDestroyToken(&tokens[i]);
+      }
       return -1;
     }
 
     // Open accelerator
+    auto accel_token = tokens[index];
     CHECK_FPGA_ERR(api_.fpgaOpen(accel_token, &fpga_, 0), {
-      api_.fpgaDestroyToken(&accel_token);
+      for (uint32_t i = 0; i < num_tokens; ++i) {
+        api_.fpgaDestroyToken(&tokens[i]);
+      }
       return -1;
     });
 
-    // Done with token
-    CHECK_FPGA_ERR(api_.fpgaDestroyToken(&accel_token), {
-      api_.fpgaClose(fpga_);
-      return -1;
-    });
+    // Done with tokens
+    for (uint32_t i = 0; i < num_tokens; ++i) {
+      CHECK_FPGA_ERR(api_.fpgaDestroyToken(&tokens[i]), {
+        api_.fpgaClose(fpga_);
+        return -1;
+      });
+    }
 
     {
       // Load ISA CAPS
@@ -182,6 +183,9 @@ public:
       global_mem_size_ = num_banks * bank_size;
     }
 
+    // completion interrupts are optional, ready_wait falls back to polling
+    this->register_interrupt();
+
   #ifdef SCOPE
     {
       scope_callback_t callback;
@@ -257,6 +261,9 @@ public:
       global_mem_.release(addr);
       return err;
     });
+    if (flags & VX_MEM_PIN_MEMORY) {
+      pinned_buffers_[addr] = size;
+    }
     *dev_addr = addr;
     return 0;
   }
@@ -273,6 +280,7 @@ public:
   }
 
   int mem_free(uint64_t dev_addr) {
+    pinned_buffers_.erase(dev_addr);
     return global_mem_.release(dev_addr);
   }
 
@@ -280,6 +288,15 @@ public:
     return 0;
   }
 
+  int mem_map(uint64_t /*dev_addr*/, void** /*host_ptr*/) {
+    // device memory is not host-addressable
+    return -1;
+  }
+
+  int mem_unmap(uint64_t /*dev_addr*/) {
+    return -1;
+  }
+
   int mem_info(uint64_t * mem_free, uint64_t * mem_used) const {
     if (mem_free)
       *mem_free = global_mem_.free();
@@ -303,29 +320,28 @@ public:
     if (this->ready_wait(VX_MAX_TIMEOUT) != 0)
       return -1;
 
-    if (this->ensure_staging(asize) != 0)
-      return -1;
-
-    // update staging buffer
-    memcpy(staging_ptr_, host_ptr, size);
-
-    auto ls_shift = (int)std::log2(CACHE_BLOCK_SIZE);
+    // pinned host memory is transferred in place
+    if (this->is_pinned(dev_addr, (void*)host_ptr, size))
+      return this->pinned_transfer(CMD_MEM_WRITE, (void*)host_ptr, dev_addr, size);
 
-    CHECK_FPGA_ERR(api_.fpgaWriteMMIO64(fpga_, 0, MMIO_CMD_ARG0, staging_ioaddr_ >> ls_shift), {
+    uint64_t chunk_size = std::min<uint64_t>(asize, STAGING_CHUNK_SIZE);
+    if (this->ensure_staging(chunk_size) != 0)
       return -1;
-    });
 
-    CHECK_FPGA_ERR(api_.fpgaWriteMMIO64(fpga_, 0, MMIO_CMD_ARG1, dev_addr >> ls_shift), {
-      return -1;
-    });
+    for (uint64_t offset = 0, i = 0; offset < size; offset += chunk_size, ++i) {
+      auto& staging = staging_[i % NUM_STAGING_BUFFERS];
+      uint64_t len = std::min<uint64_t>(chunk_size, size - offset);
 
-    CHECK_FPGA_ERR(api_.fpgaWriteMMIO64(fpga_, 0, MMIO_CMD_ARG2, asize >> ls_shift), {
-      return -1;
-    });
+      // update staging buffer while the previous chunk is transferred
+      memcpy(staging.ptr, (const uint8_t*)host_ptr + offset, len);
 
-    CHECK_FPGA_ERR(api_.fpgaWriteMMIO64(fpga_, 0, MMIO_CMD_TYPE, CMD_MEM_WRITE), {
-      return -1;
-    });
+      if (this->ready_wait(VX_MAX_TIMEOUT) != 0)
+        return -1;
+
+      CHECK_ERR(this->dma_start(CMD_MEM_WRITE, staging.ioaddr, dev_addr + offset, aligned_size(len, CACHE_BLOCK_SIZE)), {
+        return err;
+      });
+    }
 
     // Wait for the write operation to finish
     if (this->ready_wait(VX_MAX_TIMEOUT) != 0)
@@ -349,30 +365,39 @@ public:
     if (this->ready_wait(VX_MAX_TIMEOUT) != 0)
       return -1;
 
-    if (this->ensure_staging(asize) != 0)
-      return -1;
-
-    auto ls_shift = (int)std::log2(CACHE_BLOCK_SIZE);
+    // pinned host memory is transferred in place
+    if (this->is_pinned(dev_addr, host_ptr, size))
+      return this->pinned_transfer(CMD_MEM_READ, host_ptr, dev_addr, size);
 
-    CHECK_FPGA_ERR(api_.fpgaWriteMMIO64(fpga_, 0, MMIO_CMD_ARG0, staging_ioaddr_ >> ls_shift), {
-      return -1;
-    });
-    CHECK_FPGA_ERR(api_.fpgaWriteMMIO64(fpga_, 0, MMIO_CMD_ARG1, dev_addr >> ls_shift), {
-      return -1;
-    });
-    CHECK_FPGA_ERR(api_.fpgaWriteMMIO64(fpga_, 0, MMIO_CMD_ARG2, asize >> ls_shift), {
-      return -1;
-    });
-    CHECK_FPGA_ERR(api_.fpgaWriteMMIO64(fpga_, 0, MMIO_CMD_TYPE, CMD_MEM_READ), {
+    uint64_t chunk_size = std::min<uint64_t>(asize, STAGING_CHUNK_SIZE);
+    if (this->ensure_staging(chunk_size) != 0)
       return -1;
+
+    CHECK_ERR(this->dma_start(CMD_MEM_READ, staging_[0].ioaddr, dev_addr, chunk_size), {
+      return err;
     });
 
-    // Wait for the write operation to finish
-    if (this->ready_wait(VX_MAX_TIMEOUT) != 0)
-      return -1;
+    for (uint64_t offset = 0, i = 0; offset < size; offset += chunk_size, ++i) {
+      auto& staging = staging_[i % NUM_STAGING_BUFFERS];
+      uint64_t len = std::min<uint64_t>(chunk_size, size - offset);
+
+      // Wait for the read operation to finish
+      if (this->ready_wait(VX_MAX_TIMEOUT) != 0)
+        return -1;
 
-    // read staging buffer
-    memcpy(host_ptr, staging_ptr_, size);
+      // fetch the next chunk while this one is read back
+      uint64_t next_offset = offset + chunk_size;
+      if (next_offset < size) {
+        auto& next_staging = staging_[(i + 1) % NUM_STAGING_BUFFERS];
+        uint64_t next_len = std::min<uint64_t>(chunk_size, size - next_offset);
+        CHECK_ERR(this->dma_start(CMD_MEM_READ, next_staging.ioaddr, dev_addr + next_offset, aligned_size(next_len, CACHE_BLOCK_SIZE)), {
+          return err;
+        });
+      }
+
+      // read staging buffer
+      memcpy((uint8_t*)host_ptr + offset, staging.ptr, len);
+    }
 
     return 0;
   }
@@ -404,14 +429,8 @@ public:
   }
 
   int ready_wait(uint64_t timeout) {
-    std::unordered_map<uint32_t, std::stringstream> print_bufs;
-
-    struct timespec sleep_time;
-    sleep_time.tv_sec = 0;
-    sleep_time.tv_nsec = 1000000;
-
-    // to milliseconds
-    uint64_t sleep_time_ms = (sleep_time.tv_sec * 1000) + (sleep_time.tv_nsec / 1000000);
+    // each status read is a bus round-trip, poll less often on long waits
+    PollBackoff backoff(timeout);
 
     for (;;) {
       uint64_t status;
@@ -422,11 +441,13 @@ public:
       // check for console data
       uint32_t cout_data = status >> STATUS_STATE_BITS;
       if (cout_data & 0x1) {
+        // the device is active, keep polling at full rate
+        backoff.reset();
         // retrieve console data
         do {
           char cout_char = (cout_data >> 1) & 0xff;
           uint32_t cout_tid = (cout_data >> 9) & 0xff;
-          auto &ss_buf = print_bufs[cout_tid];
+          auto &ss_buf = print_bufs_[cout_tid];
           ss_buf << cout_char;
           if (cout_char == '\n') {
             std::cout << std::dec << "#" << cout_tid << ": " << ss_buf.str() << std::flush;
@@ -441,13 +462,18 @@ public:
 
       uint32_t state = status & ((1 << STATUS_STATE_BITS) - 1);
 
-      if (0 == state || 0 == timeout) {
-        for (auto &buf : print_bufs) {
+      if (0 == state || backoff.expired()) {
+        // a zero timeout only probes the device, partial lines are kept
+        // for the next call
+        if (state != 0 && 0 == timeout)
+          return -1;
+        for (auto &buf : print_bufs_) {
           auto str = buf.second.str();
           if (!str.empty()) {
             std::cout << "#" << buf.first << ": " << str << std::endl;
           }
         }
+        print_bufs_.clear();
         if (state != 0) {
           fprintf(stdout, "[VXDRV] ready-wait timed out: state=%d\n", state);
           return -1;
@@ -455,8 +481,7 @@ public:
         break;
       }
 
-      nanosleep(&sleep_time, nullptr);
-      timeout -= sleep_time_ms;
+      this->wait_interrupt(backoff.next());
     };
 
     return 0;
@@ -484,43 +509,226 @@ public:
     uint32_t offset = addr - VX_CSR_MPM_BASE;
     if (offset > 31)
       return -1;
-    if (mpm_cache_.count(core_id) == 0) {
-      uint64_t mpm_mem_addr = IO_MPM_ADDR + core_id * 32 * sizeof(uint64_t);
-      CHECK_ERR(this->download(mpm_cache_[core_id].data(), mpm_mem_addr, 32 * sizeof(uint64_t)), {
-        return err;
-      });
-    }
-    *value = mpm_cache_.at(core_id).at(offset);
+    CHECK_ERR(this->mpm_load(), {
+      return err;
+    });
+    // legacy queries read the first bank
+    uint32_t stride = 32 * IO_MPM_BANKS;
+    if ((core_id + 1) * stride > mpm_cache_.size())
+      return -1;
+    *value = mpm_cache_.at(core_id * stride + offset);
+    return 0;
+  }
+
+  int mpm_snapshot(uint64_t* counters) {
+    CHECK_ERR(this->mpm_load(), {
+      return err;
+    });
+    memcpy(counters, mpm_cache_.data(), mpm_cache_.size() * sizeof(uint64_t));
     return 0;
   }
 
 private:
 
-  int ensure_staging(uint64_t size) {
-    if (staging_size_ >= size)
+  // fetch all cores' counter blocks in a single transfer,
+  // the cache stays valid until the next kernel launch
+  int mpm_load() {
+    if (!mpm_cache_.empty())
       return 0;
+    uint64_t num_cores;
+    CHECK_ERR(this->get_caps(VX_CAPS_NUM_CORES, &num_cores), {
+      return err;
+    });
+    std::vector<uint64_t> counters(num_cores * 32 * IO_MPM_BANKS);
+    CHECK_ERR(this->download(counters.data(), IO_MPM_ADDR, counters.size() * sizeof(uint64_t)), {
+      return err;
+    });
+    mpm_cache_ = std::move(counters);
+    return 0;
+  }
 
-    if (staging_size_ != 0) {
-      api_.fpgaReleaseBuffer(fpga_, staging_wsid_);
-      staging_size_ = 0;
-    }
+  // search for the Vortex accelerators, returning up to max_tokens of them
+  static int enumerate(opae_drv_api_t& api_, fpga_token* tokens, uint32_t max_tokens, uint32_t* num_matches) {
+    fpga_properties filter;
+    fpga_guid guid;
 
-    // allocate new buffer
-    CHECK_FPGA_ERR(api_.fpgaPrepareBuffer(fpga_, size, (void **)&staging_ptr_, &staging_wsid_, 0), {
+    // Set up a filter that will search for an accelerator
+    CHECK_FPGA_ERR(api_.fpgaGetProperties(nullptr, &filter), {
       return -1;
     });
 
-    // get the physical address of the buffer in the accelerator
-    CHECK_FPGA_ERR(api_.fpgaGetIOAddress(fpga_, staging_wsid_, &staging_ioaddr_), {
-      api_.fpgaReleaseBuffer(fpga_, staging_wsid_);
+    CHECK_FPGA_ERR(api_.fpgaPropertiesSetObjectType(filter, FPGA_ACCELERATOR), {
+      api_.fpgaDestroyProperties(&filter);
       return -1;
     });
 
+    // Add the desired UUID to the filter
+    std::string s_uuid(AFU_ACCEL_UUID);
+    std::replace(s_uuid.begin(), s_uuid.end(), '_', '-');
+    uuid_parse(s_uuid.c_str(), guid);
+    CHECK_FPGA_ERR(api_.fpgaPropertiesSetGUID(filter, guid), {
+      api_.fpgaDestroyProperties(&filter);
+      return -1;
+    });
+
+    CHECK_FPGA_ERR(api_.fpgaEnumerate(&filter, 1, tokens, max_tokens, num_matches), {
+      api_.fpgaDestroyProperties(&filter);
+      return -1;
+    });
+
+    // Not needed anymore
+    CHECK_FPGA_ERR(api_.fpgaDestroyProperties(&filter), {
+      return -1;
+    });
+
+    return 0;
+  }
+
+  int ensure_staging(uint64_t size) {
+    if (staging_size_ >= size)
+      return 0;
+
+    this->release_staging();
+
+    // allocate new buffers
+    for (uint32_t i = 0; i < NUM_STAGING_BUFFERS; ++i) {
+      auto& staging = staging_[i];
+      CHECK_FPGA_ERR(api_.fpgaPrepareBuffer(fpga_, size, (void **)&staging.ptr, &staging.wsid, 0), {
+        staging.ptr = nullptr;
+        this->release_staging();
+        return -1;
+      });
+
+      // get the physical address of the buffer in the accelerator
+      CHECK_FPGA_ERR(api_.fpgaGetIOAddress(fpga_, staging.wsid, &staging.ioaddr), {
+        this->release_staging();
+        return -1;
+      });
+    }
+
     staging_size_ = size;
 
     return 0;
   }
 
+  void register_interrupt() {
+    if (nullptr == api_.fpgaCreateEventHandle
+     || nullptr == api_.fpgaDestroyEventHandle
+     || nullptr == api_.fpgaGetOSObjectFromEventHandle
+     || nullptr == api_.fpgaRegisterEvent
+     || nullptr == api_.fpgaUnregisterEvent)
+      return;
+    if (api_.fpgaCreateEventHandle(&intr_event_) != FPGA_OK) {
+      intr_event_ = nullptr;
+      return;
+    }
+    // user interrupt vector 0 signals the end of a command
+    if (api_.fpgaRegisterEvent(fpga_, FPGA_EVENT_INTERRUPT, intr_event_, 0) != FPGA_OK) {
+      api_.fpgaDestroyEventHandle(&intr_event_);
+      intr_event_ = nullptr;
+      return;
+    }
+    if (api_.fpgaGetOSObjectFromEventHandle(intr_event_, &intr_fd_) != FPGA_OK) {
+      this->unregister_interrupt();
+    }
+  }
+
+  void unregister_interrupt() {
+    if (intr_event_ == nullptr)
+      return;
+    api_.fpgaUnregisterEvent(fpga_, FPGA_EVENT_INTERRUPT, intr_event_);
+    api_.fpgaDestroyEventHandle(&intr_event_);
+    intr_event_ = nullptr;
+    intr_fd_ = -1;
+  }
+
+  // sleep for the given nanoseconds, or until the device raises an interrupt
+  void wait_interrupt(uint64_t delay) {
+    struct timespec ts;
+    ts.tv_sec  = delay / 1000000000;
+    ts.tv_nsec = delay % 1000000000;
+    if (intr_fd_ < 0) {
+      nanosleep(&ts, nullptr);
+      return;
+    }
+    struct pollfd pfd;
+    pfd.fd = intr_fd_;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if (ppoll(&pfd, 1, &ts, nullptr) > 0 && (pfd.revents & POLLIN)) {
+      // acknowledge the interrupt
+      uint64_t count;
+      if (read(intr_fd_, &count, sizeof(count)) < 0) {
+        return;
+      }
+    }
+  }
+
+  void release_staging() {
+    for (auto& staging : staging_) {
+      if (staging.ptr != nullptr) {
+        api_.fpgaReleaseBuffer(fpga_, staging.wsid);
+        staging.ptr = nullptr;
+      }
+    }
+    staging_size_ = 0;
+  }
+
+  int dma_start(uint64_t cmd, uint64_t ioaddr, uint64_t dev_addr, uint64_t size) {
+    auto ls_shift = (int)std::log2(CACHE_BLOCK_SIZE);
+
+    CHECK_FPGA_ERR(api_.fpgaWriteMMIO64(fpga_, 0, MMIO_CMD_ARG0, ioaddr >> ls_shift), {
+      return -1;
+    });
+    CHECK_FPGA_ERR(api_.fpgaWriteMMIO64(fpga_, 0, MMIO_CMD_ARG1, dev_addr >> ls_shift), {
+      return -1;
+    });
+    CHECK_FPGA_ERR(api_.fpgaWriteMMIO64(fpga_, 0, MMIO_CMD_ARG2, size >> ls_shift), {
+      return -1;
+    });
+    CHECK_FPGA_ERR(api_.fpgaWriteMMIO64(fpga_, 0, MMIO_CMD_TYPE, cmd), {
+      return -1;
+    });
+
+    return 0;
+  }
+
+  // buffers allocated with VX_MEM_PIN_MEMORY are transferred without staging
+  // when the host range can be pinned, i.e. it covers whole host pages
+  bool is_pinned(uint64_t dev_addr, void* host_ptr, uint64_t size) const {
+    uint64_t page_size = sysconf(_SC_PAGESIZE);
+    if (0 != (uintptr_t(host_ptr) % page_size) || 0 != (size % page_size))
+      return false;
+    auto it = pinned_buffers_.upper_bound(dev_addr);
+    if (it == pinned_buffers_.begin())
+      return false;
+    --it;
+    return (dev_addr + size) <= (it->first + it->second);
+  }
+
+  int pinned_transfer(uint64_t cmd, void* host_ptr, uint64_t dev_addr, uint64_t size) {
+    uint64_t wsid, ioaddr;
+    CHECK_FPGA_ERR(api_.fpgaPrepareBuffer(fpga_, size, &host_ptr, &wsid, FPGA_BUF_PREALLOCATED), {
+      return -1;
+    });
+    CHECK_FPGA_ERR(api_.fpgaGetIOAddress(fpga_, wsid, &ioaddr), {
+      api_.fpgaReleaseBuffer(fpga_, wsid);
+      return -1;
+    });
+    int err = this->dma_start(cmd, ioaddr, dev_addr, size);
+    if (0 == err) {
+      err = this->ready_wait(VX_MAX_TIMEOUT);
+    }
+    api_.fpgaReleaseBuffer(fpga_, wsid);
+    return err;
+  }
+
+  struct staging_buffer_t {
+    uint64_t wsid;
+    uint64_t ioaddr;
+    uint8_t* ptr;
+  };
+
   opae_drv_api_t api_;
   fpga_handle fpga_;
   MemoryAllocator global_mem_;
@@ -528,11 +736,13 @@ private:
   uint64_t dev_caps_;
   uint64_t isa_caps_;
   uint64_t global_mem_size_;
-  uint64_t staging_wsid_;
-  uint64_t staging_ioaddr_;
-  uint8_t *staging_ptr_;
+  staging_buffer_t staging_[NUM_STAGING_BUFFERS];
   uint64_t staging_size_;
-  std::unordered_map<uint32_t, std::array<uint64_t, 32>> mpm_cache_;
+  std::map<uint64_t, uint64_t> pinned_buffers_;
+  fpga_event_handle intr_event_;
+  int intr_fd_;
+  std::vector<uint64_t> mpm_cache_;
+  std::unordered_map<uint32_t, std::stringstream> print_bufs_; // console lines pending across ready waits
 };
 
 #include <callbacks.inc>
\ No newline at end of file
@@ -20,10 +20,12 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include <iostream>
 #include <future>
 #include <list>
+#include <vector>
 #include <chrono>
 
 using namespace vortex;
@@ -38,6 +40,8 @@ public:
                   CACHE_BLOCK_SIZE)
   {
     processor_.attach_ram(&ram_);
+    // uploads and downloads proceed while a kernel runs
+    ram_.set_concurrent(true);
   }
 
   ~vx_device() {
@@ -46,7 +50,13 @@ public:
     }
   }
 
-  int init() {
+  // the RTL model keeps global simulation state, one instance per process
+  static int device_count(uint32_t* count) {
+    *count = 1;
+    return 0;
+  }
+
+  int init(uint32_t /*index*/) {
     return 0;
   }
 
@@ -101,6 +111,16 @@ public:
       global_mem_.release(addr);
       return err;
     });
+    if (flags & VX_MEM_PIN_MEMORY) {
+      // pinned buffers are backed by contiguous host memory
+      uint64_t asize = aligned_size(size, RAM_PAGE_SIZE);
+      if (ram_.map(addr, asize) == nullptr) {
+        std::cout << "Error: cannot pin device memory at 0x" << std::hex << addr << std::dec << std::endl;
+        global_mem_.release(addr);
+        return -1;
+      }
+      pinned_buffers_[addr] = asize;
+    }
     *dev_addr = addr;
     return 0;
   }
@@ -117,6 +137,11 @@ public:
   }
 
   int mem_free(uint64_t dev_addr) {
+    auto it = pinned_buffers_.find(dev_addr);
+    if (it != pinned_buffers_.end()) {
+      ram_.unmap(dev_addr, it->second);
+      pinned_buffers_.erase(it);
+    }
     return global_mem_.release(dev_addr);
   }
 
@@ -134,6 +159,30 @@ public:
     return 0;
   }
 
+  int mem_map(uint64_t dev_addr, void** host_ptr) {
+    auto it = pinned_buffers_.find(dev_addr);
+    if (it == pinned_buffers_.end())
+      return -1;
+    // ensure prior run completed
+    if (future_.valid()) {
+      future_.wait();
+    }
+    // remap in case the device memory was reset
+    auto ptr = ram_.map(dev_addr, it->second);
+    if (ptr == nullptr)
+      return -1;
+    *host_ptr = ptr;
+    return 0;
+  }
+
+  int mem_unmap(uint64_t dev_addr) {
+    auto it = pinned_buffers_.find(dev_addr);
+    if (it == pinned_buffers_.end())
+      return -1;
+    ram_.unmap(dev_addr, it->second);
+    return 0;
+  }
+
   int mem_info(uint64_t* mem_free, uint64_t* mem_used) const {
     if (mem_free)
       *mem_free = global_mem_.free();
@@ -147,9 +196,7 @@ public:
     if (dest_addr + asize > GLOBAL_MEM_SIZE)
       return -1;
 
-    ram_.enable_acl(false);
-    ram_.write((const uint8_t*)src, dest_addr, size);
-    ram_.enable_acl(true);
+    ram_.backdoor_write((const uint8_t*)src, dest_addr, size);
 
     /*printf("VXDRV: upload %ld bytes from 0x%lx:", size, uintptr_t((uint8_t*)src));
     for (int i = 0;  i < (asize / CACHE_BLOCK_SIZE); ++i) {
@@ -168,9 +215,7 @@ public:
     if (src_addr + asize > GLOBAL_MEM_SIZE)
       return -1;
 
-    ram_.enable_acl(false);
-    ram_.read((uint8_t*)dest, src_addr, size);
-    ram_.enable_acl(true);
+    ram_.backdoor_read((uint8_t*)dest, src_addr, size);
 
     /*printf("VXDRV: download %ld bytes to 0x%lx:", size, uintptr_t((uint8_t*)dest));
     for (int i = 0;  i < (asize / CACHE_BLOCK_SIZE); ++i) {
@@ -210,16 +255,10 @@ public:
   int ready_wait(uint64_t timeout) {
     if (!future_.valid())
       return 0;
-    uint64_t timeout_sec = timeout / 1000;
-    std::chrono::seconds wait_time(1);
-    for (;;) {
-      // wait for 1 sec and check status
-      auto status = future_.wait_for(wait_time);
-      if (status == std::future_status::ready)
-        break;
-      if (0 == timeout_sec--)
-        return -1;
-    }
+    // block on the run completion, the simulation thread wakes us up
+    auto status = future_.wait_for(std::chrono::milliseconds(std::min<uint64_t>(timeout, VX_MAX_TIMEOUT)));
+    if (status != std::future_status::ready)
+      return -1;
     return 0;
   }
 
@@ -240,24 +279,51 @@ public:
     uint32_t offset = addr - VX_CSR_MPM_BASE;
     if (offset > 31)
       return -1;
-    if (mpm_cache_.count(core_id) == 0) {
-      uint64_t mpm_mem_addr = IO_MPM_ADDR + core_id * 32 * sizeof(uint64_t);
-      CHECK_ERR(this->download(mpm_cache_[core_id].data(), mpm_mem_addr, 32 * sizeof(uint64_t)), {
-        return err;
-      });
-    }
-    *value = mpm_cache_.at(core_id).at(offset);
+    CHECK_ERR(this->mpm_load(), {
+      return err;
+    });
+    // legacy queries read the first bank
+    uint32_t stride = 32 * IO_MPM_BANKS;
+    if ((core_id + 1) * stride > mpm_cache_.size())
+      return -1;
+    *value = mpm_cache_.at(core_id * stride + offset);
+    return 0;
+  }
+
+  int mpm_snapshot(uint64_t* counters) {
+    CHECK_ERR(this->mpm_load(), {
+      return err;
+    });
+    memcpy(counters, mpm_cache_.data(), mpm_cache_.size() * sizeof(uint64_t));
     return 0;
   }
 
 private:
 
+  // fetch all cores' counter blocks in a single transfer,
+  // the cache stays valid until the next kernel launch
+  int mpm_load() {
+    if (!mpm_cache_.empty())
+      return 0;
+    uint64_t num_cores;
+    CHECK_ERR(this->get_caps(VX_CAPS_NUM_CORES, &num_cores), {
+      return err;
+    });
+    std::vector<uint64_t> counters(num_cores * 32 * IO_MPM_BANKS);
+    CHECK_ERR(this->download(counters.data(), IO_MPM_ADDR, counters.size() * sizeof(uint64_t)), {
+      return err;
+    });
+    mpm_cache_ = std::move(counters);
+    return 0;
+  }
+
   RAM                 ram_;
   Processor           processor_;
   MemoryAllocator     global_mem_;
   DeviceConfig        dcrs_;
   std::future<void>   future_;
-  std::unordered_map<uint32_t, std::array<uint64_t, 32>> mpm_cache_;
+  std::vector<uint64_t> mpm_cache_;
+  std::unordered_map<uint64_t, uint64_t> pinned_buffers_;
 };
 
 #include <callbacks.inc>
\ No newline at end of file
@@ -20,8 +20,10 @@
 #include <constants.h>
 
 #include <stdint.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include <iostream>
 #include <future>
@@ -41,21 +43,77 @@
 #include <constants.h>
 #include <unordered_map>
 #include <array>
+#include <vector>
 #include <cmath>
 #endif
 
 using namespace vortex;
 
+static Arch create_arch() {
+  Arch arch(NUM_THREADS, NUM_WARPS, NUM_CORES);
+  // cache geometry overrides: <file> or <cache>.<param>=<value>,...
+  auto caches_s = getenv("VORTEX_SIMX_CACHES");
+  if (caches_s && arch.set_cache_params(caches_s) != 0) {
+    std::abort();
+  }
+  // warp scheduler: <policy>[:<pool size>]
+  auto scheduler_s = getenv("VORTEX_SIMX_SCHEDULER");
+  if (scheduler_s && arch.set_warp_scheduler(scheduler_s) != 0) {
+    std::abort();
+  }
+  return arch;
+}
+
 class vx_device {
 public:
     vx_device()
-        : arch_(NUM_THREADS, NUM_WARPS, NUM_CORES)
+        : arch_(create_arch())
         , ram_(0, MEM_PAGE_SIZE)
         , processor_(arch_)
         , global_mem_(ALLOC_BASE_ADDR, GLOBAL_MEM_SIZE - ALLOC_BASE_ADDR, MEM_PAGE_SIZE, CACHE_BLOCK_SIZE)
     {
         // attach memory module
         processor_.attach_ram(&ram_);
+
+        // uploads and downloads proceed while a kernel runs
+        ram_.set_concurrent(true);
+
+        // parallel simulation threads
+        auto sim_threads_s = getenv("VORTEX_SIMX_THREADS");
+        if (sim_threads_s) {
+          processor_.set_num_threads(atoi(sim_threads_s));
+        }
+
+        // functional-only simulation
+        auto functional_s = getenv("VORTEX_SIMX_FUNCTIONAL");
+        if (functional_s) {
+          processor_.set_functional(atoi(functional_s) != 0);
+        }
+
+        // sampled simulation: <fast-forward>:<window>[:<warmup>] instructions
+        auto sampling_s = getenv("VORTEX_SIMX_SAMPLING");
+        if (sampling_s) {
+          uint64_t fast_forward = 0, window = 0, warmup = 0;
+          if (sscanf(sampling_s, "%" SCNu64 ":%" SCNu64 ":%" SCNu64, &fast_forward, &window, &warmup) >= 2) {
+            processor_.set_sampling(fast_forward, window, warmup);
+          }
+        }
+
+        // save the device state at a given cycle: <cycle>:<file>
+        auto checkpoint_s = getenv("VORTEX_SIMX_CHECKPOINT");
+        if (checkpoint_s) {
+          char* sep = nullptr;
+          uint64_t cycle = strtoull(checkpoint_s, &sep, 0);
+          if (*sep == ':') {
+            processor_.set_checkpoint(sep + 1, cycle);
+          }
+        }
+
+        // resume the first kernel from a saved device state
+        auto restore_s = getenv("VORTEX_SIMX_RESTORE");
+        if (restore_s) {
+          processor_.set_restore(restore_s);
+        }
 #ifdef VM_ENABLE
 	std::cout << "*** VM ENABLED!! ***"<< std::endl;
         CHECK_ERR(init_VM(), );
@@ -75,7 +133,14 @@ public:
     }
   }
 
-  int init() {
+  // simulated devices are independent instances
+  static int device_count(uint32_t* count) {
+    auto num_devices_s = getenv("VORTEX_SIMX_DEVICES");
+    *count = num_devices_s ? std::max(atoi(num_devices_s), 1) : 1;
+    return 0;
+  }
+
+  int init(uint32_t /*index*/) {
     return 0;
   }
 
@@ -218,11 +283,20 @@ public:
       global_mem_.release(addr);
       return err;
     });
+    // pinned buffers are backed by contiguous host memory
+    if ((flags & VX_MEM_PIN_MEMORY) && ram_.map(addr, asize) == nullptr) {
+      std::cout << "Error: cannot pin device memory at 0x" << std::hex << addr << std::dec << std::endl;
+      global_mem_.release(addr);
+      return -1;
+    }
     *dev_addr = addr;
 #ifdef VM_ENABLE
     // VM address translation
     phy_to_virt_map(asize, dev_addr, flags);
 #endif
+    if (flags & VX_MEM_PIN_MEMORY) {
+      pinned_buffers_[*dev_addr] = {addr, asize};
+    }
     return 0;
   }
 
@@ -242,6 +316,11 @@ public:
 
   int mem_free(uint64_t dev_addr)
   {
+    auto it = pinned_buffers_.find(dev_addr);
+    if (it != pinned_buffers_.end()) {
+      ram_.unmap(it->second.first, it->second.second);
+      pinned_buffers_.erase(it);
+    }
 #ifdef VM_ENABLE
     uint64_t paddr = page_table_walk(dev_addr);
     return global_mem_.release(paddr);
@@ -260,6 +339,33 @@ public:
     return 0;
   }
 
+  int mem_map(uint64_t dev_addr, void** host_ptr)
+  {
+    auto it = pinned_buffers_.find(dev_addr);
+    if (it == pinned_buffers_.end())
+      return -1;
+    // ensure prior run completed
+    if (future_.valid())
+    {
+      future_.wait();
+    }
+    // remap in case the device memory was reset
+    auto ptr = ram_.map(it->second.first, it->second.second);
+    if (ptr == nullptr)
+      return -1;
+    *host_ptr = ptr;
+    return 0;
+  }
+
+  int mem_unmap(uint64_t dev_addr)
+  {
+    auto it = pinned_buffers_.find(dev_addr);
+    if (it == pinned_buffers_.end())
+      return -1;
+    ram_.unmap(it->second.first, it->second.second);
+    return 0;
+  }
+
   int mem_info(uint64_t *mem_free, uint64_t *mem_used) const
   {
     if (mem_free)
@@ -274,6 +380,7 @@ public:
     uint64_t asize = aligned_size(size, CACHE_BLOCK_SIZE);
     if (dest_addr + asize > GLOBAL_MEM_SIZE)
       return -1;
+
 #ifdef VM_ENABLE
     uint64_t pAddr = page_table_walk(dest_addr);
     // uint64_t pAddr;
@@ -288,9 +395,7 @@ public:
     dest_addr = pAddr; //Overwirte
 #endif
 
-    ram_.enable_acl(false);
-    ram_.write((const uint8_t *)src, dest_addr, size);
-    ram_.enable_acl(true);
+    ram_.backdoor_write((const uint8_t *)src, dest_addr, size);
 
     /*
     DBGPRINT("upload %ld bytes to 0x%lx\n", size, dest_addr);
@@ -306,15 +411,14 @@ public:
     uint64_t asize = aligned_size(size, CACHE_BLOCK_SIZE);
     if (src_addr + asize > GLOBAL_MEM_SIZE)
       return -1;
+
 #ifdef VM_ENABLE
     uint64_t pAddr = page_table_walk(src_addr);
     DBGPRINT("  [RT:download] Download data to vAddr = 0x%lx (pAddr=0x%lx)\n", src_addr, pAddr);
     src_addr = pAddr; //Overwirte
 #endif
 
-    ram_.enable_acl(false);
-    ram_.read((uint8_t *)dest, src_addr, size);
-    ram_.enable_acl(true);
+    ram_.backdoor_read((uint8_t *)dest, src_addr, size);
 
     /*DBGPRINT("download %ld bytes from 0x%lx\n", size, src_addr);
     for (uint64_t i = 0; i < size && i < 1024; i += 4) {
@@ -340,7 +444,7 @@ public:
 
     // start new run
     future_ = std::async(std::launch::async, [&]
-                         { processor_.run(); });
+                         { processor_.run(); }).share();
 
     // clear mpm cache
     mpm_cache_.clear();
@@ -348,21 +452,25 @@ public:
     return 0;
   }
 
+  // start a run and hand out its completion,
+  // the command queues wait on it without holding the device
+  int start_async(uint64_t krnl_addr, uint64_t args_addr, std::shared_future<void>* done)
+  {
+    CHECK_ERR(this->start(krnl_addr, args_addr), {
+      return err;
+    });
+    *done = future_;
+    return 0;
+  }
+
   int ready_wait(uint64_t timeout)
   {
     if (!future_.valid())
       return 0;
-    uint64_t timeout_sec = timeout / 1000;
-    std::chrono::seconds wait_time(1);
-    for (;;)
-    {
-      // wait for 1 sec and check status
-      auto status = future_.wait_for(wait_time);
-      if (status == std::future_status::ready)
-        break;
-      if (0 == timeout_sec--)
-        return -1;
-    }
+    // block on the run completion, the simulation thread wakes us up
+    auto status = future_.wait_for(std::chrono::milliseconds(std::min<uint64_t>(timeout, VX_MAX_TIMEOUT)));
+    if (status != std::future_status::ready)
+      return -1;
     return 0;
   }
 
@@ -387,14 +495,23 @@ public:
     uint32_t offset = addr - VX_CSR_MPM_BASE;
     if (offset > 31)
       return -1;
-    if (mpm_cache_.count(core_id) == 0)
-    {
-      uint64_t mpm_mem_addr = IO_MPM_ADDR + core_id * 32 * sizeof(uint64_t);
-      CHECK_ERR(this->download(mpm_cache_[core_id].data(), mpm_mem_addr, 32 * sizeof(uint64_t)), {
-        return err;
-      });
-    }
-    *value = mpm_cache_.at(core_id).at(offset);
+    CHECK_ERR(this->mpm_load(), {
+      return err;
+    });
+    // legacy queries read the first bank
+    uint32_t stride = 32 * IO_MPM_BANKS;
+    if ((core_id + 1) * stride > mpm_cache_.size())
+      return -1;
+    *value = mpm_cache_.at(core_id * stride + offset);
+    return 0;
+  }
+
+  int mpm_snapshot(uint64_t* counters)
+  {
+    CHECK_ERR(this->mpm_load(), {
+      return err;
+    });
+    memcpy(counters, mpm_cache_.data(), mpm_cache_.size() * sizeof(uint64_t));
     return 0;
   }
 #ifdef VM_ENABLE
@@ -413,9 +530,7 @@ public:
     {
       src[i] = 0;
     }
-    ram_.enable_acl(false);
-    ram_.write((const uint8_t *)src, addr, asize);
-    ram_.enable_acl(true);
+    ram_.backdoor_write((const uint8_t *)src, addr, asize);
     return 0;
   }
 
@@ -637,9 +752,7 @@ public:
       src[i] = (value >> (i << 3)) & 0xff;
     }
     // std::cout << "writing PTE to RAM addr 0x" << std::hex << addr << std::endl;
-    ram_.enable_acl(false);
-    ram_.write((const uint8_t *)src, addr, PTE_SIZE);
-    ram_.enable_acl(true);
+    ram_.backdoor_write((const uint8_t *)src, addr, PTE_SIZE);
   }
 
   uint64_t read_pte(uint64_t addr)
@@ -660,13 +773,33 @@ public:
 #endif // VM_ENABLE
 
 private:
+
+  // fetch all cores' counter blocks in a single transfer,
+  // the cache stays valid until the next kernel launch
+  int mpm_load()
+  {
+    if (!mpm_cache_.empty())
+      return 0;
+    uint64_t num_cores;
+    CHECK_ERR(this->get_caps(VX_CAPS_NUM_CORES, &num_cores), {
+      return err;
+    });
+    std::vector<uint64_t> counters(num_cores * 32 * IO_MPM_BANKS);
+    CHECK_ERR(this->download(counters.data(), IO_MPM_ADDR, counters.size() * sizeof(uint64_t)), {
+      return err;
+    });
+    mpm_cache_ = std::move(counters);
+    return 0;
+  }
+
   Arch arch_;
   RAM ram_;
   Processor processor_;
   MemoryAllocator global_mem_;
   DeviceConfig dcrs_;
-  std::future<void> future_;
-  std::unordered_map<uint32_t, std::array<uint64_t, 32>> mpm_cache_;
+  std::shared_future<void> future_;
+  std::vector<uint64_t> mpm_cache_;
+  std::unordered_map<uint64_t, std::pair<uint64_t, uint64_t>> pinned_buffers_; // physical address and size
 #ifdef VM_ENABLE
   std::unordered_map<uint64_t, uint64_t> addr_mapping; // HW: key: ppn; value: vpn
   MemoryAllocator* page_table_mem_;
@@ -674,4 +807,5 @@ private:
 #endif
 };
 
+#define DEVICE_ASYNC_START
 #include <callbacks.inc>
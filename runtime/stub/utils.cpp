@@ -16,19 +16,42 @@
 #include <iostream>
 #include <fstream>
 #include <list>
+#include <string>
 #include <cstring>
 #include <vector>
 #include <unordered_map>
+#include <mutex>
 #include <vortex.h>
 #include <assert.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+enum PerfFormat {
+  PERF_FORMAT_TEXT = 0,
+  PERF_FORMAT_JSON,
+  PERF_FORMAT_CSV
+};
 
 class ProfilingMode {
 public:
-  ProfilingMode() : perf_class_(0) {
+  ProfilingMode() : perf_class_(0), perf_format_(PERF_FORMAT_TEXT) {
     auto profiling_s = getenv("VORTEX_PROFILING");
     if (profiling_s) {
       perf_class_ = std::atoi(profiling_s);
     }
+    auto format_s = getenv("VORTEX_PERF_FORMAT");
+    if (format_s) {
+      if (0 == strcmp(format_s, "json")) {
+        perf_format_ = PERF_FORMAT_JSON;
+      } else if (0 == strcmp(format_s, "csv")) {
+        perf_format_ = PERF_FORMAT_CSV;
+      } else if (0 != strcmp(format_s, "text")) {
+        std::cout << "Warning: invalid VORTEX_PERF_FORMAT=" << format_s << ", using text" << std::endl;
+      }
+    }
   }
 
   ~ProfilingMode() {}
@@ -37,26 +60,58 @@ public:
     return perf_class_;
   }
 
+  PerfFormat perf_format() const {
+    return perf_format_;
+  }
+
 private:
   int perf_class_;
+  PerfFormat perf_format_;
 };
 
-int get_profiling_mode() {
+static ProfilingMode& profiling_mode() {
   static ProfilingMode gProfilingMode;
-  return gProfilingMode.perf_class();
+  return gProfilingMode;
 }
 
-extern int vx_upload_kernel_bytes(vx_device_h hdevice, const void* content, uint64_t size, vx_buffer_h* hbuffer) {
-  if (nullptr == hdevice || nullptr == content || size <= 8 || nullptr == hbuffer)
-    return -1;
+int get_profiling_mode() {
+  return profiling_mode().perf_class();
+}
 
-  auto bytes = reinterpret_cast<const uint64_t*>(content);
+// map a file read-only, its pages are uploaded straight from the page cache
+static const void* map_file(const char* filename, uint64_t* size) {
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    std::cout << "error: " << filename << " not found" << std::endl;
+    return nullptr;
+  }
+  struct stat st;
+  void* addr = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size != 0) {
+    addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr != MAP_FAILED) {
+      madvise(addr, st.st_size, MADV_SEQUENTIAL);
+      *size = st.st_size;
+    }
+  }
+  close(fd);
+  if (addr == MAP_FAILED) {
+    std::cout << "error: cannot map " << filename << std::endl;
+    return nullptr;
+  }
+  return addr;
+}
 
-  auto min_vma = *bytes++;
-  auto max_vma = *bytes++;
-  auto bin_size = size - 2 * 8;
-  auto runtime_size = (max_vma - min_vma);
+// zero the read-write region of an image, on first upload and on reuse alike
+static int clear_kernel_data(vx_buffer_h hbuffer, uint64_t bin_size, uint64_t runtime_size) {
+  uint64_t rw_size = runtime_size - bin_size;
+  if (rw_size == 0)
+    return 0;
+  std::vector<uint8_t> zeros(rw_size, 0);
+  return vx_copy_to_dev(hbuffer, zeros.data(), bin_size, rw_size);
+}
 
+static int upload_kernel_image(vx_device_h hdevice, const void* bytes, uint64_t bin_size, uint64_t min_vma, uint64_t runtime_size, vx_buffer_h* hbuffer) {
   vx_buffer_h _hbuffer;
   CHECK_ERR(vx_mem_reserve(hdevice, min_vma, runtime_size, 0, &_hbuffer), {
     return err;
@@ -79,33 +134,232 @@ extern int vx_upload_kernel_bytes(vx_device_h hdevice, const void* content, uint
     return err;
   });
 
+  CHECK_ERR(clear_kernel_data(_hbuffer, bin_size, runtime_size), {
+    vx_mem_free(_hbuffer);
+    return err;
+  });
+
   *hbuffer = _hbuffer;
 
   return 0;
 }
 
+// Resident kernel images.
+// An uploaded image stays reserved on its device after the application frees
+// it, so that uploading the same image again only re-initializes its
+// read-write region. The binary region is mapped read-only and is reused as is.
+// Images are keyed by content hash, confirmed against a copy of the image,
+// and kernel files also by their identity (device, inode, size and
+// modification time) so that they are not re-read.
+// Set VORTEX_KERNEL_CACHE=0 to disable.
+class KernelCache {
+public:
+  KernelCache() : enabled_(true) {
+    auto enabled_s = getenv("VORTEX_KERNEL_CACHE");
+    if (enabled_s) {
+      enabled_ = (std::atoi(enabled_s) != 0);
+    }
+  }
+
+  ~KernelCache() {}
+
+  bool enabled() const {
+    return enabled_;
+  }
+
+  int upload_file(vx_device_h hdevice, const char* filename, vx_buffer_h* hbuffer) {
+    std::string file_id;
+    struct stat st;
+    if (stat(filename, &st) == 0) {
+      file_id = std::to_string(st.st_dev) + ":" + std::to_string(st.st_ino) + ":"
+              + std::to_string(st.st_size) + ":" + std::to_string(st.st_mtim.tv_sec) + "."
+              + std::to_string(st.st_mtim.tv_nsec);
+      std::lock_guard<std::recursive_mutex> lock(mutex_);
+      for (auto& entry : entries_) {
+        if (entry.hdevice == hdevice && entry.file_id == file_id)
+          return this->acquire(entry, hbuffer);
+      }
+    }
+
+    uint64_t size = 0;
+    auto content = map_file(filename, &size);
+    if (nullptr == content)
+      return -1;
+
+    int err = this->upload(hdevice, content, size, file_id, hbuffer);
+
+    munmap((void*)content, size);
+
+    return err;
+  }
+
+  int upload(vx_device_h hdevice, const void* content, uint64_t size, const std::string& file_id, vx_buffer_h* hbuffer) {
+    auto bytes = reinterpret_cast<const uint64_t*>(content);
+    auto min_vma = bytes[0];
+    auto max_vma = bytes[1];
+    auto bin_size = size - 2 * 8;
+    auto runtime_size = (max_vma - min_vma);
+    auto hash = hash_bytes(content, size);
+
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+
+    for (auto& entry : entries_) {
+      if (entry.hdevice == hdevice
+       && entry.hash == hash
+       && entry.image.size() == size
+       && entry.runtime_size == runtime_size
+       && 0 == memcmp(entry.image.data(), content, size)) {
+        if (!file_id.empty()) {
+          entry.file_id = file_id;
+        }
+        return this->acquire(entry, hbuffer);
+      }
+    }
+
+    // kernels share their load address, evict idle images from the device
+    this->evict(hdevice, false);
+
+    vx_buffer_h _hbuffer;
+    CHECK_ERR(upload_kernel_image(hdevice, bytes + 2, bin_size, min_vma, runtime_size, &_hbuffer), {
+      return err;
+    });
+
+    auto image = reinterpret_cast<const uint8_t*>(content);
+    entries_.push_back({hdevice, _hbuffer, hash, std::vector<uint8_t>(image, image + size), bin_size, runtime_size, file_id, 1});
+    DBGPRINT("KERNEL_CACHE: miss, hdevice=%p, hbuffer=%p, hash=0x%lx\n", hdevice, _hbuffer, hash);
+
+    *hbuffer = _hbuffer;
+    return 0;
+  }
+
+  // returns true if the buffer is a cached kernel image
+  bool release(vx_buffer_h hbuffer) {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    for (auto& entry : entries_) {
+      if (entry.hbuffer == hbuffer) {
+        if (entry.users != 0) {
+          --entry.users;
+        }
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // free the device resident images, all of them if forced
+  void evict(vx_device_h hdevice, bool force) {
+    std::lock_guard<std::recursive_mutex> lock(mutex_);
+    for (auto it = entries_.begin(); it != entries_.end();) {
+      if (it->hdevice != hdevice || (it->users != 0 && !force)) {
+        ++it;
+        continue;
+      }
+      auto hbuffer = it->hbuffer;
+      it = entries_.erase(it);
+      vx_mem_free(hbuffer);
+    }
+  }
+
+private:
+
+  struct entry_t {
+    vx_device_h hdevice;
+    vx_buffer_h hbuffer;
+    uint64_t    hash;
+    std::vector<uint8_t> image;
+    uint64_t    bin_size;
+    uint64_t    runtime_size;
+    std::string file_id;
+    uint32_t    users;
+  };
+
+  int acquire(entry_t& entry, vx_buffer_h* hbuffer) {
+    if (0 == entry.users) {
+      // re-initialize the read-write region
+      CHECK_ERR(clear_kernel_data(entry.hbuffer, entry.bin_size, entry.runtime_size), {
+        return err;
+      });
+    }
+    ++entry.users;
+    DBGPRINT("KERNEL_CACHE: hit, hdevice=%p, hbuffer=%p, hash=0x%lx\n", entry.hdevice, entry.hbuffer, entry.hash);
+    *hbuffer = entry.hbuffer;
+    return 0;
+  }
+
+  // FNV-1a over 64-bit words, with an extra shift to mix the upper bits down
+  static uint64_t hash_bytes(const void* data, uint64_t size) {
+    auto bytes = reinterpret_cast<const uint8_t*>(data);
+    uint64_t hash = 0xcbf29ce484222325ull ^ size;
+    uint64_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+      uint64_t word;
+      memcpy(&word, bytes + i, 8);
+      hash = (hash ^ word) * 0x100000001b3ull;
+      hash ^= (hash >> 29);
+    }
+    for (; i < size; ++i) {
+      hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+    return hash;
+  }
+
+  std::list<entry_t> entries_;
+  std::recursive_mutex mutex_;
+  bool enabled_;
+};
+
+static KernelCache& kernel_cache() {
+  static KernelCache gKernelCache;
+  return gKernelCache;
+}
+
+bool kernel_cache_release(vx_buffer_h hbuffer) {
+  return kernel_cache().release(hbuffer);
+}
+
+void kernel_cache_evict(vx_device_h hdevice) {
+  kernel_cache().evict(hdevice, true);
+}
+
+extern int vx_upload_kernel_bytes(vx_device_h hdevice, const void* content, uint64_t size, vx_buffer_h* hbuffer) {
+  if (nullptr == hdevice || nullptr == content || size <= 16 || nullptr == hbuffer)
+    return -1;
+
+  auto& cache = kernel_cache();
+  if (cache.enabled())
+    return cache.upload(hdevice, content, size, "", hbuffer);
+
+  auto bytes = reinterpret_cast<const uint64_t*>(content);
+
+  auto min_vma = bytes[0];
+  auto max_vma = bytes[1];
+  auto bin_size = size - 2 * 8;
+  auto runtime_size = (max_vma - min_vma);
+
+  return upload_kernel_image(hdevice, bytes + 2, bin_size, min_vma, runtime_size, hbuffer);
+}
+
 extern int vx_upload_kernel_file(vx_device_h hdevice, const char* filename, vx_buffer_h* hbuffer) {
   if (nullptr == hdevice || nullptr == filename || nullptr == hbuffer)
     return -1;
 
-  std::ifstream ifs(filename);
-  if (!ifs) {
-    std::cout << "error: " << filename << " not found" << std::endl;
-    return -1;
-  }
+  auto& cache = kernel_cache();
+  if (cache.enabled())
+    return cache.upload_file(hdevice, filename, hbuffer);
 
-  // read file content
-  ifs.seekg(0, ifs.end);
-  auto size = ifs.tellg();
-  std::vector<char> content(size);
-  ifs.seekg(0, ifs.beg);
-  ifs.read(content.data(), size);
+  uint64_t size = 0;
+  auto content = map_file(filename, &size);
+  if (nullptr == content)
+    return -1;
 
   // upload buffer
-  CHECK_ERR(vx_upload_kernel_bytes(hdevice, content.data(), size, hbuffer), {
+  CHECK_ERR(vx_upload_kernel_bytes(hdevice, content, size, hbuffer), {
+    munmap((void*)content, size);
     return err;
   });
 
+  munmap((void*)content, size);
+
   return 0;
 }
 
@@ -133,30 +387,220 @@ extern int vx_upload_file(vx_device_h hdevice, const char* filename, vx_buffer_h
   if (nullptr == hdevice || nullptr == filename || nullptr == hbuffer)
     return -1;
 
-  std::ifstream ifs(filename);
-  if (!ifs) {
-    std::cout << "error: " << filename << " not found" << std::endl;
+  uint64_t size = 0;
+  auto content = map_file(filename, &size);
+  if (nullptr == content)
     return -1;
-  }
-
-  // read file content
-  ifs.seekg(0, ifs.end);
-  auto size = ifs.tellg();
-  std::vector<char> content(size);
-  ifs.seekg(0, ifs.beg);
-  ifs.read(content.data(), size);
 
   // upload buffer
-  CHECK_ERR(vx_upload_bytes(hdevice, content.data(), size, hbuffer), {
+  CHECK_ERR(vx_upload_bytes(hdevice, content, size, hbuffer), {
+    munmap((void*)content, size);
     return err;
   });
 
+  munmap((void*)content, size);
+
   return 0;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 
+// raw counters of a snapshot record, in export order
+template <typename F>
+static void visit_counters(const vx_mpm_core_t& core, const F& f) {
+  f("cycles", core.cycles);
+  f("instrs", core.instrs);
+  f("sched_idles", core.sched_idles);
+  f("sched_stalls", core.sched_stalls);
+  f("ibuffer_stalls", core.ibuffer_stalls);
+  f("scrb_stalls", core.scrb_stalls);
+  f("opds_stalls", core.opds_stalls);
+  f("scrb_alu", core.scrb_alu);
+  f("scrb_fpu", core.scrb_fpu);
+  f("scrb_lsu", core.scrb_lsu);
+  f("scrb_sfu", core.scrb_sfu);
+  f("scrb_csrs", core.scrb_csrs);
+  f("scrb_wctl", core.scrb_wctl);
+  f("ifetches", core.ifetches);
+  f("loads", core.loads);
+  f("stores", core.stores);
+  f("ifetch_lat", core.ifetch_lat);
+  f("load_lat", core.load_lat);
+  auto visit_cache = [&](const char* prefix, const vx_mpm_cache_t& cache) {
+    std::string name(prefix);
+    f((name + "_reads").c_str(), cache.reads);
+    f((name + "_writes").c_str(), cache.writes);
+    f((name + "_read_misses").c_str(), cache.read_misses);
+    f((name + "_write_misses").c_str(), cache.write_misses);
+    f((name + "_bank_stalls").c_str(), cache.bank_stalls);
+    f((name + "_mshr_stalls").c_str(), cache.mshr_stalls);
+    f((name + "_prefetches").c_str(), cache.prefetches);
+    f((name + "_prefetch_useful").c_str(), cache.prefetch_useful);
+    f((name + "_prefetch_late").c_str(), cache.prefetch_late);
+    f((name + "_prefetch_polluting").c_str(), cache.prefetch_polluting);
+  };
+  visit_cache("icache", core.icache);
+  visit_cache("dcache", core.dcache);
+  visit_cache("l2cache", core.l2cache);
+  visit_cache("l3cache", core.l3cache);
+  f("lmem_reads", core.lmem_reads);
+  f("lmem_writes", core.lmem_writes);
+  f("lmem_bank_stalls", core.lmem_bank_stalls);
+  f("coalescer_misses", core.coalescer_misses);
+  f("mem_reads", core.mem_reads);
+  f("mem_writes", core.mem_writes);
+  f("mem_lat", core.mem_lat);
+  f("mem_bank_stalls", core.mem_bank_stalls);
+}
+
+// metrics derived from a snapshot record, in export order
+template <typename F>
+static void visit_metrics(const vx_mpm_core_t& core, const F& f) {
+  auto ratio = [](uint64_t part, uint64_t total)->double {
+    if (total == 0)
+      return 0;
+    return double(part) / double(total);
+  };
+  f("ipc", ratio(core.instrs, core.cycles));
+  f("ifetch_latency", ratio(core.ifetch_lat, core.ifetches));
+  f("load_latency", ratio(core.load_lat, core.loads));
+  auto visit_cache = [&](const char* prefix, const vx_mpm_cache_t& cache) {
+    std::string name(prefix);
+    f((name + "_read_miss_rate").c_str(), ratio(cache.read_misses, cache.reads));
+    f((name + "_write_miss_rate").c_str(), ratio(cache.write_misses, cache.writes));
+    f((name + "_prefetch_accuracy").c_str(), ratio(cache.prefetch_useful + cache.prefetch_late, cache.prefetches));
+  };
+  visit_cache("icache", core.icache);
+  visit_cache("dcache", core.dcache);
+  visit_cache("l2cache", core.l2cache);
+  visit_cache("l3cache", core.l3cache);
+  f("coalescer_miss_rate", ratio(core.coalescer_misses, core.dcache.reads + core.dcache.writes));
+  f("mem_latency", ratio(core.mem_lat, core.mem_reads));
+}
+
+// device-wide totals: counters are summed and cycles is the slowest core's.
+// shared counters are normalized as in the text report: every core reports
+// its cluster's l2cache, so the sum is averaged over the cores, l3cache and
+// memory counters are device-wide and taken from core 0.
+static vx_mpm_core_t aggregate_counters(const std::vector<vx_mpm_core_t>& cores) {
+  static_assert(sizeof(vx_mpm_core_t) % sizeof(uint64_t) == 0, "invalid vx_mpm_core_t layout");
+  static_assert(sizeof(vx_mpm_cache_t) % sizeof(uint64_t) == 0, "invalid vx_mpm_cache_t layout");
+  vx_mpm_core_t total;
+  memset(&total, 0, sizeof(vx_mpm_core_t));
+  if (cores.empty())
+    return total;
+  uint64_t max_cycles = 0;
+  for (auto& core : cores) {
+    auto src = reinterpret_cast<const uint64_t*>(&core);
+    auto dst = reinterpret_cast<uint64_t*>(&total);
+    for (size_t i = 0; i < sizeof(vx_mpm_core_t) / sizeof(uint64_t); ++i) {
+      dst[i] += src[i];
+    }
+    max_cycles = std::max<uint64_t>(core.cycles, max_cycles);
+  }
+  total.cycles = max_cycles;
+  auto l2cache = reinterpret_cast<uint64_t*>(&total.l2cache);
+  for (size_t i = 0; i < sizeof(vx_mpm_cache_t) / sizeof(uint64_t); ++i) {
+    l2cache[i] /= cores.size();
+  }
+  total.l3cache = cores[0].l3cache;
+  total.mem_reads = cores[0].mem_reads;
+  total.mem_writes = cores[0].mem_writes;
+  total.mem_lat = cores[0].mem_lat;
+  total.mem_bank_stalls = cores[0].mem_bank_stalls;
+  return total;
+}
+
+static int dump_perf_json(vx_device_h hdevice, FILE* stream) {
+  uint64_t num_cores;
+  CHECK_ERR(vx_dev_caps(hdevice, VX_CAPS_NUM_CORES, &num_cores), {
+    return err;
+  });
+
+  std::vector<vx_mpm_core_t> cores(num_cores);
+  CHECK_ERR(vx_mpm_snapshot(hdevice, cores.data()), {
+    return err;
+  });
+
+  auto dump_record = [&](const vx_mpm_core_t& core, const char* indent) {
+    const char* sep = "";
+    fprintf(stream, "%s\"counters\": {", indent);
+    visit_counters(core, [&](const char* name, uint64_t value) {
+      fprintf(stream, "%s\"%s\": %" PRIu64, sep, name, value);
+      sep = ", ";
+    });
+    fprintf(stream, "},\n");
+    sep = "";
+    fprintf(stream, "%s\"metrics\": {", indent);
+    visit_metrics(core, [&](const char* name, double value) {
+      fprintf(stream, "%s\"%s\": %g", sep, name, value);
+      sep = ", ";
+    });
+    fprintf(stream, "}\n");
+  };
+
+  fprintf(stream, "{\n");
+  fprintf(stream, "  \"perf_class\": %d,\n", get_profiling_mode());
+  fprintf(stream, "  \"num_cores\": %" PRIu64 ",\n", num_cores);
+  fprintf(stream, "  \"cores\": [\n");
+  for (uint32_t core_id = 0; core_id < num_cores; ++core_id) {
+    fprintf(stream, "    {\n");
+    fprintf(stream, "      \"core\": %d,\n", core_id);
+    dump_record(cores.at(core_id), "      ");
+    fprintf(stream, "    }%s\n", (core_id + 1 < num_cores) ? "," : "");
+  }
+  fprintf(stream, "  ],\n");
+  fprintf(stream, "  \"total\": {\n");
+  dump_record(aggregate_counters(cores), "    ");
+  fprintf(stream, "  }\n");
+  fprintf(stream, "}\n");
+
+  fflush(stream);
+
+  return 0;
+}
+
+static int dump_perf_csv(vx_device_h hdevice, FILE* stream) {
+  uint64_t num_cores;
+  CHECK_ERR(vx_dev_caps(hdevice, VX_CAPS_NUM_CORES, &num_cores), {
+    return err;
+  });
+
+  std::vector<vx_mpm_core_t> cores(num_cores);
+  CHECK_ERR(vx_mpm_snapshot(hdevice, cores.data()), {
+    return err;
+  });
+
+  auto dump_record = [&](const vx_mpm_core_t& core, const std::string& scope) {
+    visit_counters(core, [&](const char* name, uint64_t value) {
+      fprintf(stream, "%s,%s,%" PRIu64 "\n", scope.c_str(), name, value);
+    });
+    visit_metrics(core, [&](const char* name, double value) {
+      fprintf(stream, "%s,%s,%g\n", scope.c_str(), name, value);
+    });
+  };
+
+  fprintf(stream, "core,name,value\n");
+  for (uint32_t core_id = 0; core_id < num_cores; ++core_id) {
+    dump_record(cores.at(core_id), std::to_string(core_id));
+  }
+  dump_record(aggregate_counters(cores), "total");
+
+  fflush(stream);
+
+  return 0;
+}
+
 extern int vx_dump_perf(vx_device_h hdevice, FILE* stream) {
+  switch (profiling_mode().perf_format()) {
+  case PERF_FORMAT_JSON:
+    return dump_perf_json(hdevice, stream);
+  case PERF_FORMAT_CSV:
+    return dump_perf_csv(hdevice, stream);
+  default:
+    break;
+  }
+
   uint64_t total_instrs = 0;
   uint64_t total_cycles = 0;
   uint64_t max_cycles = 0;
@@ -200,6 +644,10 @@ extern int vx_dump_perf(vx_device_h hdevice, FILE* stream) {
   uint64_t l2cache_write_misses = 0;
   uint64_t l2cache_bank_stalls = 0;
   uint64_t l2cache_mshr_stalls = 0;
+  uint64_t l2cache_prefetches = 0;
+  uint64_t l2cache_prefetch_useful = 0;
+  uint64_t l2cache_prefetch_late = 0;
+  uint64_t l2cache_prefetch_polluting = 0;
   // PERF: l3cache
   uint64_t l3cache_reads = 0;
   uint64_t l3cache_writes = 0;
@@ -236,327 +684,139 @@ extern int vx_dump_perf(vx_device_h hdevice, FILE* stream) {
 
   auto perf_class = get_profiling_mode();
 
-  for (unsigned core_id = 0; core_id < num_cores; ++core_id) {
-    uint64_t cycles_per_core;
-    CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MCYCLE, core_id, &cycles_per_core), {
-      return err;
-    });
+  // fetch all counters at once
+  std::vector<vx_mpm_core_t> mpm(num_cores);
+  CHECK_ERR(vx_mpm_snapshot(hdevice, mpm.data()), {
+    return err;
+  });
 
-    uint64_t instrs_per_core;
-    CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MINSTRET, core_id, &instrs_per_core), {
-      return err;
-    });
+  for (unsigned core_id = 0; core_id < num_cores; ++core_id) {
+    auto& core = mpm.at(core_id);
+    uint64_t cycles_per_core = core.cycles;
+    uint64_t instrs_per_core = core.instrs;
 
-    switch (perf_class) {
-    case VX_DCR_MPM_CLASS_CORE: {
+    if (perf_class == VX_DCR_MPM_CLASS_CORE || perf_class == VX_DCR_MPM_CLASS_ALL) {
       // PERF: pipeline
-      // scheduler idles
-      {
-        uint64_t sched_idles_per_core;
-        CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_SCHED_ID, core_id, &sched_idles_per_core), {
-          return err;
-        });
-        if (num_cores > 1) {
-          int idles_percent_per_core = calcAvgPercent(sched_idles_per_core, cycles_per_core);
-          fprintf(stream, "PERF: core%d: scheduler idle=%ld (%d%%)\n", core_id, sched_idles_per_core, idles_percent_per_core);
-        }
-        sched_idles += sched_idles_per_core;
-      }
-      // scheduler stalls
-      {
-        uint64_t sched_stalls_per_core;
-        CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_SCHED_ST, core_id, &sched_stalls_per_core), {
-          return err;
-        });
-        if (num_cores > 1) {
-          int stalls_percent_per_core = calcAvgPercent(sched_stalls_per_core, cycles_per_core);
-          fprintf(stream, "PERF: core%d: scheduler stalls=%ld (%d%%)\n", core_id, sched_stalls_per_core, stalls_percent_per_core);
-        }
-        sched_stalls += sched_stalls_per_core;
-      }
-      // ibuffer stalls
-      {
-        uint64_t ibuffer_stalls_per_core;
-        CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_IBUF_ST, core_id, &ibuffer_stalls_per_core), {
-          return err;
-        });
-        if (num_cores > 1) {
-          int ibuffer_percent_per_core = calcAvgPercent(ibuffer_stalls_per_core, cycles_per_core);
-          fprintf(stream, "PERF: core%d: ibuffer stalls=%ld (%d%%)\n", core_id, ibuffer_stalls_per_core, ibuffer_percent_per_core);
-        }
-        ibuffer_stalls += ibuffer_stalls_per_core;
-      }
-      // scoreboard stalls
-      {
-        uint64_t scrb_stalls_per_core;
-        CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_SCRB_ST, core_id, &scrb_stalls_per_core), {
-          return err;
-        });
-        uint64_t scrb_alu_per_core;
-        CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_SCRB_ALU, core_id, &scrb_alu_per_core), {
-          return err;
-        });
-        uint64_t scrb_fpu_per_core;
-        CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_SCRB_FPU, core_id, &scrb_fpu_per_core), {
-          return err;
-        });
-        uint64_t scrb_lsu_per_core;
-        CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_SCRB_LSU, core_id, &scrb_lsu_per_core), {
-          return err;
-        });
-        uint64_t scrb_csrs_per_core;
-        CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_SCRB_CSRS, core_id, &scrb_csrs_per_core), {
-          return err;
-        });
-        uint64_t scrb_wctl_per_core;
-        CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_SCRB_WCTL, core_id, &scrb_wctl_per_core), {
-          return err;
-        });
-        scrb_alu += scrb_alu_per_core;
-        scrb_fpu += scrb_fpu_per_core;
-        scrb_lsu += scrb_lsu_per_core;
-        scrb_csrs += scrb_csrs_per_core;
-        scrb_wctl += scrb_wctl_per_core;
-        if (num_cores > 1) {
-          uint64_t scrb_total = scrb_alu_per_core + scrb_fpu_per_core + scrb_lsu_per_core + scrb_csrs_per_core + scrb_wctl_per_core;
-          int scrb_percent_per_core = calcAvgPercent(scrb_stalls_per_core, cycles_per_core);
-          fprintf(stream, "PERF: core%d: scoreboard stalls=%ld (%d%%) (alu=%d%%, fpu=%d%%, lsu=%d%%, csrs=%d%%, wctl=%d%%)\n"
-          , core_id
-          , scrb_stalls_per_core
-          , scrb_percent_per_core
-          , calcAvgPercent(scrb_alu_per_core, scrb_total)
-          , calcAvgPercent(scrb_fpu_per_core, scrb_total)
-          , calcAvgPercent(scrb_lsu_per_core, scrb_total)
-          , calcAvgPercent(scrb_csrs_per_core, scrb_total)
-          , calcAvgPercent(scrb_wctl_per_core, scrb_total)
-          );
-        }
-        scrb_stalls += scrb_stalls_per_core;
-      }
-      // operands stalls
-      {
-        uint64_t opds_stalls_per_core;
-        CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_OPDS_ST, core_id, &opds_stalls_per_core), {
-          return err;
-        });
-        if (num_cores > 1) {
-          int opds_percent_per_core = calcAvgPercent(opds_stalls_per_core, cycles_per_core);
-          fprintf(stream, "PERF: core%d: operands stalls=%ld (%d%%)\n", core_id, opds_stalls_per_core, opds_percent_per_core);
-        }
-        opds_stalls += opds_stalls_per_core;
-      }
-      // PERF: memory
-      // ifetches
-      {
-        uint64_t ifetches_per_core;
-        CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_IFETCHES, core_id, &ifetches_per_core), {
-          return err;
-        });
-        if (num_cores > 1) fprintf(stream, "PERF: core%d: ifetches=%ld\n", core_id, ifetches_per_core);
-        ifetches += ifetches_per_core;
-
-        uint64_t ifetch_lat_per_core;
-        CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_IFETCH_LT, core_id, &ifetch_lat_per_core), {
-          return err;
-        });
-        if (num_cores > 1) {
-          int mem_avg_lat = caclAverage(ifetch_lat_per_core, ifetches_per_core);
-          fprintf(stream, "PERF: core%d: ifetch latency=%d cycles\n", core_id, mem_avg_lat);
-        }
-        ifetch_lat += ifetch_lat_per_core;
-      }
-      // loads
-      {
-        uint64_t loads_per_core;
-        CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_LOADS, core_id, &loads_per_core), {
-          return err;
-        });
-        if (num_cores > 1) fprintf(stream, "PERF: core%d: loads=%ld\n", core_id, loads_per_core);
-        loads += loads_per_core;
-
-        uint64_t load_lat_per_core;
-        CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_LOAD_LT, core_id, &load_lat_per_core), {
-          return err;
-        });
-        if (num_cores > 1) {
-          int mem_avg_lat = caclAverage(load_lat_per_core, loads_per_core);
-          fprintf(stream, "PERF: core%d: load latency=%d cycles\n", core_id, mem_avg_lat);
-        }
-        load_lat += load_lat_per_core;
-      }
-      // stores
-      {
-        uint64_t stores_per_core;
-        CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_STORES, core_id, &stores_per_core), {
-          return err;
-        });
-        if (num_cores > 1) fprintf(stream, "PERF: core%d: stores=%ld\n", core_id, stores_per_core);
-        stores += stores_per_core;
+      if (num_cores > 1) {
+        int idles_percent_per_core = calcAvgPercent(core.sched_idles, cycles_per_core);
+        int stalls_percent_per_core = calcAvgPercent(core.sched_stalls, cycles_per_core);
+        int ibuffer_percent_per_core = calcAvgPercent(core.ibuffer_stalls, cycles_per_core);
+        uint64_t scrb_total = core.scrb_alu + core.scrb_fpu + core.scrb_lsu + core.scrb_csrs + core.scrb_wctl;
+        int scrb_percent_per_core = calcAvgPercent(core.scrb_stalls, cycles_per_core);
+        int opds_percent_per_core = calcAvgPercent(core.opds_stalls, cycles_per_core);
+        fprintf(stream, "PERF: core%d: scheduler idle=%ld (%d%%)\n", core_id, core.sched_idles, idles_percent_per_core);
+        fprintf(stream, "PERF: core%d: scheduler stalls=%ld (%d%%)\n", core_id, core.sched_stalls, stalls_percent_per_core);
+        fprintf(stream, "PERF: core%d: ibuffer stalls=%ld (%d%%)\n", core_id, core.ibuffer_stalls, ibuffer_percent_per_core);
+        fprintf(stream, "PERF: core%d: scoreboard stalls=%ld (%d%%) (alu=%d%%, fpu=%d%%, lsu=%d%%, csrs=%d%%, wctl=%d%%)\n"
+        , core_id
+        , core.scrb_stalls
+        , scrb_percent_per_core
+        , calcAvgPercent(core.scrb_alu, scrb_total)
+        , calcAvgPercent(core.scrb_fpu, scrb_total)
+        , calcAvgPercent(core.scrb_lsu, scrb_total)
+        , calcAvgPercent(core.scrb_csrs, scrb_total)
+        , calcAvgPercent(core.scrb_wctl, scrb_total)
+        );
+        fprintf(stream, "PERF: core%d: operands stalls=%ld (%d%%)\n", core_id, core.opds_stalls, opds_percent_per_core);
+        // PERF: memory
+        fprintf(stream, "PERF: core%d: ifetches=%ld\n", core_id, core.ifetches);
+        fprintf(stream, "PERF: core%d: ifetch latency=%d cycles\n", core_id, int(caclAverage(core.ifetch_lat, core.ifetches)));
+        fprintf(stream, "PERF: core%d: loads=%ld\n", core_id, core.loads);
+        fprintf(stream, "PERF: core%d: load latency=%d cycles\n", core_id, int(caclAverage(core.load_lat, core.loads)));
+        fprintf(stream, "PERF: core%d: stores=%ld\n", core_id, core.stores);
       }
-    } break;
-    case VX_DCR_MPM_CLASS_MEM: {
+      sched_idles += core.sched_idles;
+      sched_stalls += core.sched_stalls;
+      ibuffer_stalls += core.ibuffer_stalls;
+      scrb_stalls += core.scrb_stalls;
+      scrb_alu += core.scrb_alu;
+      scrb_fpu += core.scrb_fpu;
+      scrb_lsu += core.scrb_lsu;
+      scrb_csrs += core.scrb_csrs;
+      scrb_wctl += core.scrb_wctl;
+      opds_stalls += core.opds_stalls;
+      ifetches += core.ifetches;
+      ifetch_lat += core.ifetch_lat;
+      loads += core.loads;
+      load_lat += core.load_lat;
+      stores += core.stores;
+    }
+    if (perf_class == VX_DCR_MPM_CLASS_MEM || perf_class == VX_DCR_MPM_CLASS_ALL) {
       if (lmem_enable) {
         // PERF: lmem
-        uint64_t lmem_reads;
-        CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_LMEM_READS, core_id, &lmem_reads), {
-          return err;
-        });
-        uint64_t lmem_writes;
-        CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_LMEM_WRITES, core_id, &lmem_writes), {
-          return err;
-        });
-        uint64_t lmem_bank_stalls;
-        CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_LMEM_BANK_ST, core_id, &lmem_bank_stalls), {
-          return err;
-        });
-        int lmem_bank_utilization = calcAvgPercent(lmem_reads + lmem_writes, lmem_reads + lmem_writes + lmem_bank_stalls);
-        fprintf(stream, "PERF: core%d: lmem reads=%ld\n", core_id, lmem_reads);
-        fprintf(stream, "PERF: core%d: lmem writes=%ld\n", core_id, lmem_writes);
-        fprintf(stream, "PERF: core%d: lmem bank stalls=%ld (utilization=%d%%)\n", core_id, lmem_bank_stalls, lmem_bank_utilization);
+        int lmem_bank_utilization = calcAvgPercent(core.lmem_reads + core.lmem_writes, core.lmem_reads + core.lmem_writes + core.lmem_bank_stalls);
+        fprintf(stream, "PERF: core%d: lmem reads=%ld\n", core_id, core.lmem_reads);
+        fprintf(stream, "PERF: core%d: lmem writes=%ld\n", core_id, core.lmem_writes);
+        fprintf(stream, "PERF: core%d: lmem bank stalls=%ld (utilization=%d%%)\n", core_id, core.lmem_bank_stalls, lmem_bank_utilization);
       }
 
       if (icache_enable) {
         // PERF: Icache
-        uint64_t icache_reads;
-        CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_ICACHE_READS, core_id, &icache_reads), {
-          return err;
-        });
-        uint64_t icache_read_misses;
-        CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_ICACHE_MISS_R, core_id, &icache_read_misses), {
-          return err;
-        });
-        uint64_t icache_mshr_stalls;
-        CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_ICACHE_MSHR_ST, core_id, &icache_mshr_stalls), {
-          return err;
-        });
-        int icache_read_hit_ratio = calcRatio(icache_read_misses, icache_reads);
-        int mshr_utilization = calcAvgPercent(icache_read_misses, icache_read_misses + icache_mshr_stalls);
-        fprintf(stream, "PERF: core%d: icache reads=%ld\n", core_id, icache_reads);
-        fprintf(stream, "PERF: core%d: icache read misses=%ld (hit ratio=%d%%)\n", core_id, icache_read_misses, icache_read_hit_ratio);
-        fprintf(stream, "PERF: core%d: icache mshr stalls=%ld (utilization=%d%%)\n", core_id, icache_mshr_stalls, mshr_utilization);
+        auto& icache = core.icache;
+        int icache_read_hit_ratio = calcRatio(icache.read_misses, icache.reads);
+        int mshr_utilization = calcAvgPercent(icache.read_misses, icache.read_misses + icache.mshr_stalls);
+        fprintf(stream, "PERF: core%d: icache reads=%ld\n", core_id, icache.reads);
+        fprintf(stream, "PERF: core%d: icache read misses=%ld (hit ratio=%d%%)\n", core_id, icache.read_misses, icache_read_hit_ratio);
+        fprintf(stream, "PERF: core%d: icache mshr stalls=%ld (utilization=%d%%)\n", core_id, icache.mshr_stalls, mshr_utilization);
       }
 
       uint64_t dcache_requests_per_core = 0;
 
       if (dcache_enable) {
         // PERF: Dcache
-        uint64_t dcache_reads;
-        CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_DCACHE_READS, core_id, &dcache_reads), {
-          return err;
-        });
-        uint64_t dcache_writes;
-        CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_DCACHE_WRITES, core_id, &dcache_writes), {
-          return err;
-        });
-        dcache_requests_per_core += dcache_reads + dcache_writes;
-        uint64_t dcache_read_misses;
-        CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_DCACHE_MISS_R, core_id, &dcache_read_misses), {
-          return err;
-        });
-        uint64_t dcache_write_misses;
-        CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_DCACHE_MISS_W, core_id, &dcache_write_misses), {
-          return err;
-        });
-        uint64_t dcache_bank_stalls;
-        CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_DCACHE_BANK_ST, core_id, &dcache_bank_stalls), {
-          return err;
-        });
-        uint64_t dcache_mshr_stalls;
-        CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_DCACHE_MSHR_ST, core_id, &dcache_mshr_stalls), {
-          return err;
-        });
-        int dcache_read_hit_ratio = calcRatio(dcache_read_misses, dcache_reads);
-        int dcache_write_hit_ratio = calcRatio(dcache_write_misses, dcache_writes);
-        int dcache_bank_utilization = calcAvgPercent(dcache_reads + dcache_writes, dcache_reads + dcache_writes + dcache_bank_stalls);
-        int mshr_utilization = calcAvgPercent(dcache_read_misses + dcache_write_misses, dcache_read_misses + dcache_write_misses + dcache_mshr_stalls);
-        fprintf(stream, "PERF: core%d: dcache reads=%ld\n", core_id, dcache_reads);
-        fprintf(stream, "PERF: core%d: dcache writes=%ld\n", core_id, dcache_writes);
-        fprintf(stream, "PERF: core%d: dcache read misses=%ld (hit ratio=%d%%)\n", core_id, dcache_read_misses, dcache_read_hit_ratio);
-        fprintf(stream, "PERF: core%d: dcache write misses=%ld (hit ratio=%d%%)\n", core_id, dcache_write_misses, dcache_write_hit_ratio);
-        fprintf(stream, "PERF: core%d: dcache bank stalls=%ld (utilization=%d%%)\n", core_id, dcache_bank_stalls, dcache_bank_utilization);
-        fprintf(stream, "PERF: core%d: dcache mshr stalls=%ld (utilization=%d%%)\n", core_id, dcache_mshr_stalls, mshr_utilization);
+        auto& dcache = core.dcache;
+        dcache_requests_per_core += dcache.reads + dcache.writes;
+        int dcache_read_hit_ratio = calcRatio(dcache.read_misses, dcache.reads);
+        int dcache_write_hit_ratio = calcRatio(dcache.write_misses, dcache.writes);
+        int dcache_bank_utilization = calcAvgPercent(dcache.reads + dcache.writes, dcache.reads + dcache.writes + dcache.bank_stalls);
+        int mshr_utilization = calcAvgPercent(dcache.read_misses + dcache.write_misses, dcache.read_misses + dcache.write_misses + dcache.mshr_stalls);
+        fprintf(stream, "PERF: core%d: dcache reads=%ld\n", core_id, dcache.reads);
+        fprintf(stream, "PERF: core%d: dcache writes=%ld\n", core_id, dcache.writes);
+        fprintf(stream, "PERF: core%d: dcache read misses=%ld (hit ratio=%d%%)\n", core_id, dcache.read_misses, dcache_read_hit_ratio);
+        fprintf(stream, "PERF: core%d: dcache write misses=%ld (hit ratio=%d%%)\n", core_id, dcache.write_misses, dcache_write_hit_ratio);
+        fprintf(stream, "PERF: core%d: dcache bank stalls=%ld (utilization=%d%%)\n", core_id, dcache.bank_stalls, dcache_bank_utilization);
+        fprintf(stream, "PERF: core%d: dcache mshr stalls=%ld (utilization=%d%%)\n", core_id, dcache.mshr_stalls, mshr_utilization);
+        if (dcache.prefetches != 0) {
+          // useful and late prefetches both served a demand miss
+          int prefetch_accuracy = calcAvgPercent(dcache.prefetch_useful + dcache.prefetch_late, dcache.prefetches);
+          fprintf(stream, "PERF: core%d: dcache prefetches=%ld (accuracy=%d%%)\n", core_id, dcache.prefetches, prefetch_accuracy);
+          fprintf(stream, "PERF: core%d: dcache prefetch useful=%ld, late=%ld, polluting=%ld\n", core_id, dcache.prefetch_useful, dcache.prefetch_late, dcache.prefetch_polluting);
+        }
       }
 
       // PERF: coalescer
-      uint64_t coalescer_misses;
-      CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_COALESCER_MISS, core_id, &coalescer_misses), {
-        return err;
-      });
-      int coalescer_utilization = calcAvgPercent(dcache_requests_per_core - coalescer_misses, dcache_requests_per_core);
-      fprintf(stream, "PERF: core%d: coalescer misses=%ld (hit ratio=%d%%)\n", core_id, coalescer_misses, coalescer_utilization);
+      int coalescer_utilization = calcAvgPercent(dcache_requests_per_core - core.coalescer_misses, dcache_requests_per_core);
+      fprintf(stream, "PERF: core%d: coalescer misses=%ld (hit ratio=%d%%)\n", core_id, core.coalescer_misses, coalescer_utilization);
 
       if (l2cache_enable) {
         // PERF: L2cache
-        uint64_t tmp;
-        CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_L2CACHE_READS, core_id, &tmp), {
-          return err;
-        });
-        l2cache_reads += tmp;
-
-        CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_L2CACHE_WRITES, core_id, &tmp), {
-          return err;
-        });
-        l2cache_writes += tmp;
-
-        CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_L2CACHE_MISS_R, core_id, &tmp), {
-          return err;
-        });
-        l2cache_read_misses += tmp;
-
-        CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_L2CACHE_MISS_W, core_id, &tmp), {
-          return err;
-        });
-        l2cache_write_misses += tmp;
-
-        CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_L2CACHE_BANK_ST, core_id, &tmp), {
-          return err;
-        });
-        l2cache_bank_stalls += tmp;
-
-        CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_L2CACHE_MSHR_ST, core_id, &tmp), {
-          return err;
-        });
-        l2cache_mshr_stalls += tmp;
+        l2cache_reads += core.l2cache.reads;
+        l2cache_writes += core.l2cache.writes;
+        l2cache_read_misses += core.l2cache.read_misses;
+        l2cache_write_misses += core.l2cache.write_misses;
+        l2cache_bank_stalls += core.l2cache.bank_stalls;
+        l2cache_mshr_stalls += core.l2cache.mshr_stalls;
+        l2cache_prefetches += core.l2cache.prefetches;
+        l2cache_prefetch_useful += core.l2cache.prefetch_useful;
+        l2cache_prefetch_late += core.l2cache.prefetch_late;
+        l2cache_prefetch_polluting += core.l2cache.prefetch_polluting;
       }
       if (0 == core_id) {
         if (l3cache_enable) {
           // PERF: L3cache
-          CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_L3CACHE_READS, core_id, &l3cache_reads), {
-            return err;
-          });
-          CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_L3CACHE_WRITES, core_id, &l3cache_writes), {
-            return err;
-          });
-          CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_L3CACHE_MISS_R, core_id, &l3cache_read_misses), {
-            return err;
-          });
-          CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_L3CACHE_MISS_W, core_id, &l3cache_write_misses), {
-            return err;
-          });
-          CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_L3CACHE_BANK_ST, core_id, &l3cache_bank_stalls), {
-            return err;
-          });
-          CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_L3CACHE_MSHR_ST, core_id, &l3cache_mshr_stalls), {
-            return err;
-          });
+          l3cache_reads = core.l3cache.reads;
+          l3cache_writes = core.l3cache.writes;
+          l3cache_read_misses = core.l3cache.read_misses;
+          l3cache_write_misses = core.l3cache.write_misses;
+          l3cache_bank_stalls = core.l3cache.bank_stalls;
+          l3cache_mshr_stalls = core.l3cache.mshr_stalls;
         }
         // PERF: memory
-        CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_MEM_READS, core_id, &mem_reads), {
-          return err;
-        });
-        CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_MEM_WRITES, core_id, &mem_writes), {
-          return err;
-        });
-        CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_MEM_LT, core_id, &mem_lat), {
-          return err;
-        });
-        CHECK_ERR(vx_mpm_query(hdevice, VX_CSR_MPM_MEM_BANK_ST, core_id, &mem_bank_stalls), {
-          return err;
-        });
+        mem_reads = core.mem_reads;
+        mem_writes = core.mem_writes;
+        mem_lat = core.mem_lat;
+        mem_bank_stalls = core.mem_bank_stalls;
       }
-    } break;
-    default:
-      break;
     }
 
     float IPC = caclAverage(instrs_per_core, cycles_per_core);
@@ -566,8 +826,7 @@ extern int vx_dump_perf(vx_device_h hdevice, FILE* stream) {
     max_cycles = std::max<uint64_t>(cycles_per_core, max_cycles);
   }
 
-  switch (perf_class) {
-  case VX_DCR_MPM_CLASS_CORE: {
+  if (perf_class == VX_DCR_MPM_CLASS_CORE || perf_class == VX_DCR_MPM_CLASS_ALL) {
     int sched_idles_percent = calcAvgPercent(sched_idles, total_cycles);
     int sched_stalls_percent = calcAvgPercent(sched_stalls, total_cycles);
     int ibuffer_percent = calcAvgPercent(ibuffer_stalls, total_cycles);
@@ -594,8 +853,8 @@ extern int vx_dump_perf(vx_device_h hdevice, FILE* stream) {
     fprintf(stream, "PERF: stores=%ld\n", stores);
     fprintf(stream, "PERF: ifetch latency=%d cycles\n", ifetch_avg_lat);
     fprintf(stream, "PERF: load latency=%d cycles\n", load_avg_lat);
-  } break;
-  case VX_DCR_MPM_CLASS_MEM: {
+  }
+  if (perf_class == VX_DCR_MPM_CLASS_MEM || perf_class == VX_DCR_MPM_CLASS_ALL) {
     if (l2cache_enable) {
       l2cache_reads /= num_cores;
       l2cache_writes /= num_cores;
@@ -603,6 +862,10 @@ extern int vx_dump_perf(vx_device_h hdevice, FILE* stream) {
       l2cache_write_misses /= num_cores;
       l2cache_bank_stalls /= num_cores;
       l2cache_mshr_stalls /= num_cores;
+      l2cache_prefetches /= num_cores;
+      l2cache_prefetch_useful /= num_cores;
+      l2cache_prefetch_late /= num_cores;
+      l2cache_prefetch_polluting /= num_cores;
       int read_hit_ratio = calcRatio(l2cache_read_misses, l2cache_reads);
       int write_hit_ratio = calcRatio(l2cache_write_misses, l2cache_writes);
       int bank_utilization = calcAvgPercent(l2cache_reads + l2cache_writes, l2cache_reads + l2cache_writes + l2cache_bank_stalls);
@@ -613,6 +876,11 @@ extern int vx_dump_perf(vx_device_h hdevice, FILE* stream) {
       fprintf(stream, "PERF: l2cache write misses=%ld (hit ratio=%d%%)\n", l2cache_write_misses, write_hit_ratio);
       fprintf(stream, "PERF: l2cache bank stalls=%ld (utilization=%d%%)\n", l2cache_bank_stalls, bank_utilization);
       fprintf(stream, "PERF: l2cache mshr stalls=%ld (utilization=%d%%)\n", l2cache_mshr_stalls, mshr_utilization);
+      if (l2cache_prefetches != 0) {
+        int prefetch_accuracy = calcAvgPercent(l2cache_prefetch_useful + l2cache_prefetch_late, l2cache_prefetches);
+        fprintf(stream, "PERF: l2cache prefetches=%ld (accuracy=%d%%)\n", l2cache_prefetches, prefetch_accuracy);
+        fprintf(stream, "PERF: l2cache prefetch useful=%ld, late=%ld, polluting=%ld\n", l2cache_prefetch_useful, l2cache_prefetch_late, l2cache_prefetch_polluting);
+      }
     }
 
     if (l3cache_enable) {
@@ -636,9 +904,6 @@ extern int vx_dump_perf(vx_device_h hdevice, FILE* stream) {
       fprintf(stream, "PERF: memory latency=%d cycles\n", mem_avg_lat);
       fprintf(stream, "PERF: memory bank stalls=%ld (utilization=%d%%)\n", mem_bank_stalls, mem_bank_utilization);
     }
-  } break;
-  default:
-    break;
   }
 
   float IPC = caclAverage(total_instrs, max_cycles);
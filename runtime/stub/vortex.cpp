@@ -19,8 +19,13 @@
 #include <cstdlib>
 #include <dlfcn.h>
 #include <iostream>
+#include <sstream>
+#include <vector>
+#include <mutex>
 
 int get_profiling_mode();
+bool kernel_cache_release(vx_buffer_h hbuffer);
+void kernel_cache_evict(vx_device_h hdevice);
 
 static int dcr_initialize(vx_device_h hdevice) {
   const uint64_t startup_addr(STARTUP_ADDR);
@@ -50,127 +55,313 @@ static int dcr_initialize(vx_device_h hdevice) {
 
 ///////////////////////////////////////////////////////////////////////////////
 
-static callbacks_t g_callbacks;
-static void* g_drv_handle = nullptr;
-
 typedef int (*vx_dev_init_t)(callbacks_t*);
 
-extern int vx_dev_open(vx_device_h* hdevice) {
-  {
-    const char* driverName = getenv("VORTEX_DRIVER");
-    if (driverName == nullptr) {
-      driverName = "simx";
-    }
-    std::string driverName_s(driverName);
-    std::string libName = "libvortex-" + driverName_s + ".so";
-    auto handle = dlopen(libName.c_str(), RTLD_LAZY);
-    if (handle == nullptr) {
-      std::cerr << "Cannot open library: " << dlerror() << std::endl;
-      return 1;
+// A backend library, shared by all devices opened through it.
+struct vx_driver {
+  std::string name;
+  void*       library;
+  callbacks_t callbacks;
+  uint32_t    refs;
+};
+
+// Every handle returned to the application records the driver that
+// created it, so that devices from different backends can coexist.
+struct vx_handle {
+  vx_driver* driver;
+  void*      object;
+};
+
+static std::vector<vx_driver*> g_drivers;
+static std::mutex g_drivers_mutex;
+
+static std::vector<std::string> driver_names() {
+  std::vector<std::string> names;
+  const char* drivers_s = getenv("VORTEX_DRIVER");
+  if (drivers_s == nullptr) {
+    drivers_s = "simx";
+  }
+  std::stringstream ss(drivers_s);
+  std::string name;
+  while (std::getline(ss, name, ',')) {
+    if (!name.empty()) {
+      names.push_back(name);
     }
+  }
+  return names;
+}
 
-    auto vx_dev_init = (vx_dev_init_t)dlsym(handle, "vx_dev_init");
-    auto dlsym_error = dlerror();
-    if (dlsym_error) {
-      std::cerr << "Cannot load symbol 'vx_init': " << dlsym_error << std::endl;
-      dlclose(handle);
-      return 1;
+static vx_driver* driver_acquire(const std::string& name) {
+  std::lock_guard<std::mutex> lock(g_drivers_mutex);
+  for (auto driver : g_drivers) {
+    if (driver->name == name) {
+      ++driver->refs;
+      return driver;
     }
+  }
 
-    vx_dev_init(&g_callbacks);
-    g_drv_handle = handle;
+  std::string libName = "libvortex-" + name + ".so";
+  auto handle = dlopen(libName.c_str(), RTLD_LAZY);
+  if (handle == nullptr) {
+    std::cerr << "Cannot open library: " << dlerror() << std::endl;
+    return nullptr;
   }
 
-  vx_device_h _hdevice;
+  auto vx_dev_init = (vx_dev_init_t)dlsym(handle, "vx_dev_init");
+  auto dlsym_error = dlerror();
+  if (dlsym_error) {
+    std::cerr << "Cannot load symbol 'vx_dev_init': " << dlsym_error << std::endl;
+    dlclose(handle);
+    return nullptr;
+  }
 
-  CHECK_ERR((g_callbacks.dev_open)(&_hdevice), {
-    return err;
-  });
+  auto driver = new vx_driver{name, handle, {}, 1};
+  vx_dev_init(&driver->callbacks);
+  g_drivers.push_back(driver);
+  return driver;
+}
 
-  CHECK_ERR(dcr_initialize(_hdevice), {
-    return err;
-  });
+static void driver_release(vx_driver* driver) {
+  std::lock_guard<std::mutex> lock(g_drivers_mutex);
+  if (--driver->refs != 0)
+    return;
+  for (auto it = g_drivers.begin(); it != g_drivers.end(); ++it) {
+    if (*it == driver) {
+      g_drivers.erase(it);
+      break;
+    }
+  }
+  dlclose(driver->library);
+  delete driver;
+}
 
-  *hdevice = _hdevice;
+static void* wrap_handle(vx_driver* driver, void* object) {
+  return new vx_handle{driver, object};
+}
 
+#define UNWRAP(h)   (((vx_handle*)(h))->object)
+#define DRIVER(h)   (((vx_handle*)(h))->driver)
+#define CALLBACK(h) (DRIVER(h)->callbacks)
+
+// wraps the event returned by an enqueue call, if one was requested
+#define ENQUEUE_CALL(driver, call, hevent) \
+  do { \
+    vx_event_h _hevent; \
+    CHECK_ERR(call, { \
+      return err; \
+    }); \
+    if (hevent) { \
+      *hevent = wrap_handle(driver, _hevent); \
+    } \
+  } while (0)
+
+extern int vx_dev_count(uint32_t* count) {
+  if (nullptr == count)
+    return -1;
+  uint32_t total = 0;
+  for (auto& name : driver_names()) {
+    auto driver = driver_acquire(name);
+    if (driver == nullptr)
+      return -1;
+    uint32_t num_devices = 0;
+    int err = (driver->callbacks.dev_count)(&num_devices);
+    driver_release(driver);
+    if (err != 0)
+      return err;
+    total += num_devices;
+  }
+  *count = total;
   return 0;
 }
 
+extern int vx_dev_open_index(uint32_t index, vx_device_h* hdevice) {
+  if (nullptr == hdevice)
+    return -1;
+
+  // device indices span the listed drivers in order
+  for (auto& name : driver_names()) {
+    auto driver = driver_acquire(name);
+    if (driver == nullptr)
+      return -1;
+
+    uint32_t num_devices = 0;
+    CHECK_ERR((driver->callbacks.dev_count)(&num_devices), {
+      driver_release(driver);
+      return err;
+    });
+
+    if (index >= num_devices) {
+      index -= num_devices;
+      driver_release(driver);
+      continue;
+    }
+
+    vx_device_h _hdevice;
+    CHECK_ERR((driver->callbacks.dev_open)(index, &_hdevice), {
+      driver_release(driver);
+      return err;
+    });
+
+    auto wrapped = wrap_handle(driver, _hdevice);
+
+    CHECK_ERR(dcr_initialize(wrapped), {
+      (driver->callbacks.dev_close)(_hdevice);
+      delete (vx_handle*)wrapped;
+      driver_release(driver);
+      return err;
+    });
+
+    *hdevice = wrapped;
+    return 0;
+  }
+
+  std::cerr << "Error: invalid device index" << std::endl;
+  return -1;
+}
+
+extern int vx_dev_open(vx_device_h* hdevice) {
+  return vx_dev_open_index(0, hdevice);
+}
+
 extern int vx_dev_close(vx_device_h hdevice) {
+  if (nullptr == hdevice)
+    return 0;
   vx_dump_perf(hdevice, stdout);
-  int ret = (g_callbacks.dev_close)(hdevice);
-  dlclose(g_drv_handle);
+  kernel_cache_evict(hdevice);
+  auto driver = DRIVER(hdevice);
+  int ret = (driver->callbacks.dev_close)(UNWRAP(hdevice));
+  delete (vx_handle*)hdevice;
+  driver_release(driver);
   return ret;
 }
 
 extern int vx_dev_caps(vx_device_h hdevice, uint32_t caps_id, uint64_t* value) {
-  return (g_callbacks.dev_caps)(hdevice, caps_id, value);
+  if (nullptr == hdevice)
+    return -1;
+  return (CALLBACK(hdevice).dev_caps)(UNWRAP(hdevice), caps_id, value);
 }
 
 extern int vx_mem_alloc(vx_device_h hdevice, uint64_t size, int flags, vx_buffer_h* hbuffer) {
-  return (g_callbacks.mem_alloc)(hdevice, size, flags, hbuffer);
+  if (nullptr == hdevice || nullptr == hbuffer)
+    return -1;
+  vx_buffer_h _hbuffer;
+  CHECK_ERR((CALLBACK(hdevice).mem_alloc)(UNWRAP(hdevice), size, flags, &_hbuffer), {
+    return err;
+  });
+  *hbuffer = wrap_handle(DRIVER(hdevice), _hbuffer);
+  return 0;
 }
 
 extern int vx_mem_reserve(vx_device_h hdevice, uint64_t address, uint64_t size, int flags, vx_buffer_h* hbuffer) {
-  return (g_callbacks.mem_reserve)(hdevice, address, size, flags, hbuffer);
+  if (nullptr == hdevice || nullptr == hbuffer)
+    return -1;
+  vx_buffer_h _hbuffer;
+  CHECK_ERR((CALLBACK(hdevice).mem_reserve)(UNWRAP(hdevice), address, size, flags, &_hbuffer), {
+    return err;
+  });
+  *hbuffer = wrap_handle(DRIVER(hdevice), _hbuffer);
+  return 0;
 }
 
 extern int vx_mem_free(vx_buffer_h hbuffer) {
-  return (g_callbacks.mem_free)(hbuffer);
+  if (nullptr == hbuffer)
+    return 0;
+  // resident kernel images are freed with their device
+  if (kernel_cache_release(hbuffer))
+    return 0;
+  int ret = (CALLBACK(hbuffer).mem_free)(UNWRAP(hbuffer));
+  delete (vx_handle*)hbuffer;
+  return ret;
 }
 
 extern int vx_mem_access(vx_buffer_h hbuffer, uint64_t offset, uint64_t size, int flags) {
-  return (g_callbacks.mem_access)(hbuffer, offset, size, flags);
+  if (nullptr == hbuffer)
+    return -1;
+  return (CALLBACK(hbuffer).mem_access)(UNWRAP(hbuffer), offset, size, flags);
 }
 
 extern int vx_mem_address(vx_buffer_h hbuffer, uint64_t* address) {
-  return (g_callbacks.mem_address)(hbuffer, address);
+  if (nullptr == hbuffer)
+    return -1;
+  return (CALLBACK(hbuffer).mem_address)(UNWRAP(hbuffer), address);
+}
+
+extern int vx_mem_map(vx_buffer_h hbuffer, void** host_ptr) {
+  if (nullptr == hbuffer)
+    return -1;
+  return (CALLBACK(hbuffer).mem_map)(UNWRAP(hbuffer), host_ptr);
+}
+
+extern int vx_mem_unmap(vx_buffer_h hbuffer) {
+  if (nullptr == hbuffer)
+    return -1;
+  return (CALLBACK(hbuffer).mem_unmap)(UNWRAP(hbuffer));
 }
 
 extern int vx_mem_info(vx_device_h hdevice, uint64_t* mem_free, uint64_t* mem_used) {
-  return (g_callbacks.mem_info)(hdevice, mem_free, mem_used);
+  if (nullptr == hdevice)
+    return -1;
+  return (CALLBACK(hdevice).mem_info)(UNWRAP(hdevice), mem_free, mem_used);
 }
 
 extern int vx_copy_to_dev(vx_buffer_h hbuffer, const void* host_ptr, uint64_t dst_offset, uint64_t size) {
-  return (g_callbacks.copy_to_dev)(hbuffer, host_ptr, dst_offset, size);
+  if (nullptr == hbuffer)
+    return -1;
+  return (CALLBACK(hbuffer).copy_to_dev)(UNWRAP(hbuffer), host_ptr, dst_offset, size);
 }
 
 extern int vx_copy_from_dev(void* host_ptr, vx_buffer_h hbuffer, uint64_t src_offset, uint64_t size) {
-  return (g_callbacks.copy_from_dev)(host_ptr, hbuffer, src_offset, size);
+  if (nullptr == hbuffer)
+    return -1;
+  return (CALLBACK(hbuffer).copy_from_dev)(host_ptr, UNWRAP(hbuffer), src_offset, size);
 }
 
 extern int vx_start(vx_device_h hdevice, vx_buffer_h hkernel, vx_buffer_h harguments) {
+  if (nullptr == hdevice || nullptr == hkernel || nullptr == harguments)
+    return -1;
+  if (DRIVER(hkernel) != DRIVER(hdevice) || DRIVER(harguments) != DRIVER(hdevice))
+    return -1;
   int profiling_mode = get_profiling_mode();
   if (profiling_mode != 0) {
     CHECK_ERR(vx_dcr_write(hdevice, VX_DCR_BASE_MPM_CLASS, profiling_mode), {
       return err;
     });
   }
-  return (g_callbacks.start)(hdevice, hkernel, harguments);
+  return (CALLBACK(hdevice).start)(UNWRAP(hdevice), UNWRAP(hkernel), UNWRAP(harguments));
 }
 
 extern int vx_ready_wait(vx_device_h hdevice, uint64_t timeout) {
-  return (g_callbacks.ready_wait)(hdevice, timeout);
+  if (nullptr == hdevice)
+    return -1;
+  return (CALLBACK(hdevice).ready_wait)(UNWRAP(hdevice), timeout);
 }
 
 extern int vx_dcr_read(vx_device_h hdevice, uint32_t addr, uint32_t* value) {
-  return (g_callbacks.dcr_read)(hdevice, addr, value);
+  if (nullptr == hdevice)
+    return -1;
+  return (CALLBACK(hdevice).dcr_read)(UNWRAP(hdevice), addr, value);
 }
 
 extern int vx_dcr_write(vx_device_h hdevice, uint32_t addr, uint32_t value) {
-  return (g_callbacks.dcr_write)(hdevice, addr, value);
+  if (nullptr == hdevice)
+    return -1;
+  return (CALLBACK(hdevice).dcr_write)(UNWRAP(hdevice), addr, value);
 }
 
 extern int vx_mpm_query(vx_device_h hdevice, uint32_t addr, uint32_t core_id, uint64_t* value) {
+  if (nullptr == hdevice)
+    return -1;
+  auto& callbacks = CALLBACK(hdevice);
+  auto device = UNWRAP(hdevice);
   if (core_id == 0xffffffff) {
     uint64_t num_cores;
-    CHECK_ERR((g_callbacks.dev_caps)(hdevice, VX_CAPS_NUM_CORES, &num_cores), {
+    CHECK_ERR((callbacks.dev_caps)(device, VX_CAPS_NUM_CORES, &num_cores), {
       return err;
     });
     uint64_t sum_value = 0;
     uint64_t cur_value;
     for (uint32_t i = 0; i < num_cores; ++i) {
-      CHECK_ERR((g_callbacks.mpm_query)(hdevice, addr, i, &cur_value), {
+      CHECK_ERR((callbacks.mpm_query)(device, addr, i, &cur_value), {
         return err;
       });
       sum_value += cur_value;
@@ -178,6 +369,199 @@ extern int vx_mpm_query(vx_device_h hdevice, uint32_t addr, uint32_t core_id, ui
     *value = sum_value;
     return 0;
   } else {
-    return (g_callbacks.mpm_query)(hdevice, addr, core_id, value);
+    return (callbacks.mpm_query)(device, addr, core_id, value);
   }
-}
\ No newline at end of file
+}
+
+extern int vx_mpm_snapshot(vx_device_h hdevice, vx_mpm_core_t* buffer) {
+  if (nullptr == hdevice || nullptr == buffer)
+    return -1;
+  auto& callbacks = CALLBACK(hdevice);
+  auto device = UNWRAP(hdevice);
+
+  uint64_t num_cores;
+  CHECK_ERR((callbacks.dev_caps)(device, VX_CAPS_NUM_CORES, &num_cores), {
+    return err;
+  });
+
+  uint32_t perf_class;
+  CHECK_ERR((callbacks.dcr_read)(device, VX_DCR_BASE_MPM_CLASS, &perf_class), {
+    return err;
+  });
+
+  std::vector<uint64_t> counters(num_cores * 32 * IO_MPM_BANKS);
+  CHECK_ERR((callbacks.mpm_snapshot)(device, counters.data()), {
+    return err;
+  });
+
+  // the first bank holds the active class, under MPM_CLASS_ALL
+  // it holds the core counters and the second bank the memory counters.
+  // the third bank holds the prefetcher counters of the memory class,
+  // it is only dumped with MPM_PREFETCH_ENABLE.
+  bool has_core = (perf_class == VX_DCR_MPM_CLASS_CORE || perf_class == VX_DCR_MPM_CLASS_ALL);
+  bool has_mem  = (perf_class == VX_DCR_MPM_CLASS_MEM || perf_class == VX_DCR_MPM_CLASS_ALL);
+  uint32_t mem_bank = (perf_class == VX_DCR_MPM_CLASS_ALL) ? VX_MPM_BANK_MEM : VX_MPM_BANK_CORE;
+
+  for (uint32_t core_id = 0; core_id < num_cores; ++core_id) {
+    auto mpm = counters.data() + core_id * 32 * IO_MPM_BANKS;
+    auto core_get = [&](uint32_t addr) { return mpm[addr - VX_CSR_MPM_BASE]; };
+    auto mem_get = [&](uint32_t addr) { return mpm[mem_bank * 32 + addr - VX_CSR_MPM_BASE]; };
+  #if IO_MPM_BANKS > VX_MPM_BANK_PREFETCH
+    auto pf_get = [&](uint32_t addr) { return mpm[VX_MPM_BANK_PREFETCH * 32 + addr - VX_CSR_MPM_BASE]; };
+  #else
+    auto pf_get = [&](uint32_t) { return uint64_t(0); };
+  #endif
+    auto& core = buffer[core_id];
+    memset(&core, 0, sizeof(vx_mpm_core_t));
+    core.cycles = core_get(VX_CSR_MCYCLE);
+    core.instrs = core_get(VX_CSR_MINSTRET);
+    if (has_core) {
+      core.sched_idles    = core_get(VX_CSR_MPM_SCHED_ID);
+      core.sched_stalls   = core_get(VX_CSR_MPM_SCHED_ST);
+      core.ibuffer_stalls = core_get(VX_CSR_MPM_IBUF_ST);
+      core.scrb_stalls    = core_get(VX_CSR_MPM_SCRB_ST);
+      core.opds_stalls    = core_get(VX_CSR_MPM_OPDS_ST);
+      core.scrb_alu       = core_get(VX_CSR_MPM_SCRB_ALU);
+      core.scrb_fpu       = core_get(VX_CSR_MPM_SCRB_FPU);
+      core.scrb_lsu       = core_get(VX_CSR_MPM_SCRB_LSU);
+      core.scrb_sfu       = core_get(VX_CSR_MPM_SCRB_SFU);
+      core.scrb_csrs      = core_get(VX_CSR_MPM_SCRB_CSRS);
+      core.scrb_wctl      = core_get(VX_CSR_MPM_SCRB_WCTL);
+      core.ifetches       = core_get(VX_CSR_MPM_IFETCHES);
+      core.loads          = core_get(VX_CSR_MPM_LOADS);
+      core.stores         = core_get(VX_CSR_MPM_STORES);
+      core.ifetch_lat     = core_get(VX_CSR_MPM_IFETCH_LT);
+      core.load_lat       = core_get(VX_CSR_MPM_LOAD_LT);
+    }
+    if (has_mem) {
+      core.icache.reads        = mem_get(VX_CSR_MPM_ICACHE_READS);
+      core.icache.read_misses  = mem_get(VX_CSR_MPM_ICACHE_MISS_R);
+      core.icache.mshr_stalls  = mem_get(VX_CSR_MPM_ICACHE_MSHR_ST);
+      core.dcache.reads        = mem_get(VX_CSR_MPM_DCACHE_READS);
+      core.dcache.writes       = mem_get(VX_CSR_MPM_DCACHE_WRITES);
+      core.dcache.read_misses  = mem_get(VX_CSR_MPM_DCACHE_MISS_R);
+      core.dcache.write_misses = mem_get(VX_CSR_MPM_DCACHE_MISS_W);
+      core.dcache.bank_stalls  = mem_get(VX_CSR_MPM_DCACHE_BANK_ST);
+      core.dcache.mshr_stalls  = mem_get(VX_CSR_MPM_DCACHE_MSHR_ST);
+      core.l2cache.reads        = mem_get(VX_CSR_MPM_L2CACHE_READS);
+      core.l2cache.writes       = mem_get(VX_CSR_MPM_L2CACHE_WRITES);
+      core.l2cache.read_misses  = mem_get(VX_CSR_MPM_L2CACHE_MISS_R);
+      core.l2cache.write_misses = mem_get(VX_CSR_MPM_L2CACHE_MISS_W);
+      core.l2cache.bank_stalls  = mem_get(VX_CSR_MPM_L2CACHE_BANK_ST);
+      core.l2cache.mshr_stalls  = mem_get(VX_CSR_MPM_L2CACHE_MSHR_ST);
+      core.lmem_reads       = mem_get(VX_CSR_MPM_LMEM_READS);
+      core.lmem_writes      = mem_get(VX_CSR_MPM_LMEM_WRITES);
+      core.lmem_bank_stalls = mem_get(VX_CSR_MPM_LMEM_BANK_ST);
+      core.coalescer_misses = mem_get(VX_CSR_MPM_COALESCER_MISS);
+      core.dcache.prefetches          = pf_get(VX_CSR_MPM_DCACHE_PF_ISSUED);
+      core.dcache.prefetch_useful     = pf_get(VX_CSR_MPM_DCACHE_PF_USEFUL);
+      core.dcache.prefetch_late       = pf_get(VX_CSR_MPM_DCACHE_PF_LATE);
+      core.dcache.prefetch_polluting  = pf_get(VX_CSR_MPM_DCACHE_PF_POLLUTE);
+      core.l2cache.prefetches         = pf_get(VX_CSR_MPM_L2CACHE_PF_ISSUED);
+      core.l2cache.prefetch_useful    = pf_get(VX_CSR_MPM_L2CACHE_PF_USEFUL);
+      core.l2cache.prefetch_late      = pf_get(VX_CSR_MPM_L2CACHE_PF_LATE);
+      core.l2cache.prefetch_polluting = pf_get(VX_CSR_MPM_L2CACHE_PF_POLLUTE);
+      if (0 == core_id) {
+        core.l3cache.reads        = mem_get(VX_CSR_MPM_L3CACHE_READS);
+        core.l3cache.writes       = mem_get(VX_CSR_MPM_L3CACHE_WRITES);
+        core.l3cache.read_misses  = mem_get(VX_CSR_MPM_L3CACHE_MISS_R);
+        core.l3cache.write_misses = mem_get(VX_CSR_MPM_L3CACHE_MISS_W);
+        core.l3cache.bank_stalls  = mem_get(VX_CSR_MPM_L3CACHE_BANK_ST);
+        core.l3cache.mshr_stalls  = mem_get(VX_CSR_MPM_L3CACHE_MSHR_ST);
+        core.mem_reads       = mem_get(VX_CSR_MPM_MEM_READS);
+        core.mem_writes      = mem_get(VX_CSR_MPM_MEM_WRITES);
+        core.mem_lat         = mem_get(VX_CSR_MPM_MEM_LT);
+        core.mem_bank_stalls = mem_get(VX_CSR_MPM_MEM_BANK_ST);
+      }
+    }
+  }
+
+  return 0;
+}
+
+extern int vx_queue_create(vx_device_h hdevice, vx_queue_h* hqueue) {
+  if (nullptr == hdevice || nullptr == hqueue)
+    return -1;
+  vx_queue_h _hqueue;
+  CHECK_ERR((CALLBACK(hdevice).queue_create)(UNWRAP(hdevice), &_hqueue), {
+    return err;
+  });
+  *hqueue = wrap_handle(DRIVER(hdevice), _hqueue);
+  return 0;
+}
+
+extern int vx_queue_destroy(vx_queue_h hqueue) {
+  if (nullptr == hqueue)
+    return 0;
+  int ret = (CALLBACK(hqueue).queue_destroy)(UNWRAP(hqueue));
+  delete (vx_handle*)hqueue;
+  return ret;
+}
+
+extern int vx_queue_wait_event(vx_queue_h hqueue, vx_event_h hevent) {
+  if (nullptr == hqueue || nullptr == hevent)
+    return -1;
+  if (DRIVER(hevent) != DRIVER(hqueue))
+    return -1;
+  return (CALLBACK(hqueue).queue_wait_event)(UNWRAP(hqueue), UNWRAP(hevent));
+}
+
+extern int vx_queue_finish(vx_queue_h hqueue, uint64_t timeout) {
+  if (nullptr == hqueue)
+    return -1;
+  return (CALLBACK(hqueue).queue_finish)(UNWRAP(hqueue), timeout);
+}
+
+extern int vx_enqueue_copy_to_dev(vx_queue_h hqueue, vx_buffer_h hbuffer, const void* host_ptr, uint64_t dst_offset, uint64_t size, vx_event_h* hevent) {
+  if (nullptr == hqueue || nullptr == hbuffer)
+    return -1;
+  if (DRIVER(hbuffer) != DRIVER(hqueue))
+    return -1;
+  ENQUEUE_CALL(DRIVER(hqueue), (CALLBACK(hqueue).enqueue_copy_to_dev)(UNWRAP(hqueue), UNWRAP(hbuffer), host_ptr, dst_offset, size, hevent ? &_hevent : nullptr), hevent);
+  return 0;
+}
+
+extern int vx_enqueue_copy_from_dev(vx_queue_h hqueue, void* host_ptr, vx_buffer_h hbuffer, uint64_t src_offset, uint64_t size, vx_event_h* hevent) {
+  if (nullptr == hqueue || nullptr == hbuffer)
+    return -1;
+  if (DRIVER(hbuffer) != DRIVER(hqueue))
+    return -1;
+  ENQUEUE_CALL(DRIVER(hqueue), (CALLBACK(hqueue).enqueue_copy_from_dev)(UNWRAP(hqueue), host_ptr, UNWRAP(hbuffer), src_offset, size, hevent ? &_hevent : nullptr), hevent);
+  return 0;
+}
+
+extern int vx_enqueue_start(vx_queue_h hqueue, vx_buffer_h hkernel, vx_buffer_h harguments, vx_event_h* hevent) {
+  if (nullptr == hqueue || nullptr == hkernel || nullptr == harguments)
+    return -1;
+  if (DRIVER(hkernel) != DRIVER(hqueue) || DRIVER(harguments) != DRIVER(hqueue))
+    return -1;
+  int profiling_mode = get_profiling_mode();
+  if (profiling_mode != 0) {
+    CHECK_ERR(vx_enqueue_dcr_write(hqueue, VX_DCR_BASE_MPM_CLASS, profiling_mode, nullptr), {
+      return err;
+    });
+  }
+  ENQUEUE_CALL(DRIVER(hqueue), (CALLBACK(hqueue).enqueue_start)(UNWRAP(hqueue), UNWRAP(hkernel), UNWRAP(harguments), hevent ? &_hevent : nullptr), hevent);
+  return 0;
+}
+
+extern int vx_enqueue_dcr_write(vx_queue_h hqueue, uint32_t addr, uint32_t value, vx_event_h* hevent) {
+  if (nullptr == hqueue)
+    return -1;
+  ENQUEUE_CALL(DRIVER(hqueue), (CALLBACK(hqueue).enqueue_dcr_write)(UNWRAP(hqueue), addr, value, hevent ? &_hevent : nullptr), hevent);
+  return 0;
+}
+
+extern int vx_event_wait(vx_event_h hevent, uint64_t timeout) {
+  if (nullptr == hevent)
+    return -1;
+  return (CALLBACK(hevent).event_wait)(UNWRAP(hevent), timeout);
+}
+
+extern int vx_event_release(vx_event_h hevent) {
+  if (nullptr == hevent)
+    return 0;
+  int ret = (CALLBACK(hevent).event_release)(UNWRAP(hevent));
+  delete (vx_handle*)hevent;
+  return ret;
+}
@@ -26,11 +26,13 @@
 #include "experimental/xrt_error.h"
 #include "experimental/xrt_ip.h"
 #include "experimental/xrt_kernel.h"
+#include "experimental/xrt_system.h"
 #include "experimental/xrt_xclbin.h"
 #endif
 
 #include <limits>
 #include <stdarg.h>
+#include <string.h>
 #include <string>
 #include <unordered_map>
 #include <util.h>
@@ -131,12 +133,23 @@ public:
   #endif
   }
 
-  int init() {
+  static int device_count(uint32_t* count) {
+  #ifdef CPP_API
+    *count = xrt::system::enumerate_devices();
+  #else
+    *count = 1;
+  #endif
+    return 0;
+  }
+
+  int init(uint32_t index) {
+    // devices are numbered from XRT_DEVICE_INDEX
     int device_index = DEFAULT_DEVICE_INDEX;
     const char *device_index_s = getenv("XRT_DEVICE_INDEX");
     if (device_index_s != nullptr) {
       device_index = atoi(device_index_s);
     }
+    device_index += index;
 
     const char *xlbin_path_s = getenv("XRT_XCLBIN_PATH");
     if (xlbin_path_s == nullptr) {
@@ -412,6 +425,15 @@ public:
     return 0;
   }
 
+  int mem_map(uint64_t /*dev_addr*/, void** /*host_ptr*/) {
+    // device memory is not host-addressable
+    return -1;
+  }
+
+  int mem_unmap(uint64_t /*dev_addr*/) {
+    return -1;
+  }
+
   int mem_info(uint64_t *mem_free, uint64_t *mem_used) const {
     if (mem_free)
       *mem_free = global_mem_.free();
@@ -563,18 +585,12 @@ public:
   }
 
   int ready_wait(uint64_t timeout) {
-    struct timespec sleep_time;
   #ifndef NDEBUG
-    sleep_time.tv_sec = 1;
-    sleep_time.tv_nsec = 0;
+    PollBackoff backoff(timeout, 1000000000);
   #else
-    sleep_time.tv_sec = 0;
-    sleep_time.tv_nsec = 1000000;
+    PollBackoff backoff(timeout);
   #endif
 
-    // to milliseconds
-    uint64_t sleep_time_ms = (sleep_time.tv_sec * 1000) + (sleep_time.tv_nsec / 1000000);
-
     for (;;) {
       uint32_t status = 0;
       CHECK_ERR(this->read_register(MMIO_CTL_ADDR, &status), {
@@ -583,11 +599,10 @@ public:
       bool is_done = (status & CTL_AP_DONE) == CTL_AP_DONE;
       if (is_done)
         break;
-      if (0 == timeout) {
+      if (backoff.expired()) {
         return -1;
       }
-      nanosleep(&sleep_time, nullptr);
-      timeout -= sleep_time_ms;
+      backoff.sleep();
     };
 
     return 0;
@@ -612,18 +627,44 @@ public:
     uint32_t offset = addr - VX_CSR_MPM_BASE;
     if (offset > 31)
       return -1;
-    if (mpm_cache_.count(core_id) == 0) {
-      uint64_t mpm_mem_addr = IO_MPM_ADDR + core_id * 32 * sizeof(uint64_t);
-      CHECK_ERR(this->download(mpm_cache_[core_id].data(), mpm_mem_addr, 32 * sizeof(uint64_t)), {
-        return err;
-      });
-    }
-    *value = mpm_cache_.at(core_id).at(offset);
+    CHECK_ERR(this->mpm_load(), {
+      return err;
+    });
+    // legacy queries read the first bank
+    uint32_t stride = 32 * IO_MPM_BANKS;
+    if ((core_id + 1) * stride > mpm_cache_.size())
+      return -1;
+    *value = mpm_cache_.at(core_id * stride + offset);
+    return 0;
+  }
+
+  int mpm_snapshot(uint64_t* counters) {
+    CHECK_ERR(this->mpm_load(), {
+      return err;
+    });
+    memcpy(counters, mpm_cache_.data(), mpm_cache_.size() * sizeof(uint64_t));
     return 0;
   }
 
 private:
 
+  // fetch all cores' counter blocks in a single transfer,
+  // the cache stays valid until the next kernel launch
+  int mpm_load() {
+    if (!mpm_cache_.empty())
+      return 0;
+    uint64_t num_cores;
+    CHECK_ERR(this->get_caps(VX_CAPS_NUM_CORES, &num_cores), {
+      return err;
+    });
+    std::vector<uint64_t> counters(num_cores * 32 * IO_MPM_BANKS);
+    CHECK_ERR(this->download(counters.data(), IO_MPM_ADDR, counters.size() * sizeof(uint64_t)), {
+      return err;
+    });
+    mpm_cache_ = std::move(counters);
+    return 0;
+  }
+
   MemoryAllocator global_mem_;
   xrt_device_t xrtDevice_;
   xrt_kernel_t xrtKernel_;
@@ -631,7 +672,7 @@ private:
   uint64_t isa_caps_;
   uint64_t global_mem_size_;
   DeviceConfig dcrs_;
-  std::unordered_map<uint32_t, std::array<uint64_t, 32>> mpm_cache_;
+  std::vector<uint64_t> mpm_cache_;
   uint32_t lg2_num_banks_;
   uint32_t lg2_bank_size_;
 
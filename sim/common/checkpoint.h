@@ -0,0 +1,163 @@
+// Copyright © 2019-2023
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <type_traits>
+
+namespace vortex {
+
+// Binary checkpoint stream.
+// A checkpoint is a sequence of sections, each opened by a four-character
+// tag so that a reader out of sync with the writer fails early. Values are
+// stored in host byte order.
+
+#define CKPT_TAG(a, b, c, d) \
+  (uint32_t(a) | (uint32_t(b) << 8) | (uint32_t(c) << 16) | (uint32_t(d) << 24))
+
+constexpr uint64_t CKPT_MAGIC   = 0x54504b435856ull; // "VXCKPT"
+constexpr uint32_t CKPT_VERSION = 4;
+
+class CheckpointWriter {
+public:
+  CheckpointWriter(const char* filename)
+    : filename_(filename)
+    , buffer_(1 << 20) {
+    ofs_.rdbuf()->pubsetbuf(buffer_.data(), buffer_.size());
+    ofs_.open(filename, std::ios::binary | std::ios::trunc);
+    if (!ofs_) {
+      std::cout << "error: cannot create checkpoint " << filename << std::endl;
+      std::abort();
+    }
+    this->write<uint64_t>(CKPT_MAGIC);
+    this->write<uint32_t>(CKPT_VERSION);
+  }
+
+  ~CheckpointWriter() {
+    ofs_.flush();
+    if (!ofs_) {
+      std::cout << "error: failed writing checkpoint " << filename_ << std::endl;
+      std::abort();
+    }
+  }
+
+  void section(uint32_t tag) {
+    this->write<uint32_t>(tag);
+  }
+
+  void write(const void* data, uint64_t size) {
+    ofs_.write((const char*)data, size);
+  }
+
+  template <typename T>
+  void write(const T& value) {
+    static_assert(std::is_trivially_copyable<T>::value, "invalid type");
+    this->write(&value, sizeof(T));
+  }
+
+private:
+  std::string       filename_;
+  std::vector<char> buffer_;
+  std::ofstream     ofs_;
+};
+
+class CheckpointReader {
+public:
+  CheckpointReader(const char* filename)
+    : filename_(filename)
+    , data_(nullptr)
+    , size_(0)
+    , offset_(0) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+      std::cout << "error: " << filename << " not found" << std::endl;
+      std::abort();
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size != 0) {
+      size_ = st.st_size;
+      // map the file, page contents are copied straight out of the page cache
+      auto addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (addr != MAP_FAILED) {
+        data_ = (const uint8_t*)addr;
+        madvise(addr, size_, MADV_SEQUENTIAL);
+      }
+    }
+    close(fd);
+    if (data_ == nullptr) {
+      std::cout << "error: cannot map checkpoint " << filename << std::endl;
+      std::abort();
+    }
+    if (this->read<uint64_t>() != CKPT_MAGIC
+     || this->read<uint32_t>() != CKPT_VERSION) {
+      std::cout << "error: " << filename << " is not a valid checkpoint" << std::endl;
+      std::abort();
+    }
+  }
+
+  ~CheckpointReader() {
+    munmap((void*)data_, size_);
+  }
+
+  void section(uint32_t tag) {
+    if (this->read<uint32_t>() != tag) {
+      std::cout << "error: corrupted checkpoint " << filename_
+                << " at offset " << (offset_ - sizeof(uint32_t)) << std::endl;
+      std::abort();
+    }
+  }
+
+  // return a pointer to the next size bytes of the mapped file
+  const uint8_t* read(uint64_t size) {
+    if (size > size_ - offset_) {
+      std::cout << "error: truncated checkpoint " << filename_ << std::endl;
+      std::abort();
+    }
+    auto ptr = data_ + offset_;
+    offset_ += size;
+    return ptr;
+  }
+
+  void read(void* data, uint64_t size) {
+    memcpy(data, this->read(size), size);
+  }
+
+  template <typename T>
+  T read() {
+    static_assert(std::is_trivially_copyable<T>::value, "invalid type");
+    T value;
+    this->read(&value, sizeof(T));
+    return value;
+  }
+
+  void skip(uint64_t size) {
+    this->read(size);
+  }
+
+private:
+  std::string    filename_;
+  const uint8_t* data_;
+  uint64_t       size_;
+  uint64_t       offset_;
+};
+
+}
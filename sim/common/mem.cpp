@@ -12,11 +12,19 @@
 // limitations under the License.
 
 #include "mem.h"
+#include <string.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <array>
 #include <vector>
 #include <iostream>
 #include <fstream>
 #include <assert.h>
 #include "util.h"
+#include "checkpoint.h"
 #include <VX_config.h>
 #include <bitset>
 
@@ -419,63 +427,194 @@ bool ACLManager::check(uint64_t addr, uint64_t size, int flags) const {
 
 ///////////////////////////////////////////////////////////////////////////////
 
+// software TLB of the calling thread, shared by all RAM instances
+// organized as 2-way sets with the most recently used entry first
+static constexpr uint32_t RAM_TLB_SIZE = 128;
+static constexpr uint32_t RAM_TLB_WAYS = 2;
+
+struct ram_tlb_entry_t {
+  uint64_t owner;
+  uint64_t page_index;
+  uint8_t* page;
+};
+
+static ram_tlb_entry_t* ram_tlb() {
+  static thread_local ram_tlb_entry_t s_tlb[RAM_TLB_SIZE] = {};
+  return s_tlb;
+}
+
+// unique tag of a RAM's page set, renewed on clear()
+static uint64_t ram_next_id() {
+  static std::atomic<uint64_t> s_next_id(1);
+  return s_next_id++;
+}
+
 RAM::RAM(uint64_t capacity, uint32_t page_size)
   : capacity_(capacity)
   , page_bits_(log2ceil(page_size))
-  , last_page_(nullptr)
-  , last_page_index_(0)
-  , check_acl_(false) {
+  , id_(ram_next_id())
+  , arena_ptr_(nullptr)
+  , arena_left_(0)
+  , arena_size_(0)
+  , check_acl_(false)
+  , code_version_(0)
+  , concurrent_(false) {
   assert(ispow2(page_size));
   if (capacity != 0) {
     assert(ispow2(capacity));
     assert(page_size <= capacity);
     assert(0 == (capacity % page_size));
   }
+  // split the page index into equal radix levels of at most 12 bits
+  uint32_t addr_bits = (capacity != 0) ? log2ceil(capacity) : 64;
+  uint32_t index_bits = addr_bits - page_bits_;
+  levels_ = std::max<uint32_t>(1, (index_bits + 11) / 12);
+  level_bits_ = (index_bits + levels_ - 1) / levels_;
+  root_ = this->alloc_node();
 }
 
 RAM::~RAM() {
   this->clear();
+  free(root_);
 }
 
 void RAM::clear() {
-  for (auto& page : pages_) {
-    delete[] page.second;
+  for (auto node : nodes_) {
+    free(node);
+  }
+  nodes_.clear();
+  memset(root_, 0, sizeof(void*) << level_bits_);
+  for (auto& arena : arenas_) {
+    munmap(arena.first, arena.second);
   }
+  arenas_.clear();
+  arena_ptr_ = nullptr;
+  arena_left_ = 0;
+  arena_size_ = 0;
+  free_pages_.clear();
+  mappings_.clear();
+  page_list_.clear();
+  // invalidate the TLB entries of all threads
+  id_ = ram_next_id();
+  for (auto& shard : shards_) {
+    shard.code_pages.clear();
+  }
+  ++code_version_;
 }
 
 uint64_t RAM::size() const {
-  return uint64_t(pages_.size()) << page_bits_;
+  std::unique_lock<std::mutex> lock(dir_mutex_, std::defer_lock);
+  if (concurrent_) {
+    lock.lock();
+  }
+  return uint64_t(page_list_.size()) << page_bits_;
 }
 
 uint8_t *RAM::get(uint64_t address) const {
   if (capacity_ != 0 && address >= capacity_) {
     throw OutOfRange();
   }
-  uint32_t page_size   = 1 << page_bits_;
-  uint32_t page_offset = address & (page_size - 1);
+  uint64_t page_size   = uint64_t(1) << page_bits_;
+  uint64_t page_offset = address & (page_size - 1);
   uint64_t page_index  = address >> page_bits_;
 
-  uint8_t* page;
-  if (last_page_ && last_page_index_ == page_index) {
-    page = last_page_;
-  } else {
-    auto it = pages_.find(page_index);
-    if (it != pages_.end()) {
-      page = it->second;
-    } else {
-      uint8_t *ptr = new uint8_t[page_size];
-      // set uninitialized data to "baadf00d"
-      for (uint32_t i = 0; i < page_size; ++i) {
-        ptr[i] = (0xbaadf00d >> ((i & 0x3) * 8)) & 0xff;
-      }
-      pages_.emplace(page_index, ptr);
-      page = ptr;
+  // hash the index, strided streams would otherwise collide on the low bits
+  auto set = ((page_index ^ id_) * 0x9e3779b97f4a7c15ull) >> (64 - log2ceil(RAM_TLB_SIZE / RAM_TLB_WAYS));
+  auto ways = ram_tlb() + set * RAM_TLB_WAYS;
+  if (ways[0].owner == id_ && ways[0].page_index == page_index) {
+    return ways[0].page + page_offset;
+  }
+  auto entry = ways[1];
+  if (entry.owner != id_ || entry.page_index != page_index) {
+    std::unique_lock<std::mutex> lock(dir_mutex_, std::defer_lock);
+    if (concurrent_) {
+      lock.lock();
+    }
+    entry.owner = id_;
+    entry.page_index = page_index;
+    entry.page = this->find_page(page_index);
+  }
+  ways[1] = ways[0];
+  ways[0] = entry;
+
+  return entry.page + page_offset;
+}
+
+uint8_t* RAM::find_page(uint64_t page_index) const {
+  auto slot = this->page_slot(page_index);
+  if (*slot == nullptr) {
+    *slot = this->alloc_page();
+    page_list_.emplace_back(page_index, (uint8_t*)*slot);
+  }
+  return (uint8_t*)*slot;
+}
+
+void** RAM::page_slot(uint64_t page_index) const {
+  uint64_t level_mask = (uint64_t(1) << level_bits_) - 1;
+  void** node = root_;
+  for (uint32_t l = levels_ - 1; l != 0; --l) {
+    auto& next = node[(page_index >> (l * level_bits_)) & level_mask];
+    if (next == nullptr) {
+      next = this->alloc_node();
+      nodes_.push_back((void**)next);
+    }
+    node = (void**)next;
+  }
+  return &node[page_index & level_mask];
+}
+
+void** RAM::alloc_node() const {
+  auto node = (void**)calloc(size_t(1) << level_bits_, sizeof(void*));
+  if (node == nullptr) {
+    throw std::bad_alloc();
+  }
+  return node;
+}
+
+// set uninitialized data to "baadf00d"
+static void fill_uninitialized(uint8_t* data, uint64_t size) {
+  uint8_t pattern[4] = {0x0d, 0xf0, 0xad, 0xba};
+  if (size >= 4) {
+    memcpy(data, pattern, 4);
+    // replicate the pattern by doubling the initialized prefix
+    for (uint64_t filled = 4; filled < size; filled *= 2) {
+      memcpy(data + filled, data, std::min(filled, size - filled));
     }
-    last_page_ = page;
-    last_page_index_ = page_index;
+  } else {
+    memcpy(data, pattern, size);
   }
+}
 
-  return page + page_offset;
+uint8_t* RAM::alloc_page() const {
+  uint64_t page_size = uint64_t(1) << page_bits_;
+  if (!free_pages_.empty()) {
+    auto page = free_pages_.back();
+    free_pages_.pop_back();
+    fill_uninitialized(page, page_size);
+    return page;
+  }
+  if (arena_left_ < page_size) {
+    // arenas double in size, physical memory is only committed on first touch
+    arena_size_ = std::min<uint64_t>(std::max<uint64_t>(arena_size_ * 2, 64 * 1024), 64 * 1024 * 1024);
+    arena_size_ = std::max<uint64_t>(arena_size_, page_size);
+    auto ptr = mmap(nullptr, arena_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (ptr == MAP_FAILED) {
+      throw std::bad_alloc();
+    }
+  #ifdef MADV_HUGEPAGE
+    if (arena_size_ >= 2 * 1024 * 1024) {
+      madvise(ptr, arena_size_, MADV_HUGEPAGE);
+    }
+  #endif
+    arenas_.emplace_back(ptr, arena_size_);
+    arena_ptr_ = (uint8_t*)ptr;
+    arena_left_ = arena_size_;
+  }
+  auto page = arena_ptr_;
+  arena_ptr_ += page_size;
+  arena_left_ -= page_size;
+  fill_uninitialized(page, page_size);
+  return page;
 }
 
 void RAM::read(void* data, uint64_t addr, uint64_t size) {
@@ -483,9 +622,23 @@ void RAM::read(void* data, uint64_t addr, uint64_t size) {
   if (check_acl_ && acl_mngr_.check(addr, size, 0x1) == false) {
     throw BadAddress();
   }
+  this->backdoor_read(data, addr, size);
+}
+
+void RAM::backdoor_read(void* data, uint64_t addr, uint64_t size) {
+  // copy page-contiguous chunks, each page is looked up once
   uint8_t* d = (uint8_t*)data;
-  for (uint64_t i = 0; i < size; i++) {
-    d[i] = *this->get(addr + i);
+  uint64_t page_size = uint64_t(1) << page_bits_;
+  while (size != 0) {
+    uint64_t chunk = std::min<uint64_t>(size, page_size - (addr & (page_size - 1)));
+    std::unique_lock<std::mutex> lock(this->shard(addr >> page_bits_).mutex, std::defer_lock);
+    if (concurrent_) {
+      lock.lock();
+    }
+    memcpy(d, this->get(addr), chunk);
+    d += chunk;
+    addr += chunk;
+    size -= chunk;
   }
 }
 
@@ -493,9 +646,55 @@ void RAM::write(const void* data, uint64_t addr, uint64_t size) {
   if (check_acl_ && acl_mngr_.check(addr, size, 0x2) == false) {
     throw BadAddress();
   }
+  this->backdoor_write(data, addr, size);
+}
+
+void RAM::backdoor_write(const void* data, uint64_t addr, uint64_t size) {
   const uint8_t* d = (const uint8_t*)data;
-  for (uint64_t i = 0; i < size; i++) {
-    *this->get(addr + i) = d[i];
+  uint64_t page_size = uint64_t(1) << page_bits_;
+  while (size != 0) {
+    uint64_t chunk = std::min<uint64_t>(size, page_size - (addr & (page_size - 1)));
+    auto& shard = this->shard(addr >> page_bits_);
+    std::unique_lock<std::mutex> lock(shard.mutex, std::defer_lock);
+    if (concurrent_) {
+      lock.lock();
+    }
+    if (!shard.code_pages.empty()) {
+      this->invalidate_code(shard, addr >> page_bits_);
+    }
+    memcpy(this->get(addr), d, chunk);
+    d += chunk;
+    addr += chunk;
+    size -= chunk;
+  }
+}
+
+uint64_t RAM::mark_code_page(uint64_t address) {
+  uint64_t page_index = address >> page_bits_;
+  auto& shard = this->shard(page_index);
+  std::unique_lock<std::mutex> lock(shard.mutex, std::defer_lock);
+  if (concurrent_) {
+    lock.lock();
+  }
+  return shard.code_pages.emplace(page_index, code_version_.load()).first->second;
+}
+
+uint64_t RAM::code_page_version(uint64_t address) {
+  uint64_t page_index = address >> page_bits_;
+  auto& shard = this->shard(page_index);
+  std::unique_lock<std::mutex> lock(shard.mutex, std::defer_lock);
+  if (concurrent_) {
+    lock.lock();
+  }
+  auto it = shard.code_pages.find(page_index);
+  return (it != shard.code_pages.end()) ? it->second : uint64_t(-1);
+}
+
+void RAM::invalidate_code(shard_t& shard, uint64_t page_index) {
+  auto it = shard.code_pages.find(page_index);
+  if (it != shard.code_pages.end()) {
+    // only the caches' copies of this page go stale
+    it->second = ++code_version_;
   }
 }
 
@@ -506,70 +705,281 @@ void RAM::set_acl(uint64_t addr, uint64_t size, int flags) {
   acl_mngr_.set(addr, size, flags);
 }
 
+void RAM::save(CheckpointWriter& ckpt) const {
+  // sort the pages so that identical states produce identical files
+  auto pages = page_list_;
+  std::sort(pages.begin(), pages.end());
+
+  uint64_t page_size = uint64_t(1) << page_bits_;
+  ckpt.section(CKPT_TAG('R','A','M',' '));
+  ckpt.write<uint32_t>(page_bits_);
+  ckpt.write<uint64_t>(pages.size());
+  for (auto& page : pages) {
+    ckpt.write<uint64_t>(page.first);
+    ckpt.write(page.second, page_size);
+  }
+}
+
+void RAM::restore(CheckpointReader& ckpt) {
+  ckpt.section(CKPT_TAG('R','A','M',' '));
+  auto page_bits = ckpt.read<uint32_t>();
+  if (page_bits != page_bits_) {
+    std::cout << "error: checkpoint page size mismatch" << std::endl;
+    std::abort();
+  }
+
+  this->clear();
+
+  uint64_t page_size = uint64_t(1) << page_bits_;
+  auto num_pages = ckpt.read<uint64_t>();
+  for (uint64_t i = 0; i < num_pages; ++i) {
+    auto index = ckpt.read<uint64_t>();
+    ckpt.read(this->find_page(index), page_size);
+  }
+}
+
+uint8_t* RAM::map(uint64_t addr, uint64_t size) {
+  uint64_t page_size = uint64_t(1) << page_bits_;
+  if (0 != (addr & (page_size - 1))
+   || 0 != (size & (page_size - 1))
+   || 0 == size) {
+    return nullptr;
+  }
+  if (capacity_ != 0 && (addr >= capacity_ || size > capacity_ - addr)) {
+    throw OutOfRange();
+  }
+  std::unique_lock<std::mutex> lock(dir_mutex_, std::defer_lock);
+  if (concurrent_) {
+    lock.lock();
+  }
+
+  // reuse the range if it is already backed by contiguous memory
+  uint64_t first = addr >> page_bits_;
+  uint64_t num_pages = size >> page_bits_;
+  auto base = (uint8_t*)*this->page_slot(first);
+  bool contiguous = (base != nullptr);
+  for (uint64_t i = 1; contiguous && i < num_pages; ++i) {
+    contiguous = (*this->page_slot(first + i) == base + (i << page_bits_));
+  }
+  uint64_t end = first + num_pages;
+  if (contiguous) {
+    // nothing moves, merge the range with the mapped ranges it overlaps
+    uint64_t lo = first, hi = end;
+    auto it = mappings_.lower_bound(end);
+    while (it != mappings_.begin() && std::prev(it)->second > first) {
+      --it;
+      lo = std::min(lo, it->first);
+      hi = std::max(hi, it->second);
+      it = mappings_.erase(it);
+    }
+    mappings_[lo] = hi;
+    return base;
+  }
+
+  // the pages of another mapped range cannot move, the host may hold pointers to them
+  auto overlap = mappings_.lower_bound(end);
+  if (overlap != mappings_.begin() && std::prev(overlap)->second > first) {
+    return nullptr;
+  }
+
+  auto ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (ptr == MAP_FAILED) {
+    throw std::bad_alloc();
+  }
+  arenas_.emplace_back(ptr, size);
+  base = (uint8_t*)ptr;
+
+  // move the existing pages into the new range, their old storage is
+  // recycled for the next page allocations
+  std::unordered_map<uint64_t, uint8_t*> moved;
+  for (uint64_t i = 0; i < num_pages; ++i) {
+    auto slot = this->page_slot(first + i);
+    auto page = base + (i << page_bits_);
+    if (*slot != nullptr) {
+      memcpy(page, *slot, page_size);
+      free_pages_.push_back((uint8_t*)*slot);
+      moved[first + i] = page;
+    } else {
+      // same content as a page allocated on first access
+      fill_uninitialized(page, page_size);
+      page_list_.emplace_back(first + i, page);
+    }
+    *slot = page;
+  }
+  if (!moved.empty()) {
+    for (auto& entry : page_list_) {
+      auto it = moved.find(entry.first);
+      if (it != moved.end()) {
+        entry.second = it->second;
+      }
+    }
+  }
+
+  mappings_[first] = end;
+
+  // invalidate the TLB entries of all threads
+  id_ = ram_next_id();
+  return base;
+}
+
+void RAM::unmap(uint64_t addr, uint64_t size) {
+  if (size == 0)
+    return;
+  uint64_t first = addr >> page_bits_;
+  uint64_t last = (addr + size - 1) >> page_bits_;
+  {
+    std::unique_lock<std::mutex> lock(dir_mutex_, std::defer_lock);
+    if (concurrent_) {
+      lock.lock();
+    }
+    // the pages keep their storage, they can be moved by a later mapping
+    auto it = mappings_.lower_bound(last + 1);
+    while (it != mappings_.begin() && std::prev(it)->second > first) {
+      it = mappings_.erase(std::prev(it));
+    }
+  }
+  // the host may have overwritten cached code
+  for (uint64_t i = first; i <= last; ++i) {
+    auto& shard = this->shard(i);
+    std::unique_lock<std::mutex> lock(shard.mutex, std::defer_lock);
+    if (concurrent_) {
+      lock.lock();
+    }
+    this->invalidate_code(shard, i);
+  }
+}
+
 void RAM::loadBinImage(const char* filename, uint64_t destination) {
-  std::ifstream ifs(filename);
-  if (!ifs) {
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
     std::cout << "error: " << filename << " not found" << std::endl;
     std::abort();
   }
-
-  ifs.seekg(0, ifs.end);
-  size_t size = ifs.tellg();
-  std::vector<uint8_t> content(size);
-  ifs.seekg(0, ifs.beg);
-  ifs.read((char*)content.data(), size);
+  struct stat st;
+  uint64_t size = (fstat(fd, &st) == 0) ? st.st_size : 0;
 
   this->clear();
-  this->write(content.data(), destination, size);
+
+  if (size != 0 && !this->map_image(fd, size, destination)) {
+    auto addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) {
+      std::cout << "error: cannot map " << filename << std::endl;
+      std::abort();
+    }
+    this->write(addr, destination, size);
+    munmap(addr, size);
+  }
+  close(fd);
+}
+
+bool RAM::map_image(int fd, uint64_t size, uint64_t destination) {
+  // the image pages are used in place, so they must align with host pages
+  uint64_t page_size = uint64_t(1) << page_bits_;
+  uint64_t host_page_size = sysconf(_SC_PAGESIZE);
+  if (0 != (page_size % host_page_size)
+   || 0 != (destination & (page_size - 1))
+   || size < page_size) {
+    return false;
+  }
+  if (capacity_ != 0 && (destination >= capacity_ || size > capacity_ - destination)) {
+    throw OutOfRange();
+  }
+
+  // private writable mapping, stores only copy the pages they touch
+  auto addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  if (addr == MAP_FAILED) {
+    return false;
+  }
+  arenas_.emplace_back(addr, size);
+
+  auto image = (uint8_t*)addr;
+  uint64_t mapped = size & ~(page_size - 1);
+  for (uint64_t offset = 0; offset < mapped; offset += page_size) {
+    uint64_t page_index = (destination + offset) >> page_bits_;
+    *this->page_slot(page_index) = image + offset;
+    page_list_.emplace_back(page_index, image + offset);
+  }
+
+  // the last partial page would fault past the end of the file
+  if (mapped != size) {
+    this->write(image + mapped, destination + mapped, size - mapped);
+  }
+  return true;
+}
+
+// hex digit values, -1 for non-hex characters
+static const int8_t* hex_table() {
+  static const auto s_table = []() {
+    std::array<int8_t, 256> table;
+    table.fill(-1);
+    for (int i = 0; i < 10; ++i) {
+      table['0' + i] = i;
+    }
+    for (int i = 0; i < 6; ++i) {
+      table['a' + i] = 10 + i;
+      table['A' + i] = 10 + i;
+    }
+    return table;
+  }();
+  return s_table.data();
 }
 
 void RAM::loadHexImage(const char* filename) {
-  auto hti = [&](char c)->uint32_t {
-    if (c >= 'A' && c <= 'F')
-      return c - 'A' + 10;
-    if (c >= 'a' && c <= 'f')
-      return c - 'a' + 10;
-    return c - '0';
-  };
+  auto table = hex_table();
 
   auto hToI = [&](const char *c, uint32_t size)->uint32_t {
     uint32_t value = 0;
     for (uint32_t i = 0; i < size; i++) {
-      value += hti(c[i]) << ((size - i - 1) * 4);
+      value = (value << 4) | table[(uint8_t)c[i]];
     }
     return value;
   };
 
-  std::ifstream ifs(filename);
-  if (!ifs) {
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
     std::cout << "error: " << filename << " not found" << std::endl;
     std::abort();
   }
-
-  ifs.seekg(0, ifs.end);
-  size_t size = ifs.tellg();
-  std::vector<char> content(size);
-  ifs.seekg(0, ifs.beg);
-  ifs.read(content.data(), size);
-
-  uint32_t offset = 0;
-  char *line = content.data();
+  struct stat st;
+  uint64_t size = (fstat(fd, &st) == 0) ? st.st_size : 0;
+  const char* content = nullptr;
+  if (size != 0) {
+    auto addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) {
+      std::cout << "error: cannot map " << filename << std::endl;
+      std::abort();
+    }
+    madvise(addr, size, MADV_SEQUENTIAL);
+    content = (const char*)addr;
+  }
+  close(fd);
 
   this->clear();
 
-  while (true) {
-    if (line[0] == ':') {
+  uint32_t offset = 0;
+  uint8_t data[256];
+  const char* line = content;
+  const char* end = content + size;
+
+  while (line < end) {
+    auto eol = (const char*)memchr(line, '\n', end - line);
+    if (eol == nullptr) {
+      eol = end;
+    }
+    if (line[0] == ':' && (eol - line) >= 11) {
       uint32_t byteCount = hToI(line + 1, 2);
       uint32_t nextAddr = hToI(line + 3, 4) + offset;
       uint32_t key = hToI(line + 7, 2);
       switch (key) {
-      case 0:
+      case 0: {
+        // decode the record two digits at a time and store it in one copy
+        auto digits = (const uint8_t*)line + 9;
+        byteCount = std::min<uint32_t>(byteCount, (eol - line - 11) / 2);
         for (uint32_t i = 0; i < byteCount; i++) {
-          uint32_t addr  = nextAddr + i;
-          uint32_t value = hToI(line + 9 + i * 2, 2);
-          *this->get(addr) = value;
+          data[i] = (table[digits[2 * i]] << 4) | table[digits[2 * i + 1]];
         }
-        break;
+        this->write(data, nextAddr, byteCount);
+      } break;
       case 2:
         offset = hToI(line + 9, 4) << 4;
         break;
@@ -580,14 +990,11 @@ void RAM::loadHexImage(const char* filename) {
         break;
       }
     }
-    while (*line != '\n' && size != 0) {
-      ++line;
-      --size;
-    }
-    if (size <= 1)
-      break;
-    ++line;
-    --size;
+    line = eol + 1;
+  }
+
+  if (content) {
+    munmap((void*)content, size);
   }
 }
 
@@ -20,6 +20,8 @@
 #include <cstdint>
 #include <unordered_set>
 #include <stdexcept>
+#include <atomic>
+#include <mutex>
 #include "VX_config.h"
 #ifdef VM_ENABLE
 #include <unordered_set>
@@ -30,6 +32,9 @@
 
 namespace vortex {
 
+class CheckpointWriter;
+class CheckpointReader;
+
 
 #ifdef VM_ENABLE
 
@@ -363,9 +368,28 @@ public:
   void read(void* data, uint64_t addr, uint64_t size) override;
   void write(const void* data, uint64_t addr, uint64_t size) override;
 
+  // host accesses, they bypass the access rights so that the host does not
+  // have to toggle them while the device may be running
+  void backdoor_read(void* data, uint64_t addr, uint64_t size);
+  void backdoor_write(const void* data, uint64_t addr, uint64_t size);
+
+  // back a page-aligned range with contiguous host memory and return it,
+  // the host pointer aliases the device pages until the range is unmapped.
+  // returns nullptr if the range partially overlaps another mapped range,
+  // whose host pointers would stop aliasing the device pages.
+  // host writes through the pointer are not seen by the decode caches
+  // until the range is unmapped
+  uint8_t* map(uint64_t addr, uint64_t size);
+
+  // end host accesses to a mapped range, the cached code of the range is
+  // invalidated since the host writes were not tracked
+  void unmap(uint64_t addr, uint64_t size);
+
   void loadBinImage(const char* filename, uint64_t destination);
   void loadHexImage(const char* filename);
 
+  // the page lookup goes through the directory lock in concurrent mode,
+  // the returned byte stays valid until the RAM is cleared
   uint8_t& operator[](uint64_t address) {
     return *this->get(address);
   }
@@ -380,17 +404,89 @@ public:
     check_acl_ = enable;
   }
 
+  // lock accesses, needed when multiple simulation threads or the host and a
+  // running device share this memory. page accesses lock the shard of their
+  // page, page allocation and mapping lock the page directory, so threads
+  // working on different pages proceed in parallel
+  void set_concurrent(bool enable) {
+    concurrent_ = enable;
+  }
+
+  // flag the page holding this address as containing cached code,
+  // returns the code version of the page
+  uint64_t mark_code_page(uint64_t address);
+
+  // code version of the page holding this address,
+  // -1 if it is not flagged as code anymore
+  uint64_t code_page_version(uint64_t address);
+
+  // incremented whenever a code page gets modified
+  uint64_t code_version() const {
+    return code_version_.load(std::memory_order_relaxed);
+  }
+
+  // write the allocated pages only
+  void save(CheckpointWriter& ckpt) const;
+
+  void restore(CheckpointReader& ckpt);
+
 private:
 
   uint8_t *get(uint64_t address) const;
 
+  // walk the page directory, allocating missing levels and the page
+  uint8_t* find_page(uint64_t page_index) const;
+
+  // return the directory entry of a page, allocating missing levels
+  void** page_slot(uint64_t page_index) const;
+
+  // map a file image copy-on-write, returns false if it must be copied
+  bool map_image(int fd, uint64_t size, uint64_t destination);
+
+  void** alloc_node() const;
+
+  uint8_t* alloc_page() const;
+
+  // code pages tracking and lock of the pages hashing to a shard
+  struct alignas(64) shard_t {
+    std::mutex mutex;
+    std::unordered_map<uint64_t, uint64_t> code_pages; // page -> last code version
+  };
+
+  static constexpr uint32_t NUM_SHARDS = 64;
+
+  shard_t& shard(uint64_t page_index) {
+    return shards_[page_index & (NUM_SHARDS - 1)];
+  }
+
+  // bump the code version of a page if it holds cached code,
+  // its shard must be locked
+  void invalidate_code(shard_t& shard, uint64_t page_index);
+
   uint64_t capacity_;
   uint32_t page_bits_;
-  mutable std::unordered_map<uint64_t, uint8_t*> pages_;
-  mutable uint8_t* last_page_;
-  mutable uint64_t last_page_index_;
+  uint64_t id_;
+
+  // radix page directory, indexed by page number
+  uint32_t levels_;
+  uint32_t level_bits_;
+  void** root_;
+  mutable std::vector<void**> nodes_;
+  mutable std::vector<std::pair<uint64_t, uint8_t*>> page_list_;
+
+  // pages are carved out of mmap'ed arenas
+  mutable std::vector<std::pair<void*, uint64_t>> arenas_;
+  mutable uint8_t* arena_ptr_;
+  mutable uint64_t arena_left_;
+  mutable uint64_t arena_size_;
+  mutable std::vector<uint8_t*> free_pages_; // storage of pages moved by map()
+  std::map<uint64_t, uint64_t> mappings_;   // first page -> end page of the mapped ranges
   ACLManager acl_mngr_;
   bool check_acl_;
+  shard_t shards_[NUM_SHARDS];
+  std::atomic<uint64_t> code_version_;
+  mutable std::mutex dir_mutex_;
+  std::atomic<bool> concurrent_;
 };
 
 #ifdef VM_ENABLE
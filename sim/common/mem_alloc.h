@@ -14,11 +14,24 @@
 #pragma once
 
 #include <cstdint>
+#include <algorithm>
 #include <assert.h>
 #include <stdio.h>
+#include <map>
+#include <set>
+#include <unordered_map>
 
 namespace vortex {
 
+// Device memory allocator.
+// The address space is carved into pages (pageAlign granularity) which are
+// split into blocks (blockAlign granularity). Free blocks are indexed by size:
+// small sizes live in exact-size bins located through a bitmask, larger ones in
+// an ordered set, so allocation is a best-fit lookup in O(log n). Used blocks
+// are looked up by address through a hash table, and adjacent free blocks are
+// merged through their in-page neighbor links. New pages are placed first-fit
+// at the lowest unused address, found in O(log n) through a treap of the
+// unused address ranges that keeps the largest range of each subtree.
 class MemoryAllocator {
 public:
   MemoryAllocator(
@@ -30,27 +43,30 @@ public:
     , capacity_(capacity)
     , pageAlign_(pageAlign)
     , blockAlign_(blockAlign)
-    , pages_(nullptr)
+    , gapRoot_(nullptr)
+    , gapSeed_(0x9e3779b9)
+    , binMask_(0)
     , allocated_(0)
-  {}
+  {
+    for (auto& bin : bins_) {
+      bin = nullptr;
+    }
+    this->insertGap(baseAddress, capacity);
+  }
 
   ~MemoryAllocator() {
-    // Free allocated pages
-    page_t* currPage = pages_;
-    while (currPage) {
-      auto nextPage = currPage->next;
-      #ifdef VM_ENABLE
-      block_t* currblock = currPage->findfirstUsedBlock();
-      block_t* nextblock;
-      while (currblock) {
-        nextblock= currblock->nextUsed;
-        currPage->release(currblock);
-        currblock = nextblock;
+    // Free all pages, including blocks still in use
+    for (auto& entry : pages_) {
+      auto page = entry.second;
+      auto block = page->blocks;
+      while (block) {
+        auto next = block->next;
+        delete block;
+        block = next;
       }
-      #endif
-      delete currPage;
-      currPage = nextPage;
+      delete page;
     }
+    this->deleteGapNodes(gapRoot_);
   }
 
   uint32_t baseAddress() const {
@@ -79,7 +95,7 @@ public:
     size = alignSize(size, pageAlign_);
 
     // Check if the reservation is within memory capacity bounds
-    if (addr + size > baseAddress_ + capacity_) {
+    if (addr < baseAddress_ || addr + size > baseAddress_ + capacity_) {
       printf("error: address range out of bounds - requested=0x%lx, base+capacity=0x%lx\n", (addr + size), (baseAddress_ +capacity_));
       return -1;
     }
@@ -95,8 +111,7 @@ public:
     auto newPage = this->createPage(addr, size);
 
     // allocate space on free block
-    auto freeBlock = newPage->findFreeBlock(size);
-    newPage->allocate(size, freeBlock);
+    this->allocateBlock(newPage->blocks, size);
 
     // Update allocated size
     allocated_ += size;
@@ -113,15 +128,8 @@ public:
     // Align allocation size
     size = alignSize(size, blockAlign_);
 
-    // Walk thru all pages to find a free block
-    block_t* freeBlock = nullptr;
-    auto currPage = pages_;
-    while (currPage) {
-      freeBlock = currPage->findFreeBlock(size);
-      if (freeBlock != nullptr)
-        break;
-      currPage = currPage->next;
-    }
+    // Look up the best fitting free block
+    auto freeBlock = this->findFreeBlock(size);
 
     // Allocate a new page if no free block is found
     if (freeBlock == nullptr) {
@@ -131,16 +139,12 @@ public:
         printf("error: out of memory (Can't find next address)\n");
         return -1;
       }
-      currPage = this->createPage(pageAddr, pageSize);
-      if (nullptr == currPage) {
-        printf("error: out of memory (Can't create a page)\n");
-        return -1;
-      }
-      freeBlock = currPage->findFreeBlock(size);
+      auto newPage = this->createPage(pageAddr, pageSize);
+      freeBlock = newPage->blocks;
     }
 
     // allocate space on free block
-    currPage->allocate(size, freeBlock);
+    this->allocateBlock(freeBlock, size);
 
     // Return the free block address
     *addr = freeBlock->addr;
@@ -152,31 +156,20 @@ public:
   }
 
   int release(uint64_t addr) {
-    // Walk all pages to find the pointer
-    block_t* usedBlock = nullptr;
-    auto currPage = pages_;
-    while (currPage) {
-      usedBlock = currPage->findUsedBlock(addr);
-      if (usedBlock != nullptr)
-        break;
-      currPage = currPage->next;
-    }
-
-    // found the corresponding block?
-    if (nullptr == usedBlock) {
+    // Find the corresponding block
+    auto it = usedBlocks_.find(addr);
+    if (it == usedBlocks_.end()) {
       printf("warning: release address not found: 0x%lx\n", addr);
       return -1;
     }
 
+    auto usedBlock = it->second;
+    usedBlocks_.erase(it);
+
     auto size = usedBlock->size;
 
     // release the used block
-    currPage->release(usedBlock);
-
-    // Free the page if empty
-    if (currPage->empty()) {
-      this->deletePage(currPage);
-    }
+    this->releaseBlock(usedBlock);
 
     // update allocated size
     allocated_ -= size;
@@ -186,358 +179,367 @@ public:
 
 private:
 
-  struct block_t {
-    block_t* nextFreeS;
-    block_t* prevFreeS;
+  // number of exact-size bins, sized to fit the bin bitmask
+  static constexpr uint32_t NUM_BINS = 64;
+
+  struct page_t;
 
-    block_t* nextFreeM;
-    block_t* prevFreeM;
+  struct block_t {
+    // neighbors within the page, in address order
+    block_t* prev;
+    block_t* next;
 
-    block_t* nextUsed;
-    block_t* prevUsed;
+    // links within the size bin
+    block_t* prevFree;
+    block_t* nextFree;
 
+    page_t*  page;
     uint64_t addr;
     uint64_t size;
-
-    block_t(uint64_t addr, uint64_t size)
-      : nextFreeS(nullptr)
-      , prevFreeS(nullptr)
-      , nextFreeM(nullptr)
-      , prevFreeM(nullptr)
-      , nextUsed(nullptr)
-      , prevUsed(nullptr)
+    bool     free;
+
+    block_t(page_t* page, uint64_t addr, uint64_t size)
+      : prev(nullptr)
+      , next(nullptr)
+      , prevFree(nullptr)
+      , nextFree(nullptr)
+      , page(page)
       , addr(addr)
       , size(size)
+      , free(true)
     {}
   };
 
   struct page_t {
-    page_t*  next;
     uint64_t addr;
     uint64_t size;
+    uint32_t used;
+    block_t* blocks;
 
-    page_t(uint64_t addr, uint64_t size, uint32_t blockAlign) :
-      next(nullptr),
-      addr(addr),
-      size(size),
-      blockAlign_(blockAlign),
-      usedList_(nullptr) {
-      freeSList_ = freeMList_ = new block_t(addr, size);
-    }
+    page_t(uint64_t addr, uint64_t size)
+      : addr(addr)
+      , size(size)
+      , used(0)
+      , blocks(nullptr)
+    {}
+  };
 
-    ~page_t() {
-      // The page should be empty
-      assert(nullptr == usedList_);
-      assert(freeMList_
-          && (nullptr == freeMList_->nextFreeM)
-          && (nullptr == freeMList_->prevFreeM));
-      delete freeMList_;
-    }
+  // unused address range, ordered by address, with the largest range
+  // of its subtree
+  struct gap_node_t {
+    uint64_t    addr;
+    uint64_t    size;
+    uint64_t    maxSize;
+    uint32_t    priority;
+    gap_node_t* left;
+    gap_node_t* right;
+
+    gap_node_t(uint64_t addr, uint64_t size, uint32_t priority)
+      : addr(addr)
+      , size(size)
+      , maxSize(size)
+      , priority(priority)
+      , left(nullptr)
+      , right(nullptr)
+    {}
+  };
 
-    bool empty() const {
-      return (usedList_ == nullptr);
+  // order large free blocks by size, then address
+  struct block_cmp_t {
+    bool operator()(const block_t* lhs, const block_t* rhs) const {
+      if (lhs->size != rhs->size)
+        return lhs->size < rhs->size;
+      return lhs->addr < rhs->addr;
     }
+  };
 
-    void allocate(uint64_t size, block_t* freeBlock) {
-      // Remove the block from the free lists
-      this->removeFreeMList(freeBlock);
-      this->removeFreeSList(freeBlock);
-
-      // If the free block we have found is larger than what we are looking for,
-      // we may be able to split our free block in two.
-      uint64_t extraBytes = freeBlock->size - size;
-      if (extraBytes >= blockAlign_) {
-        // Reduce the free block size to the requested value
-        freeBlock->size = size;
-
-        // Allocate a new block to contain the extra buffer
-        auto nextAddr = freeBlock->addr + size;
-        auto newBlock = new block_t(nextAddr, extraBytes);
-
-        // Add the new block to the free lists
-        this->insertFreeMList(newBlock);
-        this->insertFreeSList(newBlock);
+  void allocateBlock(block_t* freeBlock, uint64_t size) {
+    // Remove the block from the free index
+    this->removeFreeBlock(freeBlock);
+
+    // If the free block we have found is larger than what we are looking for,
+    // split it in two and return the remainder to the free index.
+    uint64_t extraBytes = freeBlock->size - size;
+    if (extraBytes >= blockAlign_) {
+      // Reduce the free block size to the requested value
+      freeBlock->size = size;
+
+      // Allocate a new block to contain the extra buffer
+      auto newBlock = new block_t(freeBlock->page, freeBlock->addr + size, extraBytes);
+      newBlock->prev = freeBlock;
+      newBlock->next = freeBlock->next;
+      if (newBlock->next) {
+        newBlock->next->prev = newBlock;
       }
-
-      // Insert the free block into the used list
-      this->insertUsedList(freeBlock);
+      freeBlock->next = newBlock;
+      this->insertFreeBlock(newBlock);
     }
 
-    void release(block_t* usedBlock) {
-      // Remove the block from the used list
-      this->removeUsedList(usedBlock);
-
-      // Insert the block into the free M-list.
-      this->insertFreeMList(usedBlock);
-
-      // Check if we can merge adjacent free blocks from the left.
-      if (usedBlock->prevFreeM) {
-        // Calculate the previous address
-        auto prevAddr = usedBlock->prevFreeM->addr + usedBlock->prevFreeM->size;
-        if (usedBlock->addr == prevAddr) {
-          auto prevBlock = usedBlock->prevFreeM;
-
-          // Merge the blocks to the left
-          prevBlock->size += usedBlock->size;
-          prevBlock->nextFreeM = usedBlock->nextFreeM;
-          if (prevBlock->nextFreeM) {
-            prevBlock->nextFreeM->prevFreeM = prevBlock;
-          }
-
-          // Detach previous block from the free S-list since size increased
-          this->removeFreeSList(prevBlock);
-
-          // reset usedBlock
-          delete usedBlock;
-          usedBlock = prevBlock;
-        }
-      }
+    // Mark the block as used
+    freeBlock->free = false;
+    freeBlock->page->used += 1;
+    usedBlocks_[freeBlock->addr] = freeBlock;
+  }
 
-      // Check if we can merge adjacent free blocks from the right.
-      if (usedBlock->nextFreeM) {
-        // Calculate the next allocation start address
-        auto nextAddr = usedBlock->addr + usedBlock->size;
-        if (usedBlock->nextFreeM->addr == nextAddr) {
-          auto nextBlock = usedBlock->nextFreeM;
-
-          // Merge the blocks to the right
-          usedBlock->size += nextBlock->size;
-          usedBlock->nextFreeM = nextBlock->nextFreeM;
-          if (usedBlock->nextFreeM) {
-            usedBlock->nextFreeM->prevFreeM = usedBlock;
-          }
-
-          // Delete next block
-          this->removeFreeSList(nextBlock);
-          delete nextBlock;
-        }
+  void releaseBlock(block_t* block) {
+    auto page = block->page;
+    block->free = true;
+    page->used -= 1;
+
+    // Merge with the left neighbor
+    auto prevBlock = block->prev;
+    if (prevBlock && prevBlock->free) {
+      this->removeFreeBlock(prevBlock);
+      prevBlock->size += block->size;
+      prevBlock->next = block->next;
+      if (prevBlock->next) {
+        prevBlock->next->prev = prevBlock;
       }
-
-      // Insert the block into the free S-list.
-      this->insertFreeSList(usedBlock);
+      delete block;
+      block = prevBlock;
     }
 
-    block_t* findFreeBlock(uint64_t size) {
-      auto freeBlock = freeSList_;
-      if (freeBlock) {
-        // The free S-list is already sorted with the largest block first
-        // Quick check if the head block has enough space.
-        if (freeBlock->size >= size) {
-          // Find the smallest matching block in the S-list
-          while (freeBlock->nextFreeS && (freeBlock->nextFreeS->size >= size)) {
-            freeBlock = freeBlock->nextFreeS;
-          }
-          // Return the free block
-          return freeBlock;
-        }
+    // Merge with the right neighbor
+    auto nextBlock = block->next;
+    if (nextBlock && nextBlock->free) {
+      this->removeFreeBlock(nextBlock);
+      block->size += nextBlock->size;
+      block->next = nextBlock->next;
+      if (block->next) {
+        block->next->prev = block;
       }
-      return nullptr;
+      delete nextBlock;
     }
 
-    block_t* findUsedBlock(uint64_t addr) {
-      if (addr >= this->addr && addr < (this->addr + this->size)) {
-        auto useBlock = usedList_;
-        while (useBlock) {
-          if (useBlock->addr == addr)
-            return useBlock;
-          useBlock = useBlock->nextUsed;
-        }
-      }
-      return nullptr;
-    }
-#ifdef VM_ENABLE 
-    block_t* findfirstUsedBlock() {
-      return usedList_;
+    // Free the page if empty
+    if (0 == page->used) {
+      assert(block == page->blocks && block->size == page->size);
+      delete block;
+      this->deletePage(page);
+      return;
     }
-#endif
 
-  private:
+    this->insertFreeBlock(block);
+  }
 
-    void insertUsedList(block_t* block) {
-      block->nextUsed = usedList_;
-      if (usedList_) {
-        usedList_->prevUsed = block;
-      }
-      usedList_ = block;
-    }
+  int binIndex(uint64_t size) const {
+    uint64_t units = size / blockAlign_;
+    return (units <= NUM_BINS) ? int(units - 1) : -1;
+  }
 
-    void removeUsedList(block_t* block) {
-      if (block->prevUsed) {
-        block->prevUsed->nextUsed = block->nextUsed;
-      } else {
-        usedList_ = block->nextUsed;
+  block_t* findFreeBlock(uint64_t size) {
+    // Check the exact-size bins first
+    int bin = this->binIndex(size);
+    if (bin >= 0) {
+      uint64_t mask = binMask_ & (~0ull << bin);
+      if (mask != 0) {
+        return bins_[__builtin_ctzll(mask)];
       }
-      if (block->nextUsed) {
-        block->nextUsed->prevUsed = block->prevUsed;
-      }
-      block->nextUsed = nullptr;
-      block->prevUsed = nullptr;
     }
+    // Then the smallest large block that fits
+    block_t key(nullptr, 0, size);
+    auto it = largeBlocks_.lower_bound(&key);
+    if (it != largeBlocks_.end())
+      return *it;
+    return nullptr;
+  }
 
-    void insertFreeMList(block_t* block) {
-      block_t* currBlock = freeMList_;
-      block_t* prevBlock = nullptr;
-      while (currBlock && (currBlock->addr < block->addr)) {
-        prevBlock = currBlock;
-        currBlock = currBlock->nextFreeM;
-      }
-      block->nextFreeM = currBlock;
-      block->prevFreeM = prevBlock;
-      if (prevBlock) {
-        prevBlock->nextFreeM = block;
-      } else {
-        freeMList_ = block;
-      }
-      if (currBlock) {
-        currBlock->prevFreeM = block;
-      }
+  void insertFreeBlock(block_t* block) {
+    int bin = this->binIndex(block->size);
+    if (bin < 0) {
+      largeBlocks_.insert(block);
+      return;
     }
-
-    void removeFreeMList(block_t* block) {
-      if (block->prevFreeM) {
-        block->prevFreeM->nextFreeM = block->nextFreeM;
-      } else {
-        freeMList_ = block->nextFreeM;
-      }
-      if (block->nextFreeM) {
-        block->nextFreeM->prevFreeM = block->prevFreeM;
-      }
-      block->nextFreeM = nullptr;
-      block->prevFreeM = nullptr;
+    block->prevFree = nullptr;
+    block->nextFree = bins_[bin];
+    if (bins_[bin]) {
+      bins_[bin]->prevFree = block;
     }
+    bins_[bin] = block;
+    binMask_ |= (1ull << bin);
+  }
 
-    void insertFreeSList(block_t* block) {
-      block_t* currBlock = freeSList_;
-      block_t* prevBlock = nullptr;
-      while (currBlock && (currBlock->size > block->size)) {
-        prevBlock = currBlock;
-        currBlock = currBlock->nextFreeS;
-      }
-      block->nextFreeS = currBlock;
-      block->prevFreeS = prevBlock;
-      if (prevBlock) {
-        prevBlock->nextFreeS = block;
-      } else {
-        freeSList_ = block;
-      }
-      if (currBlock) {
-        currBlock->prevFreeS = block;
-      }
+  void removeFreeBlock(block_t* block) {
+    int bin = this->binIndex(block->size);
+    if (bin < 0) {
+      largeBlocks_.erase(block);
+      return;
     }
-
-    void removeFreeSList(block_t* block) {
-      if (block->prevFreeS) {
-        block->prevFreeS->nextFreeS = block->nextFreeS;
-      } else {
-        freeSList_ = block->nextFreeS;
-      }
-      if (block->nextFreeS) {
-        block->nextFreeS->prevFreeS = block->prevFreeS;
+    if (block->prevFree) {
+      block->prevFree->nextFree = block->nextFree;
+    } else {
+      bins_[bin] = block->nextFree;
+      if (nullptr == bins_[bin]) {
+        binMask_ &= ~(1ull << bin);
       }
-      block->nextFreeS = nullptr;
-      block->prevFreeS = nullptr;
     }
-
-    // block alignment
-    uint32_t blockAlign_;
-
-    // List of used blocks
-    block_t* usedList_;
-
-    // List with blocks sorted by decreasing sizes
-    // Used for block lookup during memory allocation.
-    block_t* freeSList_;
-
-    // List with blocks sorted by increasing memory addresses
-    // Used for block merging during memory release.
-    block_t* freeMList_;
-  };
+    if (block->nextFree) {
+      block->nextFree->prevFree = block->prevFree;
+    }
+    block->prevFree = nullptr;
+    block->nextFree = nullptr;
+  }
 
   page_t* createPage(uint64_t addr, uint64_t size) {
-    // Allocate object
-    auto newPage = new page_t(addr, size, blockAlign_);
+    // Carve the page out of the unused address space
+    this->removeGap(addr, size);
 
-    // Insert the new page into the list in address sorted order
-    if (pages_ == nullptr || pages_->addr > newPage->addr) {
-      newPage->next = pages_;
-      pages_ = newPage;
-    } else {
-      page_t* current = pages_;
-      while (current->next != nullptr && current->next->addr < newPage->addr) {
-        current = current->next;
-      }
-      newPage->next = current->next;
-      current->next = newPage;
-    }
+    auto newPage = new page_t(addr, size);
+    newPage->blocks = new block_t(newPage, addr, size);
+    pages_[addr] = newPage;
 
     return newPage;
   }
 
   void deletePage(page_t* page) {
-    // Remove the page from the list
-    page_t* prevPage = nullptr;
-    auto currPage = pages_;
-    while (currPage) {
-      if (currPage == page) {
-        if (prevPage) {
-          prevPage->next = currPage->next;
-        } else {
-          pages_ = currPage->next;
-        }
-        break;
-      }
-      prevPage = currPage;
-      currPage = currPage->next;
-    }
-    // Delete the page
+    pages_.erase(page->addr);
+    this->insertGap(page->addr, page->size);
     delete page;
   }
 
   bool findNextAddress(uint64_t size, uint64_t* addr) {
-    if (pages_ == nullptr) {
-      *addr = baseAddress_; 
-      return true;
-    }
-
-    page_t* current = pages_;
-    uint64_t endOfLastPage = baseAddress_;
-
-    while (current != nullptr) {
-      uint64_t startOfCurrentPage = current->addr;
-      if ((endOfLastPage + size) <= startOfCurrentPage) {
-        *addr = endOfLastPage;
+    // Pick the lowest unused address range that fits,
+    // so that pages grow upward from the base address
+    auto node = gapRoot_;
+    if (gapMaxSize(node) < size)
+      return false;
+    for (;;) {
+      if (gapMaxSize(node->left) >= size) {
+        node = node->left;
+      } else if (node->size >= size) {
+        *addr = node->addr;
         return true;
+      } else {
+        node = node->right;
       }
-      // Update the end of the last page to the end of the current page
-      // Move to the next page in the sorted list
-      endOfLastPage = current->addr + current->size;
-      current = current->next;
     }
-    
-    // If no suitable gap is found, place the new page at the end of the last page
-    // Check if the allocator has enough capacity
-    if ((endOfLastPage + size) <= (baseAddress_ + capacity_)) {
-      *addr = endOfLastPage;
+  }
+
+  bool hasPageOverlap(uint64_t start, uint64_t size, uint64_t* overlapStart, uint64_t* overlapEnd) {
+    // Pages are disjoint, so only the last page starting before the range end
+    // can overlap it.
+    uint64_t end = start + size;
+    auto it = pages_.lower_bound(end);
+    if (it == pages_.begin())
+      return false;
+    auto page = std::prev(it)->second;
+    uint64_t pageEnd = page->addr + page->size;
+    if (pageEnd > start) {
+      *overlapStart = page->addr;
+      *overlapEnd = pageEnd;
       return true;
     }
-
     return false;
   }
 
-  bool hasPageOverlap(uint64_t start, uint64_t size, uint64_t* overlapStart, uint64_t* overlapEnd) {
-    page_t* current = pages_;
-    while (current != nullptr) {
-      uint64_t pageStart = current->addr;
-      uint64_t pageEnd = pageStart + current->size;
-      uint64_t end = start + size;
-      if ((start <= pageEnd) && (end >= pageStart)) {
-        *overlapStart = pageStart;
-        *overlapEnd = pageEnd;
-        return true;
+  void insertGap(uint64_t addr, uint64_t size) {
+    // Coalesce with the following range
+    auto it = gaps_.lower_bound(addr);
+    if (it != gaps_.end() && it->first == addr + size) {
+      size += it->second;
+      this->eraseGapNode(it->first);
+      it = gaps_.erase(it);
+    }
+    // Coalesce with the preceding range
+    if (it != gaps_.begin()) {
+      auto prev = std::prev(it);
+      if (prev->first + prev->second == addr) {
+        addr = prev->first;
+        size += prev->second;
+        this->eraseGapNode(prev->first);
+        gaps_.erase(prev);
       }
-      current = current->next;
     }
-    return false;
+    gaps_[addr] = size;
+    this->insertGapNode(addr, size);
+  }
+
+  void removeGap(uint64_t addr, uint64_t size) {
+    auto it = gaps_.upper_bound(addr);
+    assert(it != gaps_.begin());
+    --it;
+    uint64_t gapAddr = it->first;
+    uint64_t gapSize = it->second;
+    assert(addr + size <= gapAddr + gapSize);
+    this->eraseGapNode(gapAddr);
+    gaps_.erase(it);
+    if (addr > gapAddr) {
+      gaps_[gapAddr] = addr - gapAddr;
+      this->insertGapNode(gapAddr, addr - gapAddr);
+    }
+    uint64_t tail = (gapAddr + gapSize) - (addr + size);
+    if (tail != 0) {
+      gaps_[addr + size] = tail;
+      this->insertGapNode(addr + size, tail);
+    }
+  }
+
+  static uint64_t gapMaxSize(const gap_node_t* node) {
+    return node ? node->maxSize : 0;
+  }
+
+  static void updateGapNode(gap_node_t* node) {
+    node->maxSize = std::max(node->size, std::max(gapMaxSize(node->left), gapMaxSize(node->right)));
+  }
+
+  // split a subtree into the ranges below addr and the others
+  static void splitGapNodes(gap_node_t* node, uint64_t addr, gap_node_t** lower, gap_node_t** upper) {
+    if (node == nullptr) {
+      *lower = nullptr;
+      *upper = nullptr;
+    } else if (node->addr < addr) {
+      splitGapNodes(node->right, addr, &node->right, upper);
+      updateGapNode(node);
+      *lower = node;
+    } else {
+      splitGapNodes(node->left, addr, lower, &node->left);
+      updateGapNode(node);
+      *upper = node;
+    }
+  }
+
+  // join two subtrees, all ranges of lower being below those of upper
+  static gap_node_t* mergeGapNodes(gap_node_t* lower, gap_node_t* upper) {
+    if (lower == nullptr)
+      return upper;
+    if (upper == nullptr)
+      return lower;
+    if (lower->priority > upper->priority) {
+      lower->right = mergeGapNodes(lower->right, upper);
+      updateGapNode(lower);
+      return lower;
+    }
+    upper->left = mergeGapNodes(lower, upper->left);
+    updateGapNode(upper);
+    return upper;
+  }
+
+  void insertGapNode(uint64_t addr, uint64_t size) {
+    // xorshift32 priorities keep the treap balanced
+    gapSeed_ ^= gapSeed_ << 13;
+    gapSeed_ ^= gapSeed_ >> 17;
+    gapSeed_ ^= gapSeed_ << 5;
+    gap_node_t *lower, *upper;
+    splitGapNodes(gapRoot_, addr, &lower, &upper);
+    auto node = new gap_node_t(addr, size, gapSeed_);
+    gapRoot_ = mergeGapNodes(mergeGapNodes(lower, node), upper);
+  }
+
+  void eraseGapNode(uint64_t addr) {
+    gap_node_t *lower, *node, *upper;
+    splitGapNodes(gapRoot_, addr, &lower, &node);
+    splitGapNodes(node, addr + 1, &node, &upper);
+    assert(node != nullptr && node->left == nullptr && node->right == nullptr);
+    delete node;
+    gapRoot_ = mergeGapNodes(lower, upper);
+  }
+
+  static void deleteGapNodes(gap_node_t* node) {
+    if (node == nullptr)
+      return;
+    deleteGapNodes(node->left);
+    deleteGapNodes(node->right);
+    delete node;
   }
 
   static uint64_t alignSize(uint64_t size, uint64_t alignment) {
@@ -549,8 +551,25 @@ private:
   uint64_t capacity_;
   uint32_t pageAlign_;
   uint32_t blockAlign_;
-  page_t*  pages_;
-  uint64_t nextAddress_;
+
+  // pages sorted by address
+  std::map<uint64_t, page_t*> pages_;
+
+  // unused address ranges by address, and their first-fit treap
+  std::map<uint64_t, uint64_t> gaps_;
+  gap_node_t* gapRoot_;
+  uint32_t gapSeed_;
+
+  // free blocks of up to NUM_BINS * blockAlign bytes, one bin per size
+  block_t* bins_[NUM_BINS];
+  uint64_t binMask_;
+
+  // larger free blocks
+  std::set<block_t*, block_cmp_t> largeBlocks_;
+
+  // used blocks by address
+  std::unordered_map<uint64_t, block_t*> usedBlocks_;
+
   uint64_t allocated_;
 };
 
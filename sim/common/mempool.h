@@ -1,10 +1,10 @@
 // Copyright © 2019-2023
-// 
+//
 // Licensed under the Apache License, Version 2.0 (the "License");
 // you may not use this file except in compliance with the License.
 // You may obtain a copy of the License at
 // http://www.apache.org/licenses/LICENSE-2.0
-// 
+//
 // Unless required by applicable law or agreed to in writing, software
 // distributed under the License is distributed on an "AS IS" BASIS,
 // WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
@@ -13,50 +13,98 @@
 
 #pragma once
 
-#include <stack>
+#include <stdint.h>
+#include <algorithm>
+#include <new>
+#include <vector>
 
+// allocation counters shared by all memory pools
+struct MemoryPoolStats {
+  uint64_t allocs; // objects handed out
+  uint64_t slabs;  // backing allocations
+  uint64_t bytes;  // backing memory size
+};
+
+inline MemoryPoolStats& mempool_stats() {
+  static MemoryPoolStats s_stats = {0, 0, 0};
+  return s_stats;
+}
+
+// Slab allocator for fixed-size objects.
+// Free objects are threaded into an intrusive list, so allocate/deallocate
+// are a couple of pointer moves. Slabs double in size each time the pool
+// runs dry, up to MAX_SLAB_SIZE objects after which fixed-size slabs are
+// added, so its capacity settles at the observed peak after a few
+// allocations and memory is only returned when the pool is destroyed.
 template <typename T>
 class MemoryPool {
-public:  
-  MemoryPool(uint32_t max_size) : max_size_(max_size) {}
+public:
+  static constexpr uint32_t MAX_SLAB_SIZE = 64 * 1024;
 
-  MemoryPool(MemoryPool && other) 
-    : free_list_(std::move(other.free_list_)) 
+  MemoryPool(uint32_t slab_size, MemoryPoolStats* stats = &mempool_stats())
+    : slab_size_(std::min(std::max<uint32_t>(slab_size, 1), MAX_SLAB_SIZE))
+    , free_list_(nullptr)
+    , stats_(stats)
   {}
 
+  MemoryPool(MemoryPool && other)
+    : slabs_(std::move(other.slabs_))
+    , slab_size_(other.slab_size_)
+    , free_list_(other.free_list_)
+    , stats_(other.stats_) {
+    other.free_list_ = nullptr;
+  }
+
   ~MemoryPool() {
     this->flush();
   }
 
   void* allocate() {
-    void* mem;
-    if (!free_list_.empty()) {
-      auto entry = free_list_.top();
-      free_list_.pop();
-      mem = static_cast<void*>(entry);      
-    } else {
-      mem = ::operator new(sizeof(T));
+    if (free_list_ == nullptr) {
+      this->grow();
     }
-    return mem;
+    auto node = free_list_;
+    free_list_ = node->next;
+    ++stats_->allocs;
+    return node;
   }
 
-  void deallocate(void * object) {
-    if (free_list_.size() < max_size_) {
-      free_list_.push(static_cast<T*>(object));
-    } else {
-      ::operator delete(object);
-    }
+  void deallocate(void* object) {
+    auto node = static_cast<node_t*>(object);
+    node->next = free_list_;
+    free_list_ = node;
   }
 
+  // release all slabs, all objects must have been deallocated
   void flush() {
-    while (!free_list_.empty()) {
-      auto entry = free_list_.top();
-      free_list_.pop();
-      ::operator delete(entry);      
+    for (auto slab : slabs_) {
+      ::operator delete(slab);
     }
+    slabs_.clear();
+    free_list_ = nullptr;
   }
 
 private:
-  std::stack<T*> free_list_;
-  uint32_t max_size_;
+
+  union node_t {
+    node_t* next;
+    alignas(T) uint8_t data[sizeof(T)];
+  };
+
+  void grow() {
+    auto slab = static_cast<node_t*>(::operator new(slab_size_ * sizeof(node_t)));
+    for (uint32_t i = 0; i < slab_size_; ++i) {
+      slab[i].next = (i + 1 < slab_size_) ? &slab[i + 1] : free_list_;
+    }
+    free_list_ = slab;
+    slabs_.push_back(slab);
+    ++stats_->slabs;
+    stats_->bytes += slab_size_ * sizeof(node_t);
+    slab_size_ = std::min(slab_size_ * 2, MAX_SLAB_SIZE);
+  }
+
+  std::vector<node_t*> slabs_;
+  uint32_t slab_size_;
+  node_t*  free_list_;
+  MemoryPoolStats* stats_;
 };
@@ -14,6 +14,11 @@
 #include "rvfloats.h"
 #include <stdio.h>
 
+// softfloat is built with a per-thread rounding mode and exception flags
+// (third_party/Makefile), so that simulation threads and devices running
+// side by side do not see each other's state
+#define THREAD_LOCAL thread_local
+
 extern "C" {
 #include <softfloat.h>
 #include "softfloat_ext.h"
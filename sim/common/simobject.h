@@ -18,7 +18,14 @@
 #include <memory>
 #include <vector>
 #include <list>
+#include <map>
 #include <queue>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
 #include <assert.h>
 #include "mempool.h"
 
@@ -34,14 +41,22 @@ public:
     return module_;
   }
 
+  // object woken up when a packet is delivered to this port,
+  // defaults to the owner (override when another object polls the port)
+  void set_consumer(SimObjectBase* consumer) {
+    consumer_ = consumer;
+  }
+
 protected:
   SimPortBase(SimObjectBase* module)
     : module_(module)
+    , consumer_(module)
   {}
 
   SimPortBase& operator=(const SimPortBase&) = delete;
 
   SimObjectBase* module_;
+  SimObjectBase* consumer_;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -114,16 +129,7 @@ protected:
   SimPort*   sink_;
   TxCallback tx_cb_;
 
-  void transfer(const Pkt& data, uint64_t cycles) {
-    if (tx_cb_) {
-      tx_cb_(data, cycles);
-    }
-    if (sink_) {
-      sink_->transfer(data, cycles);
-    } else {
-      queue_.push({data, cycles});
-    }
-  }
+  void transfer(const Pkt& data, uint64_t cycles);
 
   SimPort& operator=(const SimPort&) = delete;
 
@@ -132,10 +138,10 @@ protected:
 
 ///////////////////////////////////////////////////////////////////////////////
 
+// Events are owned by the platform: they are linked into the event queue
+// through an intrusive pointer and deleted (back into their pool) once fired.
 class SimEventBase {
 public:
-  typedef std::shared_ptr<SimEventBase> Ptr;
-
   virtual ~SimEventBase() {}
 
   virtual void fire() const = 0;
@@ -145,9 +151,17 @@ public:
   }
 
 protected:
-  SimEventBase(uint64_t cycles) : cycles_(cycles) {}
+  SimEventBase(uint64_t cycles)
+    : cycles_(cycles)
+    , next_(nullptr)
+  {}
 
   uint64_t cycles_;
+
+private:
+  SimEventBase* next_;
+
+  friend class SimPlatform;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -167,24 +181,16 @@ public:
     , pkt_(pkt)
   {}
 
-  void* operator new(size_t /*size*/) {
-    return allocator_.allocate();
-  }
+  // allocated from the pools of the current platform
+  void* operator new(size_t size);
 
-  void operator delete(void* ptr) {
-    allocator_.deallocate(ptr);
-  }
+  void operator delete(void* ptr);
 
 protected:
   Func func_;
   Pkt  pkt_;
-
-  static MemoryPool<SimCallEvent<Pkt>> allocator_;
 };
 
-template <typename Pkt>
-MemoryPool<SimCallEvent<Pkt>> SimCallEvent<Pkt>::allocator_(64);
-
 ///////////////////////////////////////////////////////////////////////////////
 
 template <typename Pkt>
@@ -200,24 +206,16 @@ public:
     , pkt_(pkt)
   {}
 
-  void* operator new(size_t /*size*/) {
-    return allocator_.allocate();
-  }
+  // allocated from the pools of the current platform
+  void* operator new(size_t size);
 
-  void operator delete(void* ptr) {
-    allocator_.deallocate(ptr);
-  }
+  void operator delete(void* ptr);
 
 protected:
   const SimPort<Pkt>* port_;
   Pkt pkt_;
-
-  static MemoryPool<SimPortEvent<Pkt>> allocator_;
 };
 
-template <typename Pkt>
-MemoryPool<SimPortEvent<Pkt>> SimPortEvent<Pkt>::allocator_(64);
-
 ///////////////////////////////////////////////////////////////////////////////
 
 class SimContext;
@@ -232,10 +230,26 @@ public:
     return name_;
   }
 
+  // resume ticking an object that went to sleep
+  void wake() {
+    asleep_ = false;
+  }
+
+  bool asleep() const {
+    return asleep_;
+  }
+
 protected:
 
   SimObjectBase(const SimContext& ctx, const std::string& name);
 
+  // stop ticking this object until it is woken up, either by a packet
+  // delivered to one of its ports or by an explicit wake().
+  // An object may only sleep when its next tick would have no effect.
+  void sleep() {
+    asleep_ = true;
+  }
+
 private:
 
   virtual void do_reset() = 0;
@@ -243,6 +257,8 @@ private:
   virtual void do_tick() = 0;
 
   std::string name_;
+  int partition_;
+  bool asleep_;
 
   friend class SimPlatform;
 };
@@ -291,31 +307,113 @@ private:
 
 ///////////////////////////////////////////////////////////////////////////////
 
+// Simulation context: objects, event queue and clock.
+// Each simulated device owns a platform, so that several devices can be
+// simulated side by side in one process. A thread works on the platform it
+// is bound to, or on a process-wide default one.
 class SimPlatform {
 public:
+  SimPlatform()
+    : event_wheel_(EVENT_WHEEL_SIZE, event_slot_t{nullptr, nullptr})
+    , cycles_(0)
+    , pending_events_(0)
+    , total_events_(0)
+    , peak_events_(0)
+    , skipped_cycles_(0)
+    , pool_stats_{0, 0, 0}
+    , idle_(false)
+    , clock_skip_(true)
+    , stages_dirty_(true)
+    , cur_partition_(-1)
+    , num_partitions_(0)
+    , num_threads_(1)
+    , work_stage_(nullptr)
+    , work_phase_(0)
+    , work_pending_(0)
+    , work_sleepers_(0)
+    , workers_exit_(false)
+    , adaptive_threads_(true)
+  {}
+
+  virtual ~SimPlatform() {
+    this->clear();
+  }
+
   static SimPlatform& instance() {
+    auto platform = current();
+    if (platform)
+      return *platform;
     static SimPlatform s_inst;
     return s_inst;
   }
 
+  // bind the calling thread to a platform for the scope's lifetime
+  class Scope {
+  public:
+    Scope(SimPlatform* platform) : prev_(current()) {
+      current() = platform;
+    }
+    ~Scope() {
+      current() = prev_;
+    }
+  private:
+    SimPlatform* prev_;
+  };
+
   bool initialize() {
     //--
     return true;
   }
 
   void finalize() {
-    instance().clear();
+    this->clear();
   }
 
   template <typename Impl, typename... Args>
   typename SimObject<Impl>::Ptr create_object(Args&&... args) {
     auto obj = std::make_shared<Impl>(SimContext{}, std::forward<Args>(args)...);
+    obj->partition_ = cur_partition_;
     objects_.push_back(obj);
+    stages_dirty_ = true;
     return obj;
   }
 
   void release_object(const SimObjectBase::Ptr& object) {
     objects_.remove(object);
+    stages_dirty_ = true;
+  }
+
+  // Objects created between begin_partition() and end_partition() form a
+  // partition: they only talk to objects outside of it through ports and
+  // may be ticked on a worker thread when multiple threads are enabled.
+  void begin_partition() {
+    assert(cur_partition_ == -1);
+    cur_partition_ = num_partitions_++;
+  }
+
+  void end_partition() {
+    cur_partition_ = -1;
+  }
+
+  void set_num_threads(uint32_t num_threads) {
+    if (num_threads == 0) {
+      num_threads = 1;
+    }
+    if (num_threads == num_threads_)
+      return;
+    this->stop_workers();
+    num_threads_ = num_threads;
+    stages_dirty_ = true;
+  }
+
+  uint32_t num_threads() const {
+    return num_threads_;
+  }
+
+  // partitions only run in parallel while it is measured to be faster,
+  // turn it off to always run them on the worker threads
+  void set_adaptive_threads(bool enable) {
+    adaptive_threads_ = enable;
   }
 
   template <typename Pkt>
@@ -323,75 +421,578 @@ public:
                 const Pkt& pkt,
                 uint64_t delay) {
     assert(delay != 0);
-    auto evt = std::make_shared<SimCallEvent<Pkt>>(callback, pkt, cycles_ + delay);
-    events_.emplace_back(evt);
+    auto staged = staged_events();
+    if (staged) {
+      stage_event<SimCallEvent<Pkt>>(staged, callback, pkt, cycles_ + delay);
+      return;
+    }
+    this->insert_event(new SimCallEvent<Pkt>(callback, pkt, cycles_ + delay));
   }
 
   void reset() {
-    events_.clear();
+    this->clear_events();
+    cycles_ = 0;
+    idle_ = false;
     for (auto& object : objects_) {
+      object->wake();
       object->do_reset();
     }
-    cycles_ = 0;
   }
 
   void tick() {
+    if (stages_dirty_) {
+      this->build_stages();
+    }
+    // every object went to sleep during the last cycle: nothing can
+    // happen before the next event fires, jump the clock to it.
+    // (objects can also be woken up by direct calls, confirm first)
+    if (idle_ && clock_skip_ && this->all_asleep()) {
+      this->skip_idle_cycles();
+    }
     // evaluate events
-    auto evt_it = events_.begin();
-    auto evt_it_end = events_.end();
-    while (evt_it != evt_it_end) {
-      auto& event = *evt_it;
-      if (cycles_ >= event->cycles()) {
-        event->fire();
-        evt_it = events_.erase(evt_it);
+    // (firing never schedules into the current slot since delay != 0)
+    auto& slot = event_wheel_[cycles_ & (EVENT_WHEEL_SIZE - 1)];
+    auto event = slot.head;
+    slot.head = nullptr;
+    slot.tail = nullptr;
+    while (event) {
+      auto next = event->next_;
+      event->fire();
+      delete event;
+      event = next;
+      --pending_events_;
+    }
+    // evaluate components, sleeping objects are skipped
+    uint32_t awake = 0;
+    for (auto& stage : stages_) {
+      if (stage.partitions.empty()) {
+        for (auto object : stage.objects) {
+          if (object->asleep_)
+            continue;
+          object->do_tick();
+          awake += !object->asleep_;
+        }
       } else {
-        ++evt_it;
+        awake += this->tick_partition_stage(stage);
       }
     }
-    // evaluate components
-    for (auto& object : objects_) {
-      object->do_tick();
-    }
+    idle_ = (awake == 0);
     // advance clock
     ++cycles_;
+    this->migrate_far_events();
+  }
+
+  // skipping idle cycles is on by default, turn it off to stop at every cycle
+  void set_clock_skip(bool enable) {
+    clock_skip_ = enable;
   }
 
   uint64_t cycles() const {
     return cycles_;
   }
 
+  struct PerfStats {
+    uint64_t events;        // total scheduled events
+    uint64_t peak_events;   // max events pending at once
+    uint64_t skipped_cycles; // cycles jumped over while all objects slept
+    uint64_t pool_allocs;   // pool allocations (all pooled types)
+    uint64_t pool_slabs;    // backing allocations made by the pools
+    uint64_t pool_bytes;    // backing memory held by the pools
+  };
+
+  PerfStats perf_stats() const {
+    return PerfStats{total_events_, peak_events_, skipped_cycles_, pool_stats_.allocs, pool_stats_.slabs, pool_stats_.bytes};
+  }
+
 private:
 
-  SimPlatform() : cycles_(0) {}
+  // number of cycles covered by the event wheel (power of two)
+  static constexpr uint64_t EVENT_WHEEL_SIZE = 256;
 
-  virtual ~SimPlatform() {
-    this->clear();
+  struct event_slot_t {
+    SimEventBase* head;
+    SimEventBase* tail;
+  };
+
+  // event scheduled by a partition ticked on a worker thread
+  struct staged_event_t {
+    SimEventBase* (*create)(void* buffer, uint32_t index);
+    void*    buffer;
+    uint32_t index;
+  };
+
+  struct partition_t {
+    std::vector<SimObjectBase*> objects;
+    std::vector<staged_event_t> events;
+    uint32_t awake;
+  };
+
+  // objects ticked in creation order, either serially on the main thread
+  // or as a group of partitions running in parallel
+  struct tick_stage_t {
+    std::vector<SimObjectBase*> objects;
+    std::vector<uint32_t> partitions;
+    // adaptive threading state of a partitions group
+    uint32_t mode;
+    uint64_t window;      // cycles left in the current mode
+    uint64_t serial_ns;   // time of the last serial probe
+    uint64_t parallel_ns; // time of the last parallel probe
+  };
+
+  enum { PROBE_SERIAL, PROBE_PARALLEL, RUN_SERIAL, RUN_PARALLEL };
+
+  // cycles timed in each mode, then cycles run in the faster one
+  static constexpr uint64_t PROBE_CYCLES = 256;
+  static constexpr uint64_t RUN_CYCLES = 64 * 1024;
+
+  static SimPlatform*& current() {
+    static thread_local SimPlatform* s_current = nullptr;
+    return s_current;
+  }
+
+  // event pool of this platform for the given event type
+  template <typename Event>
+  MemoryPool<Event>& event_pool() {
+    static const uint32_t s_index = next_pool_index();
+    if (s_index >= event_pools_.size()) {
+      event_pools_.resize(s_index + 1);
+    }
+    auto& holder = event_pools_[s_index];
+    if (!holder) {
+      holder.reset(new event_pool_t<Event>(&pool_stats_));
+    }
+    return static_cast<event_pool_t<Event>*>(holder.get())->pool;
+  }
+
+  static uint32_t next_pool_index() {
+    static std::atomic<uint32_t> s_next(0);
+    return s_next++;
   }
 
+  struct event_pool_base_t {
+    virtual ~event_pool_base_t() {}
+  };
+
+  template <typename Event>
+  struct event_pool_t : public event_pool_base_t {
+    event_pool_t(MemoryPoolStats* stats) : pool(64, stats) {}
+    MemoryPool<Event> pool;
+  };
+
   void clear() {
+    // events go back to this platform's pools
+    Scope scope(this);
+    this->stop_workers();
     objects_.clear();
-    events_.clear();
+    stages_.clear();
+    partitions_.clear();
+    stages_dirty_ = true;
+    this->clear_events();
+  }
+
+  void clear_events() {
+    for (auto& slot : event_wheel_) {
+      auto event = slot.head;
+      while (event) {
+        auto next = event->next_;
+        delete event;
+        event = next;
+      }
+      slot.head = nullptr;
+      slot.tail = nullptr;
+    }
+    for (auto& it : far_events_) {
+      delete it.second;
+    }
+    far_events_.clear();
+    pending_events_ = 0;
   }
 
   template <typename Pkt>
   void schedule(const SimPort<Pkt>* port, const Pkt& pkt, uint64_t delay) {
     assert(delay != 0);
-    auto evt = SimEventBase::Ptr(new SimPortEvent<Pkt>(port, pkt, cycles_ + delay));
-    events_.emplace_back(evt);
+    auto staged = staged_events();
+    if (staged) {
+      stage_event<SimPortEvent<Pkt>>(staged, port, pkt, cycles_ + delay);
+      return;
+    }
+    this->insert_event(new SimPortEvent<Pkt>(port, pkt, cycles_ + delay));
+  }
+
+  void insert_event(SimEventBase* evt) {
+    if (++pending_events_ > peak_events_) {
+      peak_events_ = pending_events_;
+    }
+    ++total_events_;
+    auto cycles = evt->cycles();
+    if (cycles < (cycles_ + EVENT_WHEEL_SIZE)) {
+      this->append_event(evt);
+    } else {
+      // multimap keeps insertion order among equal keys
+      far_events_.emplace(cycles, evt);
+    }
+  }
+
+  void append_event(SimEventBase* evt) {
+    auto& slot = event_wheel_[evt->cycles() & (EVENT_WHEEL_SIZE - 1)];
+    evt->next_ = nullptr;
+    if (slot.tail) {
+      slot.tail->next_ = evt;
+    } else {
+      slot.head = evt;
+    }
+    slot.tail = evt;
+  }
+
+  // move far events that entered the wheel window into their slot.
+  // this runs before any new insertion at the current cycle,
+  // which keeps per-slot events in scheduling order.
+  void migrate_far_events() {
+    while (!far_events_.empty()
+        && far_events_.begin()->first < (cycles_ + EVENT_WHEEL_SIZE)) {
+      auto it = far_events_.begin();
+      this->append_event(it->second);
+      far_events_.erase(it);
+    }
+  }
+
+  void skip_idle_cycles() {
+    if (pending_events_ == 0)
+      return;
+    uint64_t next = cycles_;
+    for (uint64_t n = cycles_ + EVENT_WHEEL_SIZE; next < n; ++next) {
+      if (event_wheel_[next & (EVENT_WHEEL_SIZE - 1)].head)
+        break;
+    }
+    if (next == cycles_ + EVENT_WHEEL_SIZE) {
+      next = far_events_.begin()->first;
+    }
+    skipped_cycles_ += (next - cycles_);
+    cycles_ = next;
+    this->migrate_far_events();
+  }
+
+  bool all_asleep() const {
+    for (auto& object : objects_) {
+      if (!object->asleep_)
+        return false;
+    }
+    return true;
+  }
+
+  // Staging keeps worker threads away from the event queue and the event
+  // pools: events are stored by value in per-thread buffers and handed to
+  // the main thread, which inserts them in partition order after the
+  // barrier. Since partitions are contiguous in creation order, this yields
+  // the exact insertion order of a serial run.
+
+  typedef std::vector<std::pair<void (*)(void*), void*>> stage_buffers_t;
+
+  static std::vector<staged_event_t>*& staged_events() {
+    static thread_local std::vector<staged_event_t>* s_staged = nullptr;
+    return s_staged;
+  }
+
+  static stage_buffers_t& stage_buffers() {
+    static thread_local stage_buffers_t s_buffers;
+    return s_buffers;
+  }
+
+  template <typename Event>
+  static SimEventBase* unstage_event(void* buffer, uint32_t index) {
+    return new Event((*static_cast<std::vector<Event>*>(buffer))[index]);
+  }
+
+  template <typename Event, typename... Args>
+  static void stage_event(std::vector<staged_event_t>* staged, Args&&... args) {
+    static thread_local std::vector<Event>* s_buffer = nullptr;
+    if (s_buffer == nullptr) {
+      static thread_local std::vector<Event> s_storage;
+      s_buffer = &s_storage;
+      stage_buffers().emplace_back([](void* buffer) {
+        static_cast<std::vector<Event>*>(buffer)->clear();
+      }, s_buffer);
+    }
+    staged->push_back({&unstage_event<Event>, s_buffer, (uint32_t)s_buffer->size()});
+    s_buffer->emplace_back(std::forward<Args>(args)...);
+  }
+
+  void build_stages() {
+    stages_.clear();
+    partitions_.clear();
+    partitions_.resize(num_partitions_);
+    int last_partition = -1;
+    for (auto& object : objects_) {
+      int partition = (num_threads_ > 1) ? object->partition_ : -1;
+      if (partition == -1) {
+        if (stages_.empty() || !stages_.back().partitions.empty()) {
+          stages_.push_back({});
+        }
+        stages_.back().objects.push_back(object.get());
+      } else {
+        if (stages_.empty() || stages_.back().partitions.empty()) {
+          stages_.push_back({{}, {}, PROBE_SERIAL, PROBE_CYCLES, 0, 0});
+        }
+        if (partition != last_partition) {
+          stages_.back().partitions.push_back(partition);
+        }
+        partitions_.at(partition).objects.push_back(object.get());
+      }
+      last_partition = partition;
+    }
+    stages_dirty_ = false;
+  }
+
+  // Parallel ticking pays off only when the partitions have enough work per
+  // cycle to cover the barrier. Short probe windows time the stage ticked
+  // serially and in parallel, the faster mode is then kept for a long run
+  // window before probing again. Both modes insert the events in the same
+  // order, so switching never changes the simulation results.
+  // returns the number of objects left awake
+  uint32_t tick_partition_stage(tick_stage_t& stage) {
+    if (!adaptive_threads_)
+      return this->tick_parallel(stage);
+
+    if (stage.window == 0) {
+      switch (stage.mode) {
+      case PROBE_SERIAL:
+        stage.mode = PROBE_PARALLEL;
+        stage.window = PROBE_CYCLES;
+        break;
+      case PROBE_PARALLEL:
+        stage.mode = (stage.parallel_ns < stage.serial_ns) ? RUN_PARALLEL : RUN_SERIAL;
+        stage.window = RUN_CYCLES;
+        break;
+      default:
+        stage.mode = PROBE_SERIAL;
+        stage.window = PROBE_CYCLES;
+        break;
+      }
+      if (stage.mode == PROBE_SERIAL) {
+        stage.serial_ns = 0;
+      } else if (stage.mode == PROBE_PARALLEL) {
+        stage.parallel_ns = 0;
+      }
+    }
+    --stage.window;
+
+    switch (stage.mode) {
+    case RUN_SERIAL:
+      return this->tick_serial(stage);
+    case RUN_PARALLEL:
+      return this->tick_parallel(stage);
+    default:
+      break;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto awake = (stage.mode == PROBE_SERIAL) ? this->tick_serial(stage) : this->tick_parallel(stage);
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    if (stage.mode == PROBE_SERIAL) {
+      stage.serial_ns += elapsed;
+    } else {
+      stage.parallel_ns += elapsed;
+    }
+    return awake;
+  }
+
+  // tick the partitions on the main thread, in creation order
+  uint32_t tick_serial(const tick_stage_t& stage) {
+    uint32_t awake = 0;
+    for (auto p : stage.partitions) {
+      for (auto object : partitions_[p].objects) {
+        if (object->asleep_)
+          continue;
+        object->do_tick();
+        awake += !object->asleep_;
+      }
+    }
+    return awake;
+  }
+
+  void tick_partitions(const tick_stage_t& stage, uint32_t tid) {
+    // recycle this thread's staging buffers, they were drained after the last barrier
+    for (auto& buffer : stage_buffers()) {
+      buffer.first(buffer.second);
+    }
+    auto& staged = staged_events();
+    for (uint32_t i = tid, n = stage.partitions.size(); i < n; i += num_threads_) {
+      auto& partition = partitions_[stage.partitions[i]];
+      staged = &partition.events;
+      uint32_t awake = 0;
+      for (auto object : partition.objects) {
+        if (object->asleep_)
+          continue;
+        object->do_tick();
+        awake += !object->asleep_;
+      }
+      partition.awake = awake;
+    }
+    staged = nullptr;
+  }
+
+  // returns the number of objects left awake
+  uint32_t tick_parallel(const tick_stage_t& stage) {
+    if (workers_.empty()) {
+      this->start_workers();
+    }
+    // release the workers
+    work_stage_ = &stage;
+    work_pending_.store(workers_.size(), std::memory_order_relaxed);
+    work_phase_.fetch_add(1, std::memory_order_seq_cst);
+    if (work_sleepers_.load(std::memory_order_seq_cst) != 0) {
+      std::lock_guard<std::mutex> lock(work_mutex_);
+      work_cv_.notify_all();
+    }
+    try {
+      this->tick_partitions(stage, 0);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(work_mutex_);
+      work_error_ = std::current_exception();
+    }
+    // wait for the workers
+    while (work_pending_.load(std::memory_order_acquire) != 0) {
+      std::this_thread::yield();
+    }
+    if (work_error_) {
+      auto error = work_error_;
+      work_error_ = nullptr;
+      std::rethrow_exception(error);
+    }
+    // insert staged events in serial order
+    uint32_t awake = 0;
+    for (auto p : stage.partitions) {
+      auto& events = partitions_[p].events;
+      for (auto& staged : events) {
+        this->insert_event(staged.create(staged.buffer, staged.index));
+      }
+      events.clear();
+      awake += partitions_[p].awake;
+    }
+    return awake;
+  }
+
+  void start_workers() {
+    workers_exit_ = false;
+    auto phase = work_phase_.load(std::memory_order_relaxed);
+    for (uint32_t tid = 1; tid < num_threads_; ++tid) {
+      workers_.emplace_back(&SimPlatform::worker_main, this, tid, phase);
+    }
+  }
+
+  void stop_workers() {
+    if (workers_.empty())
+      return;
+    {
+      std::lock_guard<std::mutex> lock(work_mutex_);
+      workers_exit_ = true;
+      work_phase_.fetch_add(1, std::memory_order_seq_cst);
+      work_cv_.notify_all();
+    }
+    for (auto& worker : workers_) {
+      worker.join();
+    }
+    workers_.clear();
+  }
+
+  void worker_main(uint32_t tid, uint64_t phase) {
+    Scope scope(this);
+    for (;;) {
+      // spin for the next cycle, then go to sleep if the simulation is idle
+      uint64_t next_phase;
+      uint32_t spins = 0;
+      while ((next_phase = work_phase_.load(std::memory_order_acquire)) == phase) {
+        if (++spins < WORKER_SPIN_LIMIT) {
+          std::this_thread::yield();
+          continue;
+        }
+        std::unique_lock<std::mutex> lock(work_mutex_);
+        work_sleepers_.fetch_add(1, std::memory_order_seq_cst);
+        work_cv_.wait(lock, [&]() {
+          return work_phase_.load(std::memory_order_seq_cst) != phase;
+        });
+        work_sleepers_.fetch_sub(1, std::memory_order_relaxed);
+      }
+      phase = next_phase;
+      if (workers_exit_)
+        break;
+      try {
+        this->tick_partitions(*work_stage_, tid);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(work_mutex_);
+        work_error_ = std::current_exception();
+      }
+      work_pending_.fetch_sub(1, std::memory_order_release);
+    }
   }
 
+  static constexpr uint32_t WORKER_SPIN_LIMIT = 1 << 12;
+
   std::list<SimObjectBase::Ptr> objects_;
-  std::list<SimEventBase::Ptr> events_;
+  std::vector<event_slot_t> event_wheel_;
+  std::multimap<uint64_t, SimEventBase*> far_events_;
   uint64_t cycles_;
+  uint64_t pending_events_;
+  uint64_t total_events_;
+  uint64_t peak_events_;
+  uint64_t skipped_cycles_;
+  MemoryPoolStats pool_stats_;
+  std::vector<std::unique_ptr<event_pool_base_t>> event_pools_;
+  bool     idle_;
+  bool     clock_skip_;
+
+  std::vector<tick_stage_t> stages_;
+  std::vector<partition_t> partitions_;
+  bool     stages_dirty_;
+  int      cur_partition_;
+  uint32_t num_partitions_;
+  uint32_t num_threads_;
+
+  std::vector<std::thread> workers_;
+  const tick_stage_t*      work_stage_;
+  std::atomic<uint64_t>    work_phase_;
+  std::atomic<uint32_t>    work_pending_;
+  std::atomic<uint32_t>    work_sleepers_;
+  std::mutex               work_mutex_;
+  std::condition_variable  work_cv_;
+  std::exception_ptr       work_error_;
+  bool                     workers_exit_;
+  bool                     adaptive_threads_;
 
   template <typename U> friend class SimPort;
+  template <typename U> friend class SimCallEvent;
+  template <typename U> friend class SimPortEvent;
   friend class SimObjectBase;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
 
+template <typename Pkt>
+void* SimCallEvent<Pkt>::operator new(size_t /*size*/) {
+  return SimPlatform::instance().event_pool<SimCallEvent<Pkt>>().allocate();
+}
+
+template <typename Pkt>
+void SimCallEvent<Pkt>::operator delete(void* ptr) {
+  SimPlatform::instance().event_pool<SimCallEvent<Pkt>>().deallocate(ptr);
+}
+
+template <typename Pkt>
+void* SimPortEvent<Pkt>::operator new(size_t /*size*/) {
+  return SimPlatform::instance().event_pool<SimPortEvent<Pkt>>().allocate();
+}
+
+template <typename Pkt>
+void SimPortEvent<Pkt>::operator delete(void* ptr) {
+  SimPlatform::instance().event_pool<SimPortEvent<Pkt>>().deallocate(ptr);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 inline SimObjectBase::SimObjectBase(const SimContext&, const std::string& name)
   : name_(name)
+  , partition_(-1)
+  , asleep_(false)
 {}
 
 template <typename Impl>
@@ -408,3 +1009,18 @@ void SimPort<Pkt>::push(const Pkt& pkt, uint64_t delay) const {
     SimPlatform::instance().schedule(this, pkt, delay);
   }
 }
+
+template <typename Pkt>
+void SimPort<Pkt>::transfer(const Pkt& data, uint64_t cycles) {
+  if (tx_cb_) {
+    tx_cb_(data, cycles);
+  }
+  if (sink_) {
+    sink_->transfer(data, cycles);
+  } else {
+    queue_.push({data, cycles});
+    if (consumer_) {
+      consumer_->wake();
+    }
+  }
+}
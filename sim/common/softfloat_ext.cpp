@@ -33,6 +33,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 =============================================================================*/
 
+// softfloat keeps its rounding mode and flags per thread (third_party/Makefile)
+#define THREAD_LOCAL thread_local
+
 #include "softfloat_ext.h"
 #include <../RISCV/specialize.h>
 #include <assert.h>
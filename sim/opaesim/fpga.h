@@ -39,8 +39,22 @@ typedef enum {
 	FPGA_ACCELERATOR
 } fpga_objtype;
 
+enum fpga_buffer_flags {
+	FPGA_BUF_PREALLOCATED = (1u << 0), /**< Use existing buffer */
+	FPGA_BUF_QUIET = (1u << 1),        /**< Suppress error messages */
+	FPGA_BUF_READ_ONLY = (1u << 2)     /**< Buffer is read-only */
+};
+
+typedef enum {
+	FPGA_EVENT_INTERRUPT = 0,
+	FPGA_EVENT_ERROR,
+	FPGA_EVENT_POWER_THERMAL
+} fpga_event_type;
+
 typedef void *fpga_handle;
 
+typedef void *fpga_event_handle;
+
 typedef void *fpga_token;
 
 typedef void *fpga_properties;
@@ -12,6 +12,7 @@
 // limitations under the License.
 
 #include "opae_sim.h"
+#include "fpga.h"
 
 #include "Vvortex_afu_shim.h"
 
@@ -109,7 +110,9 @@ public:
       future_.wait();
     }
     for (auto& buffer : host_buffers_) {
-      aligned_free(buffer.second.data);
+      if (buffer.second.owned) {
+        aligned_free(buffer.second.data);
+      }
     }
     if (ram_) {
       delete ram_;
@@ -171,17 +174,26 @@ public:
   }
 
   int prepare_buffer(uint64_t len, void **buf_addr, uint64_t *wsid, int flags) {
-    auto alloc = aligned_malloc(len, CACHE_BLOCK_SIZE);
-    if (alloc == NULL)
-      return -1;
-    // set uninitialized data to "baadf00d"
-    for (uint32_t i = 0; i < len; ++i) {
-      ((uint8_t*)alloc)[i] = (0xbaadf00d >> ((i & 0x3) * 8)) & 0xff;
+    void* alloc;
+    if (flags & FPGA_BUF_PREALLOCATED) {
+      // pin the caller's memory, the DMA engine accesses it in place
+      alloc = *buf_addr;
+      if (alloc == NULL || 0 != (uintptr_t(alloc) % CACHE_BLOCK_SIZE))
+        return -1;
+    } else {
+      alloc = aligned_malloc(len, CACHE_BLOCK_SIZE);
+      if (alloc == NULL)
+        return -1;
+      // set uninitialized data to "baadf00d"
+      for (uint32_t i = 0; i < len; ++i) {
+        ((uint8_t*)alloc)[i] = (0xbaadf00d >> ((i & 0x3) * 8)) & 0xff;
+      }
     }
     host_buffer_t buffer;
     buffer.data   = (uint64_t*)alloc;
     buffer.size   = len;
     buffer.ioaddr = uintptr_t(alloc);
+    buffer.owned  = !(flags & FPGA_BUF_PREALLOCATED);
     auto buffer_id = host_buffer_ids_++;
     host_buffers_.emplace(buffer_id, buffer);
     *buf_addr = alloc;
@@ -192,7 +204,9 @@ public:
   void release_buffer(uint64_t wsid) {
     auto it = host_buffers_.find(wsid);
     if (it != host_buffers_.end()) {
-      aligned_free(it->second.data);
+      if (it->second.owned) {
+        aligned_free(it->second.data);
+      }
       host_buffers_.erase(it);
     }
   }
@@ -505,6 +519,7 @@ private:
     uint64_t* data;
     size_t    size;
     uint64_t  ioaddr;
+    bool      owned;
   } host_buffer_t;
 
   Vvortex_afu_shim *device_;
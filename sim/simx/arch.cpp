@@ -0,0 +1,256 @@
+// Copyright © 2019-2023
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "arch.h"
+#include <iostream>
+#include <fstream>
+#include <bitmanip.h>
+
+using namespace vortex;
+
+static bool parse_number(const std::string& str, uint64_t* value) {
+  char* end = nullptr;
+  uint64_t num = strtoull(str.c_str(), &end, 0);
+  if (end == str.c_str())
+    return false;
+  switch (*end) {
+  case 'k': case 'K': num <<= 10; ++end; break;
+  case 'm': case 'M': num <<= 20; ++end; break;
+  default: break;
+  }
+  if (*end != '\0')
+    return false;
+  *value = num;
+  return true;
+}
+
+static std::string trim(const std::string& str) {
+  auto first = str.find_first_not_of(" \t\r");
+  if (first == std::string::npos)
+    return "";
+  auto last = str.find_last_not_of(" \t\r");
+  return str.substr(first, last - first + 1);
+}
+
+int Arch::set_cache_params(const std::string& spec) {
+  struct cache_entry_t {
+    const char*  name;
+    CacheParams* params;
+    uint32_t     line_size;
+    uint32_t     mem_ports;
+  };
+  cache_entry_t caches[] = {
+    {"icache",  &icache_,  L1_LINE_SIZE,   ICACHE_MEM_PORTS},
+    {"dcache",  &dcache_,  L1_LINE_SIZE,   L1_MEM_PORTS},
+    {"l2cache", &l2cache_, MEM_BLOCK_SIZE, L2_MEM_PORTS},
+    {"l3cache", &l3cache_, MEM_BLOCK_SIZE, L3_MEM_PORTS},
+  };
+  CacheReplPolicy repl_policies[] = {
+    CacheReplPolicy::LRU,
+    CacheReplPolicy::PLRU,
+    CacheReplPolicy::SRRIP,
+    CacheReplPolicy::BRRIP,
+    CacheReplPolicy::FIFO,
+    CacheReplPolicy::Random,
+  };
+  CachePrefetcher prefetchers[] = {
+    CachePrefetcher::None,
+    CachePrefetcher::NextLine,
+    CachePrefetcher::Stride,
+    CachePrefetcher::Stream,
+  };
+
+  // a spec that names a file is read from it, one entry per line
+  std::string text(spec);
+  std::ifstream ifs(spec);
+  if (ifs) {
+    std::stringstream ss;
+    ss << ifs.rdbuf();
+    text = ss.str();
+  }
+
+  std::stringstream ss(text);
+  std::string line;
+  while (std::getline(ss, line)) {
+    auto comment = line.find('#');
+    if (comment != std::string::npos) {
+      line.erase(comment);
+    }
+    std::stringstream ls(line);
+    std::string entry;
+    while (std::getline(ls, entry, ',')) {
+      entry = trim(entry);
+      if (entry.empty())
+        continue;
+
+      auto dot = entry.find('.');
+      auto eq = entry.find('=');
+      if (dot == std::string::npos
+       || eq == std::string::npos
+       || eq < dot) {
+        std::cout << "Error: invalid cache parameter '" << entry << "'" << std::endl;
+        return -1;
+      }
+      auto cache_name = trim(entry.substr(0, dot));
+      auto param_name = trim(entry.substr(dot + 1, eq - dot - 1));
+      auto value_str  = trim(entry.substr(eq + 1));
+
+      CacheParams* params = nullptr;
+      for (auto& cache : caches) {
+        if (cache_name == cache.name) {
+          params = cache.params;
+          break;
+        }
+      }
+      if (params == nullptr) {
+        std::cout << "Error: unknown cache '" << cache_name << "'" << std::endl;
+        return -1;
+      }
+
+      if (param_name == "policy") {
+        bool found = false;
+        for (auto policy : repl_policies) {
+          std::stringstream ss;
+          ss << policy;
+          if (value_str == ss.str()) {
+            params->repl_policy = policy;
+            found = true;
+            break;
+          }
+        }
+        if (!found) {
+          std::cout << "Error: unknown replacement policy '" << value_str << "'" << std::endl;
+          return -1;
+        }
+        continue;
+      }
+
+      if (param_name == "prefetch") {
+        bool found = false;
+        for (auto prefetcher : prefetchers) {
+          std::stringstream ss;
+          ss << prefetcher;
+          if (value_str == ss.str()) {
+            params->prefetcher = prefetcher;
+            found = true;
+            break;
+          }
+        }
+        if (!found) {
+          std::cout << "Error: unknown prefetcher '" << value_str << "'" << std::endl;
+          return -1;
+        }
+        continue;
+      }
+
+      uint64_t value;
+      if (!parse_number(value_str, &value)) {
+        std::cout << "Error: invalid cache parameter '" << entry << "'" << std::endl;
+        return -1;
+      }
+      if (param_name == "enabled") {
+        params->enabled = (value != 0);
+      } else if (param_name == "size" && value <= 0xffffffff) {
+        params->size = value;
+      } else if (param_name == "ways" && value <= 0xffff) {
+        params->num_ways = value;
+      } else if (param_name == "banks" && value <= 0xffff) {
+        params->num_banks = value;
+      } else if (param_name == "mshr" && value <= 0xffff) {
+        params->mshr_size = value;
+      } else if (param_name == "latency" && value <= 0xff) {
+        params->latency = value;
+      } else if (param_name == "writeback") {
+        params->write_back = (value != 0);
+      } else if (param_name == "prefetch_degree" && value <= 0xff) {
+        params->prefetch_degree = value;
+      } else {
+        std::cout << "Error: invalid cache parameter '" << entry << "'" << std::endl;
+        return -1;
+      }
+    }
+  }
+
+  // the resulting geometry must still map onto the cache model
+  for (auto& cache : caches) {
+    auto& params = *cache.params;
+    if (!params.enabled)
+      continue;
+    if (!ispow2(params.size) || !ispow2(params.num_ways) || !ispow2(params.num_banks)) {
+      std::cout << "Error: " << cache.name << " size, ways and banks should be powers of two" << std::endl;
+      return -1;
+    }
+    if (params.num_ways > 64) {
+      std::cout << "Error: " << cache.name << " ways should be at most 64" << std::endl;
+      return -1;
+    }
+    if (params.size < uint64_t(cache.line_size) * params.num_ways * params.num_banks) {
+      std::cout << "Error: " << cache.name << " size is smaller than one set per bank" << std::endl;
+      return -1;
+    }
+    if (params.num_banks < cache.mem_ports || params.num_banks > 64) {
+      std::cout << "Error: " << cache.name << " banks should be between " << cache.mem_ports << " and 64" << std::endl;
+      return -1;
+    }
+    if (params.mshr_size == 0 || params.latency == 0) {
+      std::cout << "Error: " << cache.name << " mshr and latency should be non-zero" << std::endl;
+      return -1;
+    }
+    if (params.prefetch_degree == 0 || params.prefetch_degree > 8) {
+      std::cout << "Error: " << cache.name << " prefetch degree should be between 1 and 8" << std::endl;
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+int Arch::set_warp_scheduler(const std::string& spec) {
+  WarpSchedPolicy policies[] = {
+    WarpSchedPolicy::Priority,
+    WarpSchedPolicy::LRR,
+    WarpSchedPolicy::GTO,
+    WarpSchedPolicy::TwoLevel,
+  };
+
+  auto sep = spec.find(':');
+  auto name = trim(spec.substr(0, sep));
+
+  bool found = false;
+  for (auto policy : policies) {
+    std::stringstream ss;
+    ss << policy;
+    if (name == ss.str()) {
+      warp_sched_ = policy;
+      found = true;
+      break;
+    }
+  }
+  if (!found) {
+    std::cout << "Error: unknown warp scheduler '" << name << "'" << std::endl;
+    return -1;
+  }
+
+  if (sep != std::string::npos) {
+    uint64_t value;
+    if (warp_sched_ != WarpSchedPolicy::TwoLevel
+     || !parse_number(trim(spec.substr(sep + 1)), &value)
+     || value == 0 || value > MAX_NUM_WARPS) {
+      std::cout << "Error: invalid warp scheduler '" << spec << "'" << std::endl;
+      return -1;
+    }
+    warp_pool_size_ = value;
+  }
+
+  return 0;
+}
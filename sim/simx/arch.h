@@ -19,9 +19,25 @@
 #include <cstdlib>
 #include <stdio.h>
 #include "types.h"
+#include "constants.h"
 
 namespace vortex {
 
+// cache geometry that can be changed at startup without a rebuild,
+// the remaining parameters (line size, ports) follow the hardware config.
+struct CacheParams {
+  bool     enabled;
+  uint32_t size;        // capacity in bytes
+  uint16_t num_ways;    // associativity
+  uint16_t num_banks;   // number of banks
+  uint16_t mshr_size;   // MSHR entries per bank
+  uint8_t  latency;     // pipeline latency
+  bool     write_back;  // write-back policy
+  CacheReplPolicy repl_policy; // replacement policy
+  CachePrefetcher prefetcher;  // hardware prefetcher
+  uint8_t  prefetch_degree;     // lines requested per prefetch trigger
+};
+
 class Arch {
 private:
   uint16_t num_threads_;
@@ -31,6 +47,12 @@ private:
   uint16_t socket_size_;
   uint16_t num_barriers_;
   uint64_t local_mem_base_;
+  CacheParams icache_;
+  CacheParams dcache_;
+  CacheParams l2cache_;
+  CacheParams l3cache_;
+  WarpSchedPolicy warp_sched_;
+  uint16_t warp_pool_size_;
 
 public:
   Arch(uint16_t num_threads, uint16_t num_warps, uint16_t num_cores)   
@@ -41,8 +63,25 @@ public:
     , socket_size_(SOCKET_SIZE)
     , num_barriers_(NUM_BARRIERS)
     , local_mem_base_(LMEM_BASE_ADDR)
+    // the icache model is split in two banks (B=1)
+    , icache_({ICACHE_ENABLED, ICACHE_SIZE, ICACHE_NUM_WAYS, 2, num_warps, 2, false, CacheReplPolicy::LRU, CachePrefetcher::None, 2})
+    , dcache_({DCACHE_ENABLED, DCACHE_SIZE, DCACHE_NUM_WAYS, DCACHE_NUM_BANKS, DCACHE_MSHR_SIZE, 2, DCACHE_WRITEBACK, CacheReplPolicy::LRU, CachePrefetcher::None, 2})
+    , l2cache_({L2_ENABLED, L2_CACHE_SIZE, L2_NUM_WAYS, L2_NUM_BANKS, L2_MSHR_SIZE, 2, L2_WRITEBACK, CacheReplPolicy::LRU, CachePrefetcher::None, 2})
+    , l3cache_({L3_ENABLED, L3_CACHE_SIZE, L3_NUM_WAYS, L3_NUM_BANKS, L3_MSHR_SIZE, 2, L3_WRITEBACK, CacheReplPolicy::LRU, CachePrefetcher::None, 2})
+    , warp_sched_(WarpSchedPolicy::Priority)
+    , warp_pool_size_(4)
   {}
 
+  // override cache parameters from a list of <cache>.<param>=<value>
+  // entries separated by commas or newlines, or from a file holding them.
+  // returns 0 on success.
+  int set_cache_params(const std::string& spec);
+
+  // select the warp scheduler from <policy>[:<pool size>],
+  // the pool size only applies to the two-level scheduler.
+  // returns 0 on success.
+  int set_warp_scheduler(const std::string& spec);
+
   uint16_t num_barriers() const {
     return num_barriers_;
   }
@@ -71,6 +110,30 @@ public:
     return socket_size_;
   }
 
+  const CacheParams& icache() const {
+    return icache_;
+  }
+
+  const CacheParams& dcache() const {
+    return dcache_;
+  }
+
+  const CacheParams& l2cache() const {
+    return l2cache_;
+  }
+
+  const CacheParams& l3cache() const {
+    return l3cache_;
+  }
+
+  WarpSchedPolicy warp_sched() const {
+    return warp_sched_;
+  }
+
+  uint16_t warp_pool_size() const {
+    return warp_pool_size_;
+  }
+
 };
 
 }
\ No newline at end of file
@@ -34,7 +34,8 @@ public:
 		, CoreRspPorts(num_inputs, std::vector<SimPort<MemRsp>>(cache_config.num_inputs, this))
 		, MemReqPorts(cache_config.mem_ports, this)
 		, MemRspPorts(cache_config.mem_ports, this)
-		, caches_(MAX(num_units, 0x1)) {
+		, caches_(MAX(num_units, 0x1))
+		, lg2_input_ratio_(log2ceil(num_inputs / MAX(num_units, 0x1))) {
 
 		CacheSim::Config cache_config2(cache_config);
 		if (0 == num_units) {
@@ -85,7 +86,9 @@ public:
 
 	void reset() {}
 
-	void tick() {}
+	void tick() {
+		this->sleep();
+	}
 
 	CacheSim::PerfStats perf_stats() const {
 		CacheSim::PerfStats perf;
@@ -95,8 +98,27 @@ public:
 		return perf;
 	}
 
+	void save(CheckpointWriter& ckpt) const {
+		for (auto& cache : caches_) {
+			cache->save(ckpt);
+		}
+	}
+
+	void restore(CheckpointReader& ckpt) {
+		for (auto& cache : caches_) {
+			cache->restore(ckpt);
+		}
+	}
+
+	// warm the cache unit the input arbiter routes this input to
+	bool warm(uint32_t input, uint64_t addr, bool& write) {
+		uint32_t unit = std::min<uint32_t>(input >> lg2_input_ratio_, caches_.size() - 1);
+		return caches_.at(unit)->warm(addr, write);
+	}
+
 private:
   std::vector<CacheSim::Ptr> caches_;
+  uint32_t lg2_input_ratio_;
 };
 
 }
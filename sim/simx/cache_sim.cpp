@@ -15,10 +15,12 @@
 #include "debug.h"
 #include "types.h"
 #include <util.h>
+#include <checkpoint.h>
 #include <unordered_map>
 #include <vector>
 #include <list>
 #include <queue>
+#include <deque>
 
 using namespace vortex;
 
@@ -106,13 +108,14 @@ struct params_t {
 
 struct line_t {
 	uint64_t tag;
-	uint32_t lru_ctr;
 	bool     valid;
 	bool     dirty;
+	bool     prefetched; // filled by a prefetch, not used yet
 
 	void clear() {
 		valid = false;
 		dirty = false;
+		prefetched = false;
 	}
 };
 
@@ -130,6 +133,402 @@ struct set_t {
 	}
 };
 
+// Replacement state of a bank, packed into 64-bit words per set.
+// LRU keeps a log2(ways)-bit recency rank per line (0 is the most recent),
+// lines filled over a victim stay at the LRU position until their first
+// hit. PLRU keeps a tree of ways-1 bits, SRRIP/BRRIP a 2-bit re-reference
+// prediction value per line and FIFO the next way to evict.
+class ReplState {
+private:
+	static constexpr uint32_t RRPV_MAX = 3;
+	static constexpr uint32_t BRRIP_EPSILON = 32;
+
+	CacheReplPolicy policy_;
+	uint32_t num_ways_;
+	uint32_t log2_ways_;
+	uint32_t rank_bits_;
+	uint32_t words_per_set_;
+	std::vector<uint64_t> words_;
+	uint64_t rng_;
+	uint32_t fills_;
+
+	static uint32_t set_words(CacheReplPolicy policy, uint32_t num_ways) {
+		switch (policy) {
+		case CacheReplPolicy::LRU: {
+			// whole ranks per word, 7 words per set at 64 ways
+			uint32_t per_word = 64 / std::max<uint32_t>(1, log2ceil(num_ways));
+			return (num_ways + per_word - 1) / per_word;
+		}
+		case CacheReplPolicy::PLRU:
+		case CacheReplPolicy::FIFO:  return 1;
+		case CacheReplPolicy::SRRIP:
+		case CacheReplPolicy::BRRIP: return (2 * num_ways + 63) / 64;
+		default:                     return 0;
+		}
+	}
+
+	// per-way fields of the given width, never straddling two words
+	static uint32_t field(const uint64_t* set, uint32_t way, uint32_t bits) {
+		uint32_t per_word = 64 / bits;
+		return (set[way / per_word] >> (bits * (way % per_word))) & ((uint64_t(1) << bits) - 1);
+	}
+
+	static void set_field(uint64_t* set, uint32_t way, uint32_t bits, uint64_t value) {
+		uint32_t per_word = 64 / bits;
+		auto shift = bits * (way % per_word);
+		auto mask = ((uint64_t(1) << bits) - 1) << shift;
+		set[way / per_word] = (set[way / per_word] & ~mask) | (value << shift);
+	}
+
+	uint32_t rrpv(uint64_t* set, uint32_t way) const {
+		return field(set, way, 2);
+	}
+
+	void set_rrpv(uint64_t* set, uint32_t way, uint64_t value) {
+		set_field(set, way, 2, value);
+	}
+
+	void lru_touch(uint64_t* set, uint32_t way) {
+		// age the lines more recent than the accessed way
+		auto rank = field(set, way, rank_bits_);
+		for (uint32_t i = 0; i < num_ways_; ++i) {
+			auto value = field(set, i, rank_bits_);
+			if (value < rank) {
+				set_field(set, i, rank_bits_, value + 1);
+			}
+		}
+		set_field(set, way, rank_bits_, 0);
+	}
+
+	void plru_touch(uint64_t* set, uint32_t way) {
+		// point every node on the path away from the accessed way
+		uint32_t node = 1;
+		for (int32_t i = log2_ways_ - 1; i >= 0; --i) {
+			uint64_t dir = (way >> i) & 1;
+			*set = (*set & ~(uint64_t(1) << node)) | ((dir ^ 1) << node);
+			node = 2 * node + dir;
+		}
+	}
+
+public:
+	ReplState(CacheReplPolicy policy, uint32_t num_sets, uint32_t num_ways)
+		: policy_(policy)
+		, num_ways_(num_ways)
+		, log2_ways_(log2ceil(num_ways))
+		, rank_bits_(std::max<uint32_t>(1, log2_ways_))
+		, words_per_set_(set_words(policy, num_ways))
+		, words_(num_sets * words_per_set_)
+	{
+		assert(num_ways <= 64);
+		this->clear();
+	}
+
+	void clear() {
+		std::fill(words_.begin(), words_.end(), 0);
+		if (policy_ == CacheReplPolicy::LRU) {
+			// distinct ranks, the highest way is filled first and evicted first
+			for (uint32_t s = 0, n = words_.size() / words_per_set_; s < n; ++s) {
+				for (uint32_t i = 0; i < num_ways_; ++i) {
+					set_field(&words_[s * words_per_set_], i, rank_bits_, i);
+				}
+			}
+		}
+		rng_ = 0x9e3779b97f4a7c15ull;
+		fills_ = 0;
+	}
+
+	// a request hit the given way
+	void hit(uint32_t set_id, uint32_t way) {
+		auto state = &words_[set_id * words_per_set_];
+		switch (policy_) {
+		case CacheReplPolicy::LRU:
+			this->lru_touch(state, way);
+			break;
+		case CacheReplPolicy::PLRU:
+			this->plru_touch(state, way);
+			break;
+		case CacheReplPolicy::SRRIP:
+		case CacheReplPolicy::BRRIP:
+			this->set_rrpv(state, way, 0);
+			break;
+		default:
+			break;
+		}
+	}
+
+	// select the way to replace in a full set
+	uint32_t victim(uint32_t set_id) {
+		auto state = &words_[set_id * words_per_set_];
+		switch (policy_) {
+		case CacheReplPolicy::LRU: {
+			for (uint32_t i = 0; i < num_ways_; ++i) {
+				if (field(state, i, rank_bits_) == num_ways_ - 1)
+					return i;
+			}
+			return 0;
+		}
+		case CacheReplPolicy::PLRU: {
+			uint32_t node = 1;
+			while (node < num_ways_) {
+				node = 2 * node + ((*state >> node) & 1);
+			}
+			return node - num_ways_;
+		}
+		case CacheReplPolicy::SRRIP:
+		case CacheReplPolicy::BRRIP: {
+			// age the whole set until a line reaches the distant value
+			uint32_t way = 0;
+			uint32_t max_rrpv = 0;
+			for (uint32_t i = 0; i < num_ways_; ++i) {
+				auto value = this->rrpv(state, i);
+				if (value > max_rrpv) {
+					max_rrpv = value;
+					way = i;
+				}
+			}
+			if (max_rrpv != RRPV_MAX) {
+				for (uint32_t i = 0; i < num_ways_; ++i) {
+					this->set_rrpv(state, i, this->rrpv(state, i) + (RRPV_MAX - max_rrpv));
+				}
+			}
+			return way;
+		}
+		case CacheReplPolicy::FIFO:
+			return *state;
+		default:
+			// xorshift64
+			rng_ ^= rng_ << 13;
+			rng_ ^= rng_ >> 7;
+			rng_ ^= rng_ << 17;
+			return rng_ & (num_ways_ - 1);
+		}
+	}
+
+	// a new line was allocated to the given way, over a victim if replaced
+	void fill(uint32_t set_id, uint32_t way, bool replaced) {
+		auto state = &words_[set_id * words_per_set_];
+		switch (policy_) {
+		case CacheReplPolicy::LRU:
+			if (!replaced) {
+				this->lru_touch(state, way);
+			}
+			break;
+		case CacheReplPolicy::PLRU:
+			this->plru_touch(state, way);
+			break;
+		case CacheReplPolicy::SRRIP:
+			this->set_rrpv(state, way, RRPV_MAX - 1);
+			break;
+		case CacheReplPolicy::BRRIP:
+			// distant insertion, with an occasional long one
+			this->set_rrpv(state, way, (++fills_ % BRRIP_EPSILON) ? RRPV_MAX : (RRPV_MAX - 1));
+			break;
+		case CacheReplPolicy::FIFO:
+			if (way == *state) {
+				*state = (way + 1) & (num_ways_ - 1);
+			}
+			break;
+		default:
+			break;
+		}
+	}
+
+	void save(CheckpointWriter& ckpt) const {
+		ckpt.write<CacheReplPolicy>(policy_);
+		ckpt.write<uint64_t>(words_.size());
+		ckpt.write(words_.data(), words_.size() * sizeof(uint64_t));
+		ckpt.write<uint64_t>(rng_);
+		ckpt.write<uint32_t>(fills_);
+	}
+
+	void restore(CheckpointReader& ckpt) {
+		auto policy = ckpt.read<CacheReplPolicy>();
+		auto size = ckpt.read<uint64_t>();
+		if (policy != policy_ || size != words_.size()) {
+			// another policy, start from a fresh state
+			ckpt.skip(size * sizeof(uint64_t) + sizeof(uint64_t) + sizeof(uint32_t));
+			return;
+		}
+		ckpt.read(words_.data(), size * sizeof(uint64_t));
+		rng_ = ckpt.read<uint64_t>();
+		fills_ = ckpt.read<uint32_t>();
+	}
+};
+
+// Hardware prefetcher, trained on the demand reads of a cache in line
+// addresses. nextline requests the lines following a miss or the first
+// hit on a prefetched line. stride keeps the last line and line stride of
+// each warp/PC pair and runs ahead once a stride repeats. stream follows
+// ascending or descending misses within a window and stays up to
+// 4*degree lines ahead of them. Candidates never leave the page of the
+// triggering access.
+class Prefetcher {
+private:
+	static constexpr uint32_t STRIDE_ENTRIES = 64;
+	static constexpr uint32_t STREAM_ENTRIES = 8;
+	static constexpr int64_t  STREAM_WINDOW  = 16;
+	static constexpr uint32_t MAX_CONFIDENCE = 3;
+	static constexpr uint32_t PAGE_BITS      = 12;
+
+	struct stride_entry_t {
+		uint64_t pc;
+		uint32_t wid;
+		bool     valid;
+		uint64_t last_line;
+		int64_t  stride;
+		uint32_t confidence;
+	};
+
+	struct stream_entry_t {
+		bool     valid;
+		uint64_t last_line;
+		uint64_t next_line;
+		int64_t  dir;
+		uint32_t confidence;
+		uint64_t lru;
+	};
+
+	CachePrefetcher type_;
+	uint32_t degree_;
+	uint32_t page_line_bits_;
+	std::vector<stride_entry_t> strides_;
+	std::vector<stream_entry_t> streams_;
+	uint64_t stream_clock_;
+	std::vector<uint64_t> lines_;
+
+	bool emit(uint64_t line, int64_t offset) {
+		uint64_t target = line + offset;
+		if ((target >> page_line_bits_) != (line >> page_line_bits_))
+			return false;
+		lines_.push_back(target);
+		return true;
+	}
+
+	void train_stride(uint64_t line, uint64_t pc, uint32_t wid) {
+		auto& entry = strides_.at(((pc >> 2) * 31 + wid) % STRIDE_ENTRIES);
+		if (!entry.valid || entry.pc != pc || entry.wid != wid) {
+			entry = {pc, wid, true, line, 0, 0};
+			return;
+		}
+		int64_t delta = line - entry.last_line;
+		if (delta == 0)
+			return;
+		if (delta == entry.stride) {
+			if (entry.confidence < MAX_CONFIDENCE) {
+				++entry.confidence;
+			}
+		} else if (entry.confidence != 0) {
+			--entry.confidence;
+		} else {
+			entry.stride = delta;
+		}
+		entry.last_line = line;
+		if (entry.confidence != 0) {
+			for (uint32_t i = 1; i <= degree_; ++i) {
+				this->emit(line, i * entry.stride);
+			}
+		}
+	}
+
+	void train_stream(uint64_t line, bool miss) {
+		++stream_clock_;
+		for (auto& entry : streams_) {
+			int64_t delta = line - entry.last_line;
+			if (!entry.valid || delta > STREAM_WINDOW || delta < -STREAM_WINDOW)
+				continue;
+			entry.lru = stream_clock_;
+			if (delta == 0)
+				return;
+			int64_t dir = (delta > 0) ? 1 : -1;
+			if (dir == entry.dir) {
+				if (entry.confidence < MAX_CONFIDENCE) {
+					++entry.confidence;
+				}
+			} else {
+				entry.dir = dir;
+				entry.confidence = 0;
+				entry.next_line = line + dir;
+			}
+			entry.last_line = line;
+			if (entry.confidence != 0) {
+				// keep the stream head ahead of the demand accesses
+				int64_t distance = 4 * degree_;
+				if (int64_t(entry.next_line - line) * dir <= 0) {
+					entry.next_line = line + dir;
+				}
+				for (uint32_t i = 0; i < degree_ && int64_t(entry.next_line - line) * dir <= distance; ++i) {
+					if (!this->emit(line, entry.next_line - line))
+						break;
+					entry.next_line += dir;
+				}
+			}
+			return;
+		}
+		if (!miss)
+			return;
+		// allocate a new stream over the least recently used one
+		auto victim = &streams_.front();
+		for (auto& entry : streams_) {
+			if (!entry.valid) {
+				victim = &entry;
+				break;
+			}
+			if (entry.lru < victim->lru) {
+				victim = &entry;
+			}
+		}
+		*victim = {true, line, line + 1, 0, 0, stream_clock_};
+	}
+
+public:
+	Prefetcher(CachePrefetcher type, uint32_t degree, uint32_t log2_line_size)
+		: type_(type)
+		, degree_(degree)
+		, page_line_bits_((log2_line_size < PAGE_BITS) ? (PAGE_BITS - log2_line_size) : 0)
+		, strides_((type == CachePrefetcher::Stride) ? STRIDE_ENTRIES : 0)
+		, streams_((type == CachePrefetcher::Stream) ? STREAM_ENTRIES : 0)
+	{
+		this->clear();
+	}
+
+	CachePrefetcher type() const {
+		return type_;
+	}
+
+	void clear() {
+		for (auto& entry : strides_) {
+			entry.valid = false;
+		}
+		for (auto& entry : streams_) {
+			entry.valid = false;
+		}
+		stream_clock_ = 0;
+	}
+
+	// a demand read of the given line, returns the lines to prefetch
+	const std::vector<uint64_t>& train(uint64_t line, uint64_t pc, uint32_t wid, bool miss, bool prefetch_hit) {
+		lines_.clear();
+		switch (type_) {
+		case CachePrefetcher::NextLine:
+			if (miss || prefetch_hit) {
+				for (uint32_t i = 1; i <= degree_; ++i) {
+					this->emit(line, i);
+				}
+			}
+			break;
+		case CachePrefetcher::Stride:
+			this->train_stride(line, pc, wid);
+			break;
+		case CachePrefetcher::Stream:
+			this->train_stream(line, miss);
+			break;
+		default:
+			break;
+		}
+		return lines_;
+	}
+};
+
 struct bank_req_port_t {
 	uint32_t req_id;
 	uint64_t req_tag;
@@ -146,13 +545,16 @@ struct bank_req_t {
 		None   = 0,
 		Fill   = 1,
 		Replay = 2,
-		Core   = 3
+		Core   = 3,
+		Prefetch = 4
 	};
 
 	std::vector<bank_req_port_t> ports;
 	uint64_t tag;
 	uint32_t set_id;
 	uint32_t cid;
+	uint32_t wid;
+	uint64_t pc;
 	uint64_t uuid;
 	ReqType  type;
 	bool     write;
@@ -191,6 +593,7 @@ inline std::ostream &operator<<(std::ostream &os, const bank_req_t& req) {
 struct mshr_entry_t {
 	bank_req_t bank_req;
 	uint32_t   line_id;
+	bool       promoted; // a demand miss merged into this prefetch
 
 	mshr_entry_t(uint32_t num_ports)
 		: bank_req(num_ports)
@@ -220,6 +623,18 @@ public:
 		return (size_ == entries_.size());
 	}
 
+	uint32_t available() const {
+		return entries_.size() - size_;
+	}
+
+	bool has_replay() const {
+		for (auto& entry : entries_) {
+			if (entry.bank_req.type == bank_req_t::Replay)
+				return true;
+		}
+		return false;
+	}
+
 	bool lookup(const bank_req_t& bank_req) {
 		for (auto& entry : entries_) {;
 			if (entry.bank_req.type != bank_req_t::None
@@ -237,6 +652,7 @@ public:
 			if (entry.bank_req.type == bank_req_t::None) {
 				entry.bank_req = bank_req;
 				entry.line_id = line_id;
+				entry.promoted = false;
 				++size_;
 				return i;
 			}
@@ -246,7 +662,8 @@ public:
 
 	mshr_entry_t& replay(uint32_t id) {
 		auto& root_entry = entries_.at(id);
-		assert(root_entry.bank_req.type == bank_req_t::Core);
+		assert(root_entry.bank_req.type == bank_req_t::Core
+		    || root_entry.bank_req.type == bank_req_t::Prefetch);
 		// mark all related mshr entries for replay
 		for (auto& entry : entries_) {
 			if (entry.bank_req.type == bank_req_t::Core
@@ -258,6 +675,28 @@ public:
 		return root_entry;
 	}
 
+	// a demand miss on a line being prefetched, returns true on the first one
+	bool promote(const bank_req_t& bank_req) {
+		for (auto& entry : entries_) {
+			if (entry.bank_req.type == bank_req_t::Prefetch
+			 && entry.bank_req.set_id == bank_req.set_id
+			 && entry.bank_req.tag == bank_req.tag) {
+				bool first = !entry.promoted;
+				entry.promoted = true;
+				return first;
+			}
+		}
+		return false;
+	}
+
+	// a completed prefetch has nothing to replay
+	void release(uint32_t id) {
+		auto& entry = entries_.at(id);
+		assert(entry.bank_req.type == bank_req_t::Prefetch);
+		entry.bank_req.type = bank_req_t::None;
+		--size_;
+	}
+
 	bool pop(bank_req_t* out) {
 		for (auto& entry : entries_) {
 			if (entry.bank_req.type == bank_req_t::Replay) {
@@ -280,11 +719,13 @@ public:
 
 struct bank_t {
 	std::vector<set_t> sets;
+	ReplState          repl;
 	MSHR               mshr;
 
 	bank_t(const CacheSim::Config& config,
 				 const params_t& params)
 		: sets(params.sets_per_bank, params.lines_per_set)
+		, repl(config.repl_policy, params.sets_per_bank, params.lines_per_set)
 		, mshr(config.mshr_size, config.ports_per_bank)
 	{}
 
@@ -292,6 +733,7 @@ struct bank_t {
 		for (auto& set : sets) {
 			set.clear();
 		}
+		repl.clear();
 		mshr.clear();
 	}
 };
@@ -300,6 +742,15 @@ struct bank_t {
 
 class CacheSim::Impl {
 private:
+	static constexpr uint32_t PREFETCH_QUEUE_SIZE = 4;
+
+	struct prefetch_req_t {
+		uint64_t addr;
+		uint32_t cid;
+		uint32_t wid;
+		uint64_t pc;
+	};
+
 	CacheSim* const simobject_;
 	Config config_;
 	params_t params_;
@@ -309,11 +760,14 @@ private:
 	std::vector<SimPort<MemReq>> mem_req_ports_;
 	std::vector<SimPort<MemRsp>> mem_rsp_ports_;
 	std::vector<bank_req_t> pipeline_reqs_;
+	Prefetcher prefetcher_;
+	std::vector<std::deque<prefetch_req_t>> prefetch_queues_;
 	uint32_t init_cycles_;
 	PerfStats perf_stats_;
 	uint64_t pending_read_reqs_;
 	uint64_t pending_write_reqs_;
 	uint64_t pending_fill_reqs_;
+	uint64_t pending_prefetch_fills_; // fills no demand miss waits on yet
 
 public:
 	Impl(CacheSim* simobject, const Config& config)
@@ -325,6 +779,8 @@ public:
 		, mem_req_ports_((1 << config.B), simobject)
 		, mem_rsp_ports_((1 << config.B), simobject)
 		, pipeline_reqs_((1 << config.B), config.ports_per_bank)
+		, prefetcher_(config.prefetcher, config.prefetch_degree, config.L)
+		, prefetch_queues_((1 << config.B))
 	{
 		char sname[100];
 
@@ -352,6 +808,8 @@ public:
 		for (uint32_t i = 0; i < config_.mem_ports; ++i) {
 			nc_arbs_.at(i)->ReqOut.at(0).bind(&simobject->MemReqPorts.at(i));
 			simobject->MemRspPorts.at(i).bind(&nc_arbs_.at(i)->RspOut.at(0));
+			// bypass responses are polled from the arbiter
+			nc_arbs_.at(i)->RspIn.at(1).set_consumer(simobject);
 		}
 
 		// Create bank's memory arbiter
@@ -379,10 +837,15 @@ public:
 		for (auto& bank : banks_) {
 			bank.clear();
 		}
+		prefetcher_.clear();
+		for (auto& queue : prefetch_queues_) {
+			queue.clear();
+		}
 		perf_stats_ = PerfStats();
 		pending_read_reqs_  = 0;
 		pending_write_reqs_ = 0;
 		pending_fill_reqs_  = 0;
+		pending_prefetch_fills_ = 0;
 	}
 
   void tick() {
@@ -491,6 +954,8 @@ public:
 				bank_req.tag   = tag;
 				bank_req.set_id = set_id;
 				bank_req.cid   = core_req.cid;
+				bank_req.wid   = core_req.wid;
+				bank_req.pc    = core_req.pc;
 				bank_req.uuid  = core_req.uuid;
 				bank_req.type  = bank_req_t::Core;
 				bank_req.write = core_req.write;
@@ -508,16 +973,233 @@ public:
 			perf_stats_.pipeline_stalls += (SimPlatform::instance().cycles() - time);
 		}
 
+		// then: issue queued prefetches on idle banks
+		for (uint32_t bank_id = 0, n = (1 << config_.B); bank_id < n; ++bank_id) {
+			auto& queue = prefetch_queues_.at(bank_id);
+			auto& pipeline_req = pipeline_reqs_.at(bank_id);
+			if (queue.empty() || pipeline_req.type != bank_req_t::None)
+				continue;
+			auto& pf_req = queue.front();
+			pipeline_req.type   = bank_req_t::Prefetch;
+			pipeline_req.tag    = params_.addr_tag(pf_req.addr);
+			pipeline_req.set_id = params_.addr_set_id(pf_req.addr);
+			pipeline_req.write  = false;
+			pipeline_req.cid    = pf_req.cid;
+			pipeline_req.wid    = pf_req.wid;
+			pipeline_req.pc     = pf_req.pc;
+			pipeline_req.uuid   = 0;
+			queue.pop_front();
+		}
+
 		// process active request
 		this->processBankRequests();
 	}
 
+	// no request in flight through the cache: the next tick would be a no-op.
+	// pending fills keep the cache awake, their latency is counted every cycle.
+	bool idle() const {
+		if (config_.bypass)
+			return true;
+		if (init_cycles_ != 0 || pending_fill_reqs_ != 0)
+			return false;
+		for (auto& core_req_port : simobject_->CoreReqPorts) {
+			if (!core_req_port.empty())
+				return false;
+		}
+		for (uint32_t bank_id = 0, n = (1 << config_.B); bank_id < n; ++bank_id) {
+			if (!mem_rsp_ports_.at(bank_id).empty()
+			 || !prefetch_queues_.at(bank_id).empty()
+			 || banks_.at(bank_id).mshr.has_replay())
+				return false;
+		}
+		for (uint32_t i = 0, n = config_.mem_ports; i < n; ++i) {
+			if (!nc_arbs_.at(i)->RspIn.at(1).empty())
+				return false;
+		}
+		return true;
+	}
+
 	const PerfStats& perf_stats() const {
 		return perf_stats_;
 	}
 
+	void save(CheckpointWriter& ckpt) const {
+		ckpt.section(CKPT_TAG('C','A','C','H'));
+		ckpt.write<bool>(config_.bypass);
+		if (config_.bypass)
+			return;
+		ckpt.write<uint8_t>(config_.C);
+		ckpt.write<uint8_t>(config_.L);
+		ckpt.write<uint8_t>(config_.A);
+		ckpt.write<uint8_t>(config_.B);
+		for (auto& bank : banks_) {
+			assert(bank.mshr.empty());
+			for (auto& set : bank.sets) {
+				for (auto& line : set.lines) {
+					ckpt.write<uint64_t>(line.tag);
+					ckpt.write<bool>(line.valid);
+					ckpt.write<bool>(line.dirty);
+				}
+			}
+			bank.repl.save(ckpt);
+		}
+		ckpt.write<PerfStats>(perf_stats_);
+	}
+
+	void restore(CheckpointReader& ckpt) {
+		ckpt.section(CKPT_TAG('C','A','C','H'));
+		if (ckpt.read<bool>())
+			return;
+		auto C = ckpt.read<uint8_t>();
+		auto L = ckpt.read<uint8_t>();
+		auto A = ckpt.read<uint8_t>();
+		auto B = ckpt.read<uint8_t>();
+		if (config_.bypass || C != config_.C || L != config_.L || A != config_.A || B != config_.B) {
+			// another cache configuration, start from a cold cache
+			uint64_t lines_per_bank = uint64_t(1) << (C - L - B);
+			for (uint32_t i = 0, n = (1 << B); i < n; ++i) {
+				ckpt.skip(lines_per_bank * (sizeof(uint64_t) + 2 * sizeof(bool)));
+				ckpt.read<CacheReplPolicy>();
+				auto repl_words = ckpt.read<uint64_t>();
+				ckpt.skip(repl_words * sizeof(uint64_t) + sizeof(uint64_t) + sizeof(uint32_t));
+			}
+			ckpt.skip(sizeof(PerfStats));
+			std::cout << "warning: " << simobject_->name() << " configuration differs from checkpoint, starting cold" << std::endl;
+			return;
+		}
+		for (auto& bank : banks_) {
+			for (auto& set : bank.sets) {
+				for (auto& line : set.lines) {
+					line.tag   = ckpt.read<uint64_t>();
+					line.valid = ckpt.read<bool>();
+					line.dirty = ckpt.read<bool>();
+					line.prefetched = false;
+				}
+			}
+			bank.repl.restore(ckpt);
+		}
+		perf_stats_ = ckpt.read<PerfStats>();
+	}
+
+	bool warm(uint64_t addr, bool& write) {
+		if (config_.bypass)
+			return true;
+
+		auto& bank  = banks_.at(params_.addr_bank_id(addr));
+		auto set_id = params_.addr_set_id(addr);
+		auto& set   = bank.sets.at(set_id);
+		auto tag    = params_.addr_tag(addr);
+
+		// same tag lookup and replacement update as a core request
+		int32_t free_line_id = -1;
+		auto hit_line_id = this->lookup(bank, set_id, tag, &free_line_id);
+
+		if (hit_line_id != -1) {
+			if (!write)
+				return false;
+			if (config_.write_back) {
+				set.lines.at(hit_line_id).dirty = true;
+				return false;
+			}
+			// write-through
+			return true;
+		}
+
+		if (write && !config_.write_back) {
+			// no write allocate
+			return true;
+		}
+
+		// fill the line, the next level sees a read
+		auto line_id = (free_line_id != -1) ? free_line_id : bank.repl.victim(set_id);
+		bank.repl.fill(set_id, line_id, (free_line_id == -1));
+		auto& line = set.lines.at(line_id);
+		line.valid = true;
+		line.tag   = tag;
+		line.dirty = write;
+		line.prefetched = false;
+		write = false;
+		return true;
+	}
+
 private:
 
+	// tag match, returns the hit line or -1, with the last free line if any
+	int32_t probe(const set_t& set, uint64_t tag, int32_t* free_line_id) const {
+		int32_t hit_line_id = -1;
+		for (uint32_t i = 0, n = set.lines.size(); i < n; ++i) {
+			auto& line = set.lines[i];
+			if (line.valid) {
+				if (line.tag == tag) {
+					hit_line_id = i;
+				}
+			} else {
+				*free_line_id = i;
+			}
+		}
+		return hit_line_id;
+	}
+
+	// tag lookup, updates the replacement state
+	int32_t lookup(bank_t& bank, uint32_t set_id, uint64_t tag, int32_t* free_line_id) {
+		auto& set = bank.sets.at(set_id);
+		auto hit_line_id = this->probe(set, tag, free_line_id);
+		if (hit_line_id != -1) {
+			bank.repl.hit(set_id, hit_line_id);
+		}
+		return hit_line_id;
+	}
+
+	// select the line to replace for a new fill, writing back its dirty data
+	uint32_t allocateLine(uint32_t bank_id, const bank_req_t& bank_req, int32_t free_line_id) {
+		auto& bank = banks_.at(bank_id);
+		auto& set  = bank.sets.at(bank_req.set_id);
+		uint32_t line_id = free_line_id;
+		if (free_line_id == -1) {
+			line_id = bank.repl.victim(bank_req.set_id);
+			auto& repl_line = set.lines.at(line_id);
+			if (repl_line.prefetched) {
+				// evicted before any demand use
+				++perf_stats_.prefetch_polluting;
+				repl_line.prefetched = false;
+			}
+			if (config_.write_back) {
+				// write back dirty line
+				if (repl_line.dirty) {
+					MemReq mem_req;
+					mem_req.addr  = params_.mem_addr(bank_id, bank_req.set_id, repl_line.tag);
+					mem_req.write = true;
+					mem_req.cid   = bank_req.cid;
+					mem_req_ports_.at(bank_id).push(mem_req, 1);
+					DT(3, simobject_->name() << "-bank" << bank_id << "-writeback: " << mem_req);
+					++perf_stats_.evictions;
+				}
+			}
+		}
+		bank.repl.fill(bank_req.set_id, line_id, (free_line_id == -1));
+		return line_id;
+	}
+
+	// queue the prefetch candidates of a demand read on their banks
+	void trainPrefetcher(uint32_t bank_id, const bank_req_t& bank_req, bool miss, bool prefetch_hit) {
+		auto line = params_.mem_addr(bank_id, bank_req.set_id, bank_req.tag) >> config_.L;
+		for (auto pf_line : prefetcher_.train(line, bank_req.pc, bank_req.wid, miss, prefetch_hit)) {
+			uint64_t addr = pf_line << config_.L;
+			if (get_addr_type(addr) != AddrType::Global)
+				continue;
+			auto& queue = prefetch_queues_.at(params_.addr_bank_id(addr));
+			if (queue.size() == PREFETCH_QUEUE_SIZE)
+				continue;
+			bool queued = false;
+			for (auto& pf_req : queue) {
+				queued |= (pf_req.addr == addr);
+			}
+			if (!queued) {
+				queue.push_back({addr, bank_req.cid, bank_req.wid, bank_req.pc});
+			}
+		}
+	}
+
 	void processBypassResponse(const MemRsp& mem_rsp) {
 		uint32_t req_id = mem_rsp.tag & ((1 << params_.log2_num_inputs)-1);
 		uint64_t tag = mem_rsp.tag >> params_.log2_num_inputs;
@@ -558,6 +1240,16 @@ private:
 				auto& line  = set.lines.at(entry.line_id);
 				line.valid  = true;
 				line.tag    = entry.bank_req.tag;
+				line.prefetched = false;
+				if (entry.bank_req.type == bank_req_t::Prefetch) {
+					// tagged until its first demand hit, unless a demand miss
+					// already waited on it
+					line.prefetched = !entry.promoted;
+					if (!entry.promoted) {
+						--pending_prefetch_fills_;
+					}
+					bank.mshr.release(pipeline_req.tag);
+				}
 				--pending_fill_reqs_;
 			} break;
 			case bank_req_t::Replay: {
@@ -573,37 +1265,24 @@ private:
 				}
 			} break;
 			case bank_req_t::Core: {
-				int32_t hit_line_id  = -1;
-				int32_t free_line_id = -1;
-				int32_t repl_line_id = 0;
-				uint32_t max_cnt = 0;
-
 				auto& set = bank.sets.at(pipeline_req.set_id);
 
 				// tag lookup
-				for (uint32_t i = 0, n = set.lines.size(); i < n; ++i) {
-					auto& line = set.lines.at(i);
-					if (max_cnt < line.lru_ctr) {
-						max_cnt = line.lru_ctr;
-						repl_line_id = i;
-					}
-					if (line.valid) {
-						if (line.tag == pipeline_req.tag) {
-							hit_line_id = i;
-							line.lru_ctr = 0;
-						} else {
-							++line.lru_ctr;
-						}
-					} else {
-						free_line_id = i;
-					}
-				}
+				int32_t free_line_id = -1;
+				auto hit_line_id = this->lookup(bank, pipeline_req.set_id, pipeline_req.tag, &free_line_id);
+				bool prefetch_hit = false;
 
 				if (hit_line_id != -1) {
 					// Hit handling
+					auto& hit_line = set.lines.at(hit_line_id);
+					if (hit_line.prefetched) {
+						// first demand use of a prefetched line
+						++perf_stats_.prefetch_useful;
+						hit_line.prefetched = false;
+						prefetch_hit = true;
+					}
 					if (pipeline_req.write) {
 						// handle write has_hit
-						auto& hit_line = set.lines.at(hit_line_id);
 						if (!config_.write_back) {
 							// forward write request to memory
 							MemReq mem_req;
@@ -635,20 +1314,6 @@ private:
 					else
 						++perf_stats_.read_misses;
 
-					if (free_line_id == -1 && config_.write_back) {
-						// write back dirty line
-						auto& repl_line = set.lines.at(repl_line_id);
-						if (repl_line.dirty) {
-							MemReq mem_req;
-							mem_req.addr  = params_.mem_addr(bank_id, pipeline_req.set_id, repl_line.tag);
-							mem_req.write = true;
-							mem_req.cid   = pipeline_req.cid;
-							mem_req_ports_.at(bank_id).push(mem_req, 1);
-							DT(3, simobject_->name() << "-bank" << bank_id << "-writeback: " << mem_req);
-							++perf_stats_.evictions;
-						}
-					}
-
 					if (pipeline_req.write && !config_.write_back) {
 						// forward write request to memory
 						{
@@ -673,9 +1338,21 @@ private:
 					} else {
 						// MSHR lookup
 						auto mshr_pending = bank.mshr.lookup(pipeline_req);
+						if (mshr_pending && bank.mshr.promote(pipeline_req)) {
+							// the prefetch was issued too late to hide the miss,
+							// its fill now counts toward the demand latency
+							++perf_stats_.prefetch_late;
+							--pending_prefetch_fills_;
+						}
+
+						// select the line to replace, secondary misses share the pending fill
+						int32_t repl_line_id = (free_line_id != -1) ? free_line_id : 0;
+						if (!mshr_pending) {
+							repl_line_id = this->allocateLine(bank_id, pipeline_req, free_line_id);
+						}
 
 						// allocate MSHR
-						auto mshr_id = bank.mshr.allocate(pipeline_req, (free_line_id != -1) ? free_line_id : repl_line_id);
+						auto mshr_id = bank.mshr.allocate(pipeline_req, repl_line_id);
 						DT(3, simobject_->name() << "-bank" << bank_id << "-mshr-enqueue: " << pipeline_req);
 
 						// send fill request
@@ -685,6 +1362,8 @@ private:
 							mem_req.write = false;
 							mem_req.tag   = mshr_id;
 							mem_req.cid   = pipeline_req.cid;
+							mem_req.wid   = pipeline_req.wid;
+							mem_req.pc    = pipeline_req.pc;
 							mem_req.uuid  = pipeline_req.uuid;
 							mem_req_ports_.at(bank_id).push(mem_req, 1);
 							DT(3, simobject_->name() << "-bank" << bank_id << "-fill: " << mem_req);
@@ -692,11 +1371,43 @@ private:
 						}
 					}
 				}
+
+				if (!pipeline_req.write
+				 && prefetcher_.type() != CachePrefetcher::None) {
+					this->trainPrefetcher(bank_id, pipeline_req, (hit_line_id == -1), prefetch_hit);
+				}
+			} break;
+			case bank_req_t::Prefetch: {
+				// drop prefetches of resident or pending lines,
+				// the last MSHR entry is left to demand misses
+				auto& set = bank.sets.at(pipeline_req.set_id);
+				int32_t free_line_id = -1;
+				if (this->probe(set, pipeline_req.tag, &free_line_id) != -1
+				 || bank.mshr.lookup(pipeline_req)
+				 || bank.mshr.available() < 2)
+					break;
+
+				auto line_id = this->allocateLine(bank_id, pipeline_req, free_line_id);
+				auto mshr_id = bank.mshr.allocate(pipeline_req, line_id);
+
+				MemReq mem_req;
+				mem_req.addr  = params_.mem_addr(bank_id, pipeline_req.set_id, pipeline_req.tag);
+				mem_req.write = false;
+				mem_req.tag   = mshr_id;
+				mem_req.cid   = pipeline_req.cid;
+				mem_req.wid   = pipeline_req.wid;
+				mem_req.pc    = pipeline_req.pc;
+				mem_req_ports_.at(bank_id).push(mem_req, 1);
+				DT(3, simobject_->name() << "-bank" << bank_id << "-prefetch: " << mem_req);
+				++pending_fill_reqs_;
+				++pending_prefetch_fills_;
+				++perf_stats_.prefetches;
 			} break;
 			}
 		}
-		// calculate memory latency
-		perf_stats_.mem_latency += pending_fill_reqs_;
+		// calculate memory latency of the demand fills
+		assert(pending_prefetch_fills_ <= pending_fill_reqs_);
+		perf_stats_.mem_latency += pending_fill_reqs_ - pending_prefetch_fills_;
 	}
 };
 
@@ -721,8 +1432,23 @@ void CacheSim::reset() {
 
 void CacheSim::tick() {
   impl_->tick();
+  if (impl_->idle()) {
+    this->sleep();
+  }
 }
 
 const CacheSim::PerfStats& CacheSim::perf_stats() const {
   return impl_->perf_stats();
+}
+
+void CacheSim::save(CheckpointWriter& ckpt) const {
+  impl_->save(ckpt);
+}
+
+void CacheSim::restore(CheckpointReader& ckpt) {
+  impl_->restore(ckpt);
+}
+
+bool CacheSim::warm(uint64_t addr, bool& write) {
+  return impl_->warm(addr, write);
 }
\ No newline at end of file
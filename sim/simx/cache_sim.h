@@ -18,6 +18,9 @@
 
 namespace vortex {
 
+class CheckpointWriter;
+class CheckpointReader;
+
 class CacheSim : public SimObject<CacheSim> {
 public:
 	struct Config {
@@ -35,6 +38,9 @@ public:
 		bool    write_reponse;  // enable write response
 		uint16_t mshr_size;     // MSHR buffer size
 		uint8_t latency;        // pipeline latency
+		CacheReplPolicy repl_policy; // replacement policy
+		CachePrefetcher prefetcher;  // hardware prefetcher
+		uint8_t prefetch_degree;     // lines requested per trigger
 	};
 
 	struct PerfStats {
@@ -47,6 +53,10 @@ public:
 		uint64_t bank_stalls;
 		uint64_t mshr_stalls;
 		uint64_t mem_latency;
+		uint64_t prefetches;
+		uint64_t prefetch_useful;
+		uint64_t prefetch_late;
+		uint64_t prefetch_polluting;
 
 		PerfStats()
 			: reads(0)
@@ -58,6 +68,10 @@ public:
 			, bank_stalls(0)
 			, mshr_stalls(0)
 			, mem_latency(0)
+			, prefetches(0)
+			, prefetch_useful(0)
+			, prefetch_late(0)
+			, prefetch_polluting(0)
 		{}
 
 		PerfStats& operator+=(const PerfStats& rhs) {
@@ -70,6 +84,10 @@ public:
 			this->bank_stalls += rhs.bank_stalls;
 			this->mshr_stalls += rhs.mshr_stalls;
 			this->mem_latency += rhs.mem_latency;
+			this->prefetches += rhs.prefetches;
+			this->prefetch_useful += rhs.prefetch_useful;
+			this->prefetch_late += rhs.prefetch_late;
+			this->prefetch_polluting += rhs.prefetch_polluting;
 			return *this;
 		}
 	};
@@ -88,6 +106,18 @@ public:
 
 	const PerfStats& perf_stats() const;
 
+	// Update the tag array for an access without simulating its timing,
+	// used to warm the cache while fast-forwarding.
+	// Returns true if the access continues to the next level, in which case
+	// write is updated to the type of the forwarded request.
+	bool warm(uint64_t addr, bool& write);
+
+	// tag array and counters, the cache must be idle
+	void save(CheckpointWriter& ckpt) const;
+
+	// a checkpoint taken with another cache geometry leaves the cache cold
+	void restore(CheckpointReader& ckpt);
+
 private:
 	class Impl;
 	Impl* impl_;
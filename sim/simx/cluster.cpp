@@ -12,6 +12,8 @@
 // limitations under the License.
 
 #include "cluster.h"
+#include "processor_impl.h"
+#include <checkpoint.h>
 
 using namespace vortex;
 
@@ -43,21 +45,25 @@ Cluster::Cluster(const SimContext& ctx,
   // Create l2cache
 
   snprintf(sname, 100, "%s-l2cache", this->name().c_str());
+  auto& l2cache = arch.l2cache();
   l2cache_ = CacheSim::Create(sname, CacheSim::Config{
-    !L2_ENABLED,
-    log2ceil(L2_CACHE_SIZE),// C
+    !l2cache.enabled,
+    (uint8_t)log2ceil(l2cache.size), // C
     log2ceil(MEM_BLOCK_SIZE),// L
     log2ceil(L1_LINE_SIZE), // W
-    log2ceil(L2_NUM_WAYS),  // A
-    log2ceil(L2_NUM_BANKS), // B
+    (uint8_t)log2ceil(l2cache.num_ways), // A
+    (uint8_t)log2ceil(l2cache.num_banks), // B
     XLEN,                   // address bits
     1,                      // number of ports
     L2_NUM_REQS,            // request size
     L2_MEM_PORTS,           // memory ports
-    L2_WRITEBACK,           // write-back
+    l2cache.write_back,     // write-back
     false,                  // write response
-    L2_MSHR_SIZE,           // mshr size
-    2,                      // pipeline latency
+    l2cache.mshr_size,      // mshr size
+    l2cache.latency,        // pipeline latency
+    l2cache.repl_policy,    // replacement policy
+    l2cache.prefetcher,     // prefetcher
+    l2cache.prefetch_degree, // prefetch degree
   });
 
   // connect l2cache core interfaces
@@ -86,7 +92,8 @@ void Cluster::reset() {
 }
 
 void Cluster::tick() {
-  //--
+  // nothing to evaluate, sockets and the L2 cache tick on their own
+  this->sleep();
 }
 
 void Cluster::attach_ram(RAM* ram) {
@@ -146,6 +153,34 @@ void Cluster::barrier(uint32_t bar_id, uint32_t count, uint32_t core_id) {
     }
 }
 
+void Cluster::warm_l2(uint64_t addr, bool write) {
+  if (l2cache_->warm(addr, write)) {
+    processor_->warm_l3(addr, write);
+  }
+}
+
+void Cluster::save(CheckpointWriter& ckpt) const {
+  ckpt.section(CKPT_TAG('C','L','S','T'));
+  for (auto& barrier : barriers_) {
+    ckpt.write<CoreMask>(barrier);
+  }
+  for (auto& socket : sockets_) {
+    socket->save(ckpt);
+  }
+  l2cache_->save(ckpt);
+}
+
+void Cluster::restore(CheckpointReader& ckpt) {
+  ckpt.section(CKPT_TAG('C','L','S','T'));
+  for (auto& barrier : barriers_) {
+    barrier = ckpt.read<CoreMask>();
+  }
+  for (auto& socket : sockets_) {
+    socket->restore(ckpt);
+  }
+  l2cache_->restore(ckpt);
+}
+
 Cluster::PerfStats Cluster::perf_stats() const {
   PerfStats perf_stats;
   perf_stats.l2cache = l2cache_->perf_stats();
@@ -51,6 +51,10 @@ public:
     return processor_;
   }
 
+  const std::vector<Socket::Ptr>& sockets() const {
+    return sockets_;
+  }
+
   void reset();
 
   void tick();
@@ -67,6 +71,12 @@ public:
 
   void barrier(uint32_t bar_id, uint32_t count, uint32_t core_id);
 
+  void warm_l2(uint64_t addr, bool write);
+
+  void save(CheckpointWriter& ckpt) const;
+
+  void restore(CheckpointReader& ckpt);
+
   PerfStats perf_stats() const;
 
 private:
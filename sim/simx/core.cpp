@@ -16,10 +16,12 @@
 #include <string.h>
 #include <assert.h>
 #include <util.h>
+#include <checkpoint.h>
 #include "types.h"
 #include "arch.h"
 #include "mem.h"
 #include "core.h"
+#include "socket.h"
 #include "debug.h"
 #include "constants.h"
 
@@ -53,6 +55,7 @@ Core::Core(const SimContext& ctx,
 
   for (uint32_t i = 0; i < ISSUE_WIDTH; ++i) {
     operands_.at(i) = SimPlatform::instance().create_object<Operand>();
+    operands_.at(i)->Output.set_consumer(this);
   }
 
   // create the memory coalescer
@@ -132,6 +135,11 @@ Core::Core(const SimContext& ctx,
   dispatchers_.at((int)FUType::LSU) = SimPlatform::instance().create_object<Dispatcher>(arch, 2, NUM_LSU_BLOCKS, NUM_LSU_LANES);
   dispatchers_.at((int)FUType::SFU) = SimPlatform::instance().create_object<Dispatcher>(arch, 2, NUM_SFU_BLOCKS, NUM_SFU_LANES);
   dispatchers_.at((int)FUType::TCU) = SimPlatform::instance().create_object<Dispatcher>(arch, 2, NUM_TCU_BLOCKS, NUM_TCU_LANES);
+  for (auto& dispatcher : dispatchers_) {
+    for (auto& output : dispatcher->Outputs) {
+      output.set_consumer(this);
+    }
+  }
 
   // initialize execute units
   func_units_.at((int)FUType::ALU) = SimPlatform::instance().create_object<AluUnit>(this);
@@ -147,6 +155,7 @@ Core::Core(const SimContext& ctx,
     for (uint32_t j = 0; j < (uint32_t)FUType::Count; ++j) {
       func_units_.at(j)->Outputs.at(i).bind(&arbiter->Inputs.at(j));
     }
+    arbiter->Outputs.at(0).set_consumer(this);
     commit_arbs_.at(i) = arbiter;
   }
 
@@ -176,30 +185,150 @@ void Core::reset() {
 
   ibuffer_idx_ = 0;
   pending_instrs_ = 0;
+  draining_ = false;
   pending_ifetches_ = 0;
 
   perf_stats_ = PerfStats();
+  perf_cycle_ = SimPlatform::instance().cycles();
+  next_cycle_ = perf_cycle_;
 }
 
 void Core::tick() {
+  // catch up with the cycles skipped while asleep
+  auto cycle = SimPlatform::instance().cycles();
+  if (cycle != next_cycle_) {
+    this->update_idle_stats();
+    ibuffer_idx_ += (cycle - next_cycle_);
+  }
+
   this->commit();
   this->execute();
   this->issue();
   this->decode();
   this->fetch();
-  this->schedule();
+  bool scheduled = this->schedule();
 
   ++perf_stats_.cycles;
+  perf_cycle_ = cycle + 1;
+  next_cycle_ = cycle + 1;
   DPN(2, std::flush);
+
+  // sleep until an instruction completes or a warp is resumed,
+  // stay awake while the scheduler holds back a ready warp
+  if (!scheduled && this->idle() && !emulator_.ready()) {
+    this->sleep();
+  }
+}
+
+bool Core::idle() const {
+  if (draining_
+   || !fetch_latch_.empty()
+   || !decode_latch_.empty()
+   || !icache_rsp_ports.at(0).empty())
+    return false;
+  for (auto& ibuffer : ibuffers_) {
+    if (!ibuffer.empty())
+      return false;
+  }
+  for (uint32_t i = 0; i < ISSUE_WIDTH; ++i) {
+    if (!operands_.at(i)->Output.empty()
+     || !commit_arbs_.at(i)->Outputs.at(0).empty())
+      return false;
+    for (auto& dispatcher : dispatchers_) {
+      if (!dispatcher->Outputs.at(i).empty())
+        return false;
+    }
+  }
+  return true;
+}
+
+void Core::update_idle_stats() const {
+  // an idle tick only counts the cycle, the scheduler idle cycle
+  // and the latency of pending instruction fetches
+  auto cycle = SimPlatform::instance().cycles();
+  if (cycle <= perf_cycle_)
+    return;
+  auto idle_cycles = cycle - perf_cycle_;
+  perf_stats_.cycles += idle_cycles;
+  perf_stats_.sched_idle += idle_cycles;
+  perf_stats_.ifetch_latency += pending_ifetches_ * idle_cycles;
+  perf_cycle_ = cycle;
+}
+
+void Core::tick_functional() {
+  perf_stats_.instrs += emulator_.step_functional();
+  ++perf_stats_.cycles;
+}
+
+uint32_t Core::fast_forward() {
+  this->wake();
+  return emulator_.step_functional(true);
+}
+
+void Core::drain(bool enable) {
+  this->update_idle_stats();
+  draining_ = enable;
+  this->wake();
+}
+
+void Core::save(CheckpointWriter& ckpt) const {
+  assert(pending_instrs_ == 0);
+  ckpt.section(CKPT_TAG('C','O','R','E'));
+  ckpt.write<PerfStats>(this->perf_stats());
+  emulator_.save(ckpt);
+  local_mem_->save(ckpt);
 }
 
-void Core::schedule() {
+void Core::restore(CheckpointReader& ckpt) {
+  ckpt.section(CKPT_TAG('C','O','R','E'));
+  perf_stats_ = ckpt.read<PerfStats>();
+  emulator_.restore(ckpt);
+  local_mem_->restore(ckpt);
+}
+
+void Core::warm_caches(const instr_trace_t* trace) {
+  uint32_t core_index = core_id_ % arch_.socket_size();
+
+  socket_->warm_icache(core_index, trace->PC);
+
+  if (trace->fu_type != FUType::LSU || trace->lsu_type == LsuType::FENCE)
+    return;
+
+  auto trace_data = std::dynamic_pointer_cast<LsuTraceData>(trace->data);
+  if (trace_data == nullptr)
+    return;
+
+  bool is_write = (trace->lsu_type == LsuType::STORE)
+               || (trace->lsu_type == LsuType::TCU_STORE);
+
+  // one access per cache line, as after the coalescer
+  uint64_t last_line = uint64_t(-1);
+  for (uint32_t t = 0, n = arch_.num_threads(); t < n; ++t) {
+    if (!trace->tmask.test(t))
+      continue;
+    auto addr = trace_data->mem_addrs.at(t).addr;
+    if (get_addr_type(addr) != AddrType::Global)
+      continue;
+    uint64_t line = addr / L1_LINE_SIZE;
+    if (line == last_line)
+      continue;
+    socket_->warm_dcache(core_index, addr, is_write);
+    last_line = line;
+  }
+}
+
+bool Core::schedule() {
+  if (draining_)
+    return false;
+
   auto trace = emulator_.step();
   if (trace == nullptr) {
     ++perf_stats_.sched_idle;
-    return;
+    return false;
   }
 
+  ++perf_stats_.warp_issues[trace->wid];
+
   // suspend warp until decode
   emulator_.suspend(trace->wid);
 
@@ -208,6 +337,7 @@ void Core::schedule() {
   // advance to fetch stage
   fetch_latch_.push(trace);
   ++pending_instrs_;
+  return true;
 }
 
 void Core::fetch() {
@@ -234,6 +364,8 @@ void Core::fetch() {
   mem_req.write = false;
   mem_req.tag   = pending_icache_.allocate(trace);
   mem_req.cid   = trace->cid;
+  mem_req.wid   = trace->wid;
+  mem_req.pc    = trace->PC;
   mem_req.uuid  = trace->uuid;
   icache_req_ports.at(0).push(mem_req, 2);
   DT(3, "icache-req: addr=0x" << std::hex << mem_req.addr << ", tag=0x" << mem_req.tag << std::dec << ", " << *trace);
@@ -419,13 +551,16 @@ bool Core::running() const {
 
 void Core::resume(uint32_t wid) {
   emulator_.resume(wid);
+  this->wake();
 }
 
 bool Core::barrier(uint32_t bar_id, uint32_t count, uint32_t wid) {
+  this->wake();
   return emulator_.barrier(bar_id, count, wid);
 }
 
 bool Core::wspawn(uint32_t num_warps, Word nextPC) {
+  this->wake();
   return emulator_.wspawn(num_warps, nextPC);
 }
 
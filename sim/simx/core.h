@@ -57,6 +57,7 @@ public:
     uint64_t stores;
     uint64_t ifetch_latency;
     uint64_t load_latency;
+    uint64_t warp_issues[MAX_NUM_WARPS];
 
     PerfStats()
       : cycles(0)
@@ -77,6 +78,7 @@ public:
       , stores(0)
       , ifetch_latency(0)
       , load_latency(0)
+      , warp_issues()
     {}
   };
 
@@ -98,6 +100,26 @@ public:
 
   void tick();
 
+  // functional mode: execute without the timing pipeline
+  void tick_functional();
+
+  // sampled mode: execute without the timing pipeline while warming the
+  // caches, returns the number of thread instructions executed
+  uint32_t fast_forward();
+
+  // sampled mode: stop scheduling new instructions so the pipeline drains
+  void drain(bool enable);
+
+  bool drained() const {
+    return pending_instrs_ == 0;
+  }
+
+  void warm_caches(const instr_trace_t* trace);
+
+  void save(CheckpointWriter& ckpt) const;
+
+  void restore(CheckpointReader& ckpt);
+
   void attach_ram(RAM* ram);
 #ifdef VM_ENABLE
   void set_satp(uint64_t satp);
@@ -132,20 +154,29 @@ public:
   }
 
   const PerfStats& perf_stats() const {
+    this->update_idle_stats();
     return perf_stats_;
   }
 
+  const Emulator& emulator() const {
+    return emulator_;
+  }
+
   int get_exitcode() const;
 
 private:
 
-  void schedule();
+  bool schedule();
   void fetch();
   void decode();
   void issue();
   void execute();
   void commit();
 
+  bool idle() const;
+
+  void update_idle_stats() const;
+
   uint32_t core_id_;
   Socket* socket_;
   const Arch& arch_;
@@ -169,13 +200,18 @@ private:
 
   uint64_t pending_ifetches_;
 
-  PerfStats perf_stats_;
+  // idle cycles skipped while asleep are accounted lazily
+  mutable PerfStats perf_stats_;
+  mutable uint64_t perf_cycle_;
+  uint64_t next_cycle_;
 
   std::vector<TraceArbiter::Ptr> commit_arbs_;
 
   uint32_t commit_exe_;
   uint32_t ibuffer_idx_;
 
+  bool draining_;
+
   friend class LsuUnit;
   friend class AluUnit;
   friend class FpuUnit;
@@ -13,6 +13,7 @@
 
 #include "dcrs.h"
 #include <iostream>
+#include <checkpoint.h>
 
 using namespace vortex;
 
@@ -25,4 +26,18 @@ void DCRS::write(uint32_t addr, uint32_t value) {
 
   std::cout << "Error: invalid global DCR addr=0x" << std::hex << addr << std::dec << std::endl;
   std::abort();
-}
\ No newline at end of file
+}
+
+void DCRS::save(CheckpointWriter& ckpt) const {
+  ckpt.section(CKPT_TAG('D','C','R','S'));
+  for (uint32_t addr = VX_DCR_BASE_STATE_BEGIN; addr < VX_DCR_BASE_STATE_END; ++addr) {
+    ckpt.write<uint32_t>(base_dcrs.read(addr));
+  }
+}
+
+void DCRS::restore(CheckpointReader& ckpt) {
+  ckpt.section(CKPT_TAG('D','C','R','S'));
+  for (uint32_t addr = VX_DCR_BASE_STATE_BEGIN; addr < VX_DCR_BASE_STATE_END; ++addr) {
+    base_dcrs.write(addr, ckpt.read<uint32_t>());
+  }
+}
@@ -19,6 +19,9 @@
 
 namespace vortex {
 
+class CheckpointWriter;
+class CheckpointReader;
+
 class BaseDCRS {
 public:
   uint32_t read(uint32_t addr) const {
@@ -39,6 +42,10 @@ class DCRS {
 public:
   void write(uint32_t addr, uint32_t value);
 
+  void save(CheckpointWriter& ckpt) const;
+
+  void restore(CheckpointReader& ckpt);
+
   BaseDCRS base_dcrs;
 };
 
@@ -0,0 +1,221 @@
+// Copyright © 2019-2023
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+#include <memory>
+#include <new>
+#include <vector>
+#include <mem.h>
+#include <util.h>
+#include "instr.h"
+
+namespace vortex {
+
+// PC-indexed cache of decoded instructions.
+// Entries are grouped into flat per-page tables reached through a radix
+// directory over the page number, a lookup is a short directory walk (skipped
+// while the PC stays on the same page) followed by an array index. Decoded
+// instructions live in a per-page arena and are handed out as raw pointers.
+// Filled pages are registered with the RAM as code pages; a write to one of
+// them bumps the RAM code version and the next lookup drops the cached pages
+// whose RAM page version changed.
+class DecodeCache {
+public:
+  struct entry_t {
+    const Instr* instr;
+    uint32_t code;
+  };
+
+  DecodeCache(uint32_t page_size)
+    : page_bits_(log2ceil(page_size))
+    , ram_(nullptr)
+    , version_(0)
+    , last_page_(nullptr)
+    , last_page_index_(0)
+    , hits_(0)
+    , misses_(0)
+  {
+    // split the PC page number into equal radix levels of at most 10 bits
+    uint32_t index_bits = XLEN - page_bits_;
+    levels_ = std::max<uint32_t>(1, (index_bits + 9) / 10);
+    level_bits_ = (index_bits + levels_ - 1) / levels_;
+    root_ = this->alloc_node();
+  }
+
+  ~DecodeCache() {
+    this->clear();
+    free(root_);
+  }
+
+  DecodeCache(const DecodeCache&) = delete;
+  DecodeCache& operator=(const DecodeCache&) = delete;
+
+  void attach_ram(RAM* ram) {
+    ram_ = ram;
+    this->clear();
+  }
+
+  void clear() {
+    for (auto node : nodes_) {
+      free(node);
+    }
+    nodes_.clear();
+    memset(root_, 0, sizeof(void*) << level_bits_);
+    pages_.clear();
+    last_page_ = nullptr;
+    if (ram_) {
+      version_ = ram_->code_version();
+    }
+  }
+
+  const entry_t* lookup(uint64_t pc) {
+    if (ram_ == nullptr)
+      return nullptr;
+    if (version_ != ram_->code_version()) {
+      this->revalidate();
+    }
+    auto page = this->get_page(pc >> page_bits_, false);
+    if (page) {
+      auto& entry = page->entries[this->page_offset(pc)];
+      if (entry.instr) {
+        ++hits_;
+        return &entry;
+      }
+    }
+    ++misses_;
+    return nullptr;
+  }
+
+  const entry_t* insert(uint64_t pc, uint32_t code, const Instr& instr) {
+    if (ram_ == nullptr || (pc & 0x3) != 0) {
+      // not cacheable, hand back a scratch entry
+      bypass_instr_ = instr;
+      bypass_ = {&bypass_instr_, code};
+      return &bypass_;
+    }
+    auto version = ram_->mark_code_page(pc);
+    auto page = this->get_page(pc >> page_bits_, true);
+    if (page->entries.empty()) {
+      uint32_t num_entries = 1 << (page_bits_ - 2);
+      page->entries.resize(num_entries, entry_t{nullptr, 0});
+      // reserved once so that the handed out pointers stay valid
+      page->instrs.reserve(num_entries);
+      page->version = version;
+    }
+    auto& entry = page->entries[this->page_offset(pc)];
+    page->instrs.push_back(instr);
+    entry = {&page->instrs.back(), code};
+    return &entry;
+  }
+
+  uint64_t hits() const {
+    return hits_;
+  }
+
+  uint64_t misses() const {
+    return misses_;
+  }
+
+private:
+
+  struct page_t {
+    std::vector<entry_t> entries;
+    std::vector<Instr> instrs; // decoded instructions arena
+    uint64_t index;
+    uint64_t version; // RAM page version when filled
+  };
+
+  // drop the pages modified since the last lookup
+  void revalidate() {
+    version_ = ram_->code_version();
+    for (auto it = pages_.begin(); it != pages_.end();) {
+      auto index = (*it)->index;
+      if (ram_->code_page_version(index << page_bits_) != (*it)->version) {
+        *this->page_slot(index, false) = nullptr;
+        *it = std::move(pages_.back());
+        pages_.pop_back();
+      } else {
+        ++it;
+      }
+    }
+    last_page_ = nullptr;
+  }
+
+  uint32_t page_offset(uint64_t pc) const {
+    return (pc & ((uint64_t(1) << page_bits_) - 1)) >> 2;
+  }
+
+  page_t* get_page(uint64_t page_index, bool allocate) {
+    if (last_page_ && last_page_index_ == page_index)
+      return last_page_;
+    auto slot = this->page_slot(page_index, allocate);
+    if (slot == nullptr)
+      return nullptr;
+    if (*slot == nullptr) {
+      if (!allocate)
+        return nullptr;
+      pages_.emplace_back(new page_t());
+      pages_.back()->index = page_index;
+      *slot = pages_.back().get();
+    }
+    last_page_ = (page_t*)*slot;
+    last_page_index_ = page_index;
+    return last_page_;
+  }
+
+  // return the directory entry of a page, nullptr if a level is missing
+  // and allocate is not set
+  void** page_slot(uint64_t page_index, bool allocate) {
+    uint64_t level_mask = (uint64_t(1) << level_bits_) - 1;
+    void** node = root_;
+    for (uint32_t l = levels_ - 1; l != 0; --l) {
+      auto& next = node[(page_index >> (l * level_bits_)) & level_mask];
+      if (next == nullptr) {
+        if (!allocate)
+          return nullptr;
+        next = this->alloc_node();
+        nodes_.push_back((void**)next);
+      }
+      node = (void**)next;
+    }
+    return &node[page_index & level_mask];
+  }
+
+  void** alloc_node() const {
+    auto node = (void**)calloc(size_t(1) << level_bits_, sizeof(void*));
+    if (node == nullptr) {
+      throw std::bad_alloc();
+    }
+    return node;
+  }
+
+  uint32_t page_bits_;
+  RAM*     ram_;
+  uint64_t version_;
+  uint32_t levels_;
+  uint32_t level_bits_;
+  void**   root_;
+  std::vector<void**> nodes_;
+  std::vector<std::unique_ptr<page_t>> pages_;
+  page_t*  last_page_;
+  uint64_t last_page_index_;
+  Instr    bypass_instr_;
+  entry_t  bypass_;
+  uint64_t hits_;
+  uint64_t misses_;
+};
+
+}
@@ -36,18 +36,28 @@ public:
 		, pid_count_(arch.num_threads() / num_lanes)
 		, batch_idx_(0)
 		, start_p_(block_size, 0)
+		, next_cycle_(0)
 	{}
 	
 	virtual ~Dispatcher() {}
 
 	virtual void reset() {
 		batch_idx_ = 0;
+		next_cycle_ = SimPlatform::instance().cycles();
 		for (uint32_t b = 0; b < block_size_; ++b) {
 			start_p_.at(b) = 0;
 		}
 	}
 
 	virtual void tick() {
+		// the batch index rotates on every idle cycle, including the ones
+		// skipped while asleep
+		auto cycle = SimPlatform::instance().cycles();
+		if (cycle != next_cycle_) {
+			batch_idx_ = (batch_idx_ + (cycle - next_cycle_)) % batch_count_;
+		}
+		next_cycle_ = cycle + 1;
+
 		for (uint32_t i = 0; i < ISSUE_WIDTH; ++i) {
 			auto& queue = queues_.at(i);
 			if (queue.empty())
@@ -114,6 +124,11 @@ public:
 				start_p_.at(b) = 0;
 			}
 		}
+
+		// sleep until new instructions are pushed
+		if (this->idle()) {
+			this->sleep();
+		}
 	};
 
 	bool push(uint32_t issue_index, instr_trace_t* trace) {
@@ -121,10 +136,20 @@ public:
 		if (queue.size() >= buf_size_)
 			return false;
 		queue.push(trace);
+		this->wake();
 		return true;
 	}
 
 private:
+
+	bool idle() const {
+		for (uint32_t i = 0; i < ISSUE_WIDTH; ++i) {
+			if (!queues_.at(i).empty() || !Inputs_.at(i).empty())
+				return false;
+		}
+		return true;
+	}
+
 	std::vector<SimPort<instr_trace_t*>> Inputs_;
 	const Arch& arch_;
 	std::vector<std::queue<instr_trace_t*>> queues_;
@@ -135,6 +160,7 @@ private:
 	uint32_t pid_count_;
 	uint32_t batch_idx_;
 	std::vector<int> start_p_;
+	uint64_t next_cycle_;
 };
 
 }
@@ -17,6 +17,7 @@
 #include <math.h>
 #include <assert.h>
 #include <util.h>
+#include <checkpoint.h>
 
 #include "emulator.h"
 #include "instr_trace.h"
@@ -89,7 +90,10 @@ Emulator::Emulator(const Arch &arch, const DCRS &dcrs, Core* core)
     , dcrs_(dcrs)
     , core_(core)
     , warps_(arch.num_warps(), arch)
+    , warp_sched_(arch)
     , barriers_(arch.num_barriers(), 0)
+    , decode_cache_(MEM_PAGE_SIZE)
+    , ftrace_(new instr_trace_t(0, arch))
     , ipdom_size_(arch.num_threads()-1)
     // [TBC] Currently, tradeoff between scratchpad size & performance has not been evaluated. Scratchpad is
     // considered to be big enough to hold input tiles for one output tile.
@@ -112,6 +116,7 @@ Emulator::Emulator(const Arch &arch, const DCRS &dcrs, Core* core)
 
 Emulator::~Emulator() {
   this->cout_flush();
+  delete ftrace_;
 }
 
 void Emulator::clear() {
@@ -135,6 +140,8 @@ void Emulator::clear() {
 
   csr_mscratch_ = startup_arg;
 
+  mpm_bank_ = VX_MPM_BANK_CORE;
+
   stalled_warps_.reset();
   active_warps_.reset();
 
@@ -143,22 +150,173 @@ void Emulator::clear() {
   warps_[0].tmask.set(0);
   wspawn_.valid = false;
 
+  warp_sched_.clear();
+
   for (auto& reg : scratchpad) {
     reg = 0;
   }
 }
 
+void Emulator::save(CheckpointWriter& ckpt) const {
+  ckpt.section(CKPT_TAG('E','M','U','L'));
+
+  for (auto& warp : warps_) {
+    ckpt.write<Word>(warp.PC);
+    ckpt.write<ThreadMask>(warp.tmask);
+    for (auto& reg_file : warp.ireg_file) {
+      ckpt.write(reg_file.data(), reg_file.size() * sizeof(Word));
+    }
+    for (auto& reg_file : warp.freg_file) {
+      ckpt.write(reg_file.data(), reg_file.size() * sizeof(uint64_t));
+    }
+    // IPDOM entries from the bottom of the stack
+    auto ipdom_stack = warp.ipdom_stack;
+    std::vector<ipdom_entry_t> ipdom_entries;
+    while (!ipdom_stack.empty()) {
+      ipdom_entries.push_back(ipdom_stack.top());
+      ipdom_stack.pop();
+    }
+    ckpt.write<uint32_t>(ipdom_entries.size());
+    for (auto it = ipdom_entries.rbegin(); it != ipdom_entries.rend(); ++it) {
+      ckpt.write<ThreadMask>(it->orig_tmask);
+      ckpt.write<ThreadMask>(it->else_tmask);
+      ckpt.write<Word>(it->PC);
+      ckpt.write<bool>(it->fallthrough);
+    }
+    ckpt.write<Byte>(warp.fcsr);
+  #ifdef EXT_V_ENABLE
+    for (auto& reg_file : warp.vreg_file) {
+      ckpt.write(reg_file.data(), reg_file.size());
+    }
+    ckpt.write<vtype_t>(warp.vtype);
+    ckpt.write<uint32_t>(warp.vl);
+    ckpt.write<Word>(warp.vlmax);
+  #endif
+    ckpt.write<uint32_t>(warp.uuid);
+  }
+
+  ckpt.write<WarpMask>(active_warps_);
+  ckpt.write<WarpMask>(stalled_warps_);
+  warp_sched_.save(ckpt);
+  for (auto& barrier : barriers_) {
+    ckpt.write<WarpMask>(barrier);
+  }
+  ckpt.write<Word>(csr_mscratch_);
+  ckpt.write<uint32_t>(mpm_bank_);
+  ckpt.write<wspawn_t>(wspawn_);
+  ckpt.write<uint32_t>(mat_size);
+  ckpt.write<uint32_t>(tc_size);
+  ckpt.write<uint32_t>(tc_num);
+
+#ifdef EXT_V_ENABLE
+  for (auto& warp_csrs : csrs_) {
+    for (auto& thread_csrs : warp_csrs) {
+      ckpt.write<uint32_t>(thread_csrs.size());
+      for (auto& csr : thread_csrs) {
+        ckpt.write<uint32_t>(csr.first);
+        ckpt.write<uint32_t>(csr.second);
+      }
+    }
+  }
+#endif
+
+  // the tensor scratchpad is mostly empty, write its non-zero blocks only
+  const uint32_t block_size = 1024;
+  for (uint32_t i = 0, n = scratchpad.size(); i < n; i += block_size) {
+    auto size = std::min<uint32_t>(block_size, n - i);
+    auto begin = scratchpad.begin() + i;
+    if (std::all_of(begin, begin + size, [](Word w) { return w == 0; }))
+      continue;
+    ckpt.write<uint32_t>(i);
+    ckpt.write(scratchpad.data() + i, size * sizeof(Word));
+  }
+  ckpt.write<uint32_t>(uint32_t(-1));
+}
+
+void Emulator::restore(CheckpointReader& ckpt) {
+  ckpt.section(CKPT_TAG('E','M','U','L'));
+
+  for (auto& warp : warps_) {
+    warp.PC = ckpt.read<Word>();
+    warp.tmask = ckpt.read<ThreadMask>();
+    for (auto& reg_file : warp.ireg_file) {
+      ckpt.read(reg_file.data(), reg_file.size() * sizeof(Word));
+    }
+    for (auto& reg_file : warp.freg_file) {
+      ckpt.read(reg_file.data(), reg_file.size() * sizeof(uint64_t));
+    }
+    warp.ipdom_stack = std::stack<ipdom_entry_t>();
+    auto ipdom_size = ckpt.read<uint32_t>();
+    for (uint32_t i = 0; i < ipdom_size; ++i) {
+      auto orig_tmask = ckpt.read<ThreadMask>();
+      auto else_tmask = ckpt.read<ThreadMask>();
+      auto PC = ckpt.read<Word>();
+      ipdom_entry_t entry(orig_tmask, else_tmask, PC);
+      entry.fallthrough = ckpt.read<bool>();
+      warp.ipdom_stack.push(entry);
+    }
+    warp.fcsr = ckpt.read<Byte>();
+  #ifdef EXT_V_ENABLE
+    for (auto& reg_file : warp.vreg_file) {
+      ckpt.read(reg_file.data(), reg_file.size());
+    }
+    warp.vtype = ckpt.read<vtype_t>();
+    warp.vl = ckpt.read<uint32_t>();
+    warp.vlmax = ckpt.read<Word>();
+  #endif
+    warp.uuid = ckpt.read<uint32_t>();
+  }
+
+  active_warps_ = ckpt.read<WarpMask>();
+  stalled_warps_ = ckpt.read<WarpMask>();
+  warp_sched_.restore(ckpt);
+  for (auto& barrier : barriers_) {
+    barrier = ckpt.read<WarpMask>();
+  }
+  csr_mscratch_ = ckpt.read<Word>();
+  mpm_bank_ = ckpt.read<uint32_t>();
+  wspawn_ = ckpt.read<wspawn_t>();
+  mat_size = ckpt.read<uint32_t>();
+  tc_size = ckpt.read<uint32_t>();
+  tc_num = ckpt.read<uint32_t>();
+
+#ifdef EXT_V_ENABLE
+  for (auto& warp_csrs : csrs_) {
+    for (auto& thread_csrs : warp_csrs) {
+      thread_csrs.clear();
+      auto num_csrs = ckpt.read<uint32_t>();
+      for (uint32_t i = 0; i < num_csrs; ++i) {
+        auto addr = ckpt.read<uint32_t>();
+        thread_csrs[addr] = ckpt.read<uint32_t>();
+      }
+    }
+  }
+#endif
+
+  std::fill(scratchpad.begin(), scratchpad.end(), 0);
+  const uint32_t block_size = 1024;
+  for (;;) {
+    auto i = ckpt.read<uint32_t>();
+    if (i == uint32_t(-1))
+      break;
+    assert(i < scratchpad.size());
+    auto size = std::min<uint32_t>(block_size, scratchpad.size() - i);
+    ckpt.read(scratchpad.data() + i, size * sizeof(Word));
+  }
+}
+
 void Emulator::attach_ram(RAM* ram) {
   // bind RAM to memory unit
 #if (XLEN == 64)
   mmu_.attach(*ram, 0, 0x7FFFFFFFFF); //39bit SV39
 #else
   mmu_.attach(*ram, 0, 0xFFFFFFFF);
+  // fetch addresses are physical, so decoded code can be cached by PC
+  decode_cache_.attach_ram(ram);
 #endif
 }
 
-instr_trace_t* Emulator::step() {
-  int scheduled_warp = -1;
+void Emulator::activate_wspawn() {
   // process pending wspawn
   if (wspawn_.valid && active_warps_.count() == 1) {
     DP(3, "*** Activate " << (wspawn_.num_warps-1) << " warps at PC: " << std::hex << wspawn_.nextPC << std::dec);
@@ -171,54 +329,48 @@ instr_trace_t* Emulator::step() {
     wspawn_.valid = false;
     stalled_warps_.reset(0);
   }
+}
 
-  // find next ready warp
-  for (size_t wid = 0, nw = arch_.num_warps(); wid < nw; ++wid) {
-    bool warp_active = active_warps_.test(wid);
-    bool warp_stalled = stalled_warps_.test(wid);
-    if (warp_active && !warp_stalled) {
-      scheduled_warp = wid;
-      break;
-    }
-  }
-  if (scheduled_warp == -1)
-    return nullptr;
-
-  // suspend warp until decode
-  auto& warp = warps_.at(scheduled_warp);
-  assert(warp.tmask.any());
-
+uint64_t Emulator::next_uuid(uint32_t wid) {
 #ifndef NDEBUG
   // generate unique universal instruction ID
-  uint32_t instr_uuid = warp.uuid++;
-  uint32_t g_wid = core_->id() * arch_.num_warps() + scheduled_warp;
-  uint64_t uuid = (uint64_t(g_wid) << 32) | instr_uuid;
+  uint32_t instr_uuid = warps_.at(wid).uuid++;
+  uint32_t g_wid = core_->id() * arch_.num_warps() + wid;
+  return (uint64_t(g_wid) << 32) | instr_uuid;
 #else
-  uint64_t uuid = 0;
+  __unused (wid);
+  return 0;
 #endif
+}
 
-  DP(1, "Fetch: cid=" << core_->id() << ", wid=" << scheduled_warp << ", tmask=" << ThreadMaskOS(warp.tmask, arch_.num_threads())
-         << ", PC=0x" << std::hex << warp.PC << " (#" << std::dec << uuid << ")");
+const Instr& Emulator::fetch(uint32_t wid, uint64_t uuid) {
+  auto& warp = warps_.at(wid);
+  assert(warp.tmask.any());
 
-  // Fetch
-  uint32_t instr_code = 0;
-  this->icache_read(&instr_code, warp.PC, sizeof(uint32_t));
+  DP(1, "Fetch: cid=" << core_->id() << ", wid=" << wid << ", tmask=" << ThreadMaskOS(warp.tmask, arch_.num_threads())
+         << ", PC=0x" << std::hex << warp.PC << " (#" << std::dec << uuid << ")");
 
-  // Decode
-  auto instr = this->decode(instr_code);
-  if (!instr) {
-    std::cout << "Error: invalid instruction 0x" << std::hex << instr_code << ", at PC=0x" << warp.PC << " (#" << std::dec << uuid << ")" << std::endl;
-    std::abort();
+  // Fetch + Decode
+  auto decoded = decode_cache_.lookup(warp.PC);
+  if (decoded == nullptr) {
+    uint32_t instr_code = 0;
+    this->icache_read(&instr_code, warp.PC, sizeof(uint32_t));
+    auto new_instr = this->decode(instr_code);
+    if (!new_instr) {
+      std::cout << "Error: invalid instruction 0x" << std::hex << instr_code << ", at PC=0x" << warp.PC << " (#" << std::dec << uuid << ")" << std::endl;
+      std::abort();
+    }
+    decoded = decode_cache_.insert(warp.PC, instr_code, *new_instr);
   }
 
-  DP(1, "Instr 0x" << std::hex << instr_code << ": " << std::dec << *instr);
-
-  // Create trace
-  auto trace = new instr_trace_t(uuid, arch_);
+  DP(1, "Instr 0x" << std::hex << decoded->code << ": " << std::dec << *decoded->instr);
 
-  // Execute
-  this->execute(*instr, scheduled_warp, trace);
+  return *decoded->instr;
+}
 
+void Emulator::dump_registers(uint32_t wid) const {
+  auto& warp = warps_.at(wid);
+  __unused (warp);
   DP(5, "Register state:");
   for (uint32_t i = 0; i < MAX_NUM_REGS; ++i) {
     DPN(5, "  %r" << std::setfill('0') << std::setw(2) << i << ':' << std::hex);
@@ -233,13 +385,94 @@ instr_trace_t* Emulator::step() {
     }
     DPN(5, std::dec << std::endl);
   }
+}
+
+instr_trace_t* Emulator::step() {
+  this->activate_wspawn();
+
+  // find next ready warp
+  int scheduled_warp = warp_sched_.select(active_warps_, stalled_warps_, SimPlatform::instance().cycles());
+  if (scheduled_warp == -1)
+    return nullptr;
+
+  auto uuid = this->next_uuid(scheduled_warp);
+
+  auto& instr = this->fetch(scheduled_warp, uuid);
+
+  // Create trace
+  auto trace = new instr_trace_t(uuid, arch_);
+
+  // Execute
+  this->execute(instr, scheduled_warp, trace);
+
+  this->dump_registers(scheduled_warp);
+
   return trace;
 }
 
+uint32_t Emulator::step_functional(bool warm_caches) {
+  this->activate_wspawn();
+
+  // advance every ready warp by one instruction
+  uint32_t num_instrs = 0;
+  for (uint32_t wid = 0, nw = arch_.num_warps(); wid < nw; ++wid) {
+    if (!active_warps_.test(wid) || stalled_warps_.test(wid))
+      continue;
+
+    auto uuid = this->next_uuid(wid);
+
+    auto& instr = this->fetch(wid, uuid);
+
+    // reuse the scratch trace, only warp control needs its content
+    auto trace = ftrace_;
+    trace->clear();
+
+    this->execute(instr, wid, trace);
+
+    this->dump_registers(wid);
+
+    if (warm_caches) {
+      core_->warm_caches(trace);
+    }
+
+    if (trace->eop) {
+      // same accounting as the pipeline commit stage
+      num_instrs += trace->tmask.count();
+    }
+
+    // apply the warp control the SFU would perform in the timing pipeline
+    if (trace->fu_type == FUType::SFU && trace->eop) {
+      switch (trace->sfu_type) {
+      case SfuType::WSPAWN: {
+        auto trace_data = std::dynamic_pointer_cast<SFUTraceData>(trace->data);
+        if (!this->wspawn(trace_data->arg1, trace_data->arg2)) {
+          // resumed once the spawn gets activated
+          stalled_warps_.set(wid);
+        }
+      } break;
+      case SfuType::BAR: {
+        auto trace_data = std::dynamic_pointer_cast<SFUTraceData>(trace->data);
+        stalled_warps_.set(wid);
+        if (this->barrier(trace_data->arg1, trace_data->arg2, wid)) {
+          stalled_warps_.reset(wid);
+        }
+      } break;
+      default:
+        break;
+      }
+    }
+  }
+  return num_instrs;
+}
+
 bool Emulator::running() const {
   return active_warps_.any();
 }
 
+bool Emulator::ready() const {
+  return (active_warps_ & ~stalled_warps_).any();
+}
+
 int Emulator::get_exitcode() const {
   return warps_.at(0).ireg_file.at(0).at(3);
 }
@@ -522,6 +755,7 @@ Word Emulator::get_csr(uint32_t addr, uint32_t tid, uint32_t wid) {
   case VX_CSR_NUM_CORES:  return uint32_t(arch_.num_cores()) * arch_.num_clusters();
   case VX_CSR_LOCAL_MEM_BASE: return arch_.local_mem_base();
   case VX_CSR_MSCRATCH:   return csr_mscratch_;
+  case VX_CSR_MPM_BANK:   return mpm_bank_;
   case VX_MAT_MUL_SIZE:   return mat_size;
   case VX_TC_NUM:         return tc_num;
   case VX_TC_SIZE:        return tc_size;
@@ -533,6 +767,18 @@ Word Emulator::get_csr(uint32_t addr, uint32_t tid, uint32_t wid) {
      || (addr >= VX_CSR_MPM_BASE_H && addr < (VX_CSR_MPM_BASE_H + 32))) {
       // user-defined MPM CSRs
       auto perf_class = dcrs_.base_dcrs.read(VX_DCR_BASE_MPM_CLASS);
+      // the prefetcher page extends the memory class window
+      bool prefetch_bank = (mpm_bank_ == VX_MPM_BANK_PREFETCH)
+                        && (perf_class == VX_DCR_MPM_CLASS_MEM || perf_class == VX_DCR_MPM_CLASS_ALL);
+      if (perf_class == VX_DCR_MPM_CLASS_ALL) {
+        // both classes are live, the bank register selects the visible one
+        switch (mpm_bank_) {
+        case VX_MPM_BANK_CORE: perf_class = VX_DCR_MPM_CLASS_CORE; break;
+        case VX_MPM_BANK_MEM:
+        case VX_MPM_BANK_PREFETCH: perf_class = VX_DCR_MPM_CLASS_MEM; break;
+        default: perf_class = VX_DCR_MPM_CLASS_NONE; break;
+        }
+      }
       switch (perf_class) {
       case VX_DCR_MPM_CLASS_NONE:
         break;
@@ -562,6 +808,21 @@ Word Emulator::get_csr(uint32_t addr, uint32_t tid, uint32_t wid) {
         auto socket_perf = core_->socket()->perf_stats();
         auto lmem_perf = core_->local_mem()->perf_stats();
 
+        if (prefetch_bank) {
+          switch (addr) {
+          CSR_READ_64(VX_CSR_MPM_DCACHE_PF_ISSUED, socket_perf.dcache.prefetches);
+          CSR_READ_64(VX_CSR_MPM_DCACHE_PF_USEFUL, socket_perf.dcache.prefetch_useful);
+          CSR_READ_64(VX_CSR_MPM_DCACHE_PF_LATE, socket_perf.dcache.prefetch_late);
+          CSR_READ_64(VX_CSR_MPM_DCACHE_PF_POLLUTE, socket_perf.dcache.prefetch_polluting);
+
+          CSR_READ_64(VX_CSR_MPM_L2CACHE_PF_ISSUED, cluster_perf.l2cache.prefetches);
+          CSR_READ_64(VX_CSR_MPM_L2CACHE_PF_USEFUL, cluster_perf.l2cache.prefetch_useful);
+          CSR_READ_64(VX_CSR_MPM_L2CACHE_PF_LATE, cluster_perf.l2cache.prefetch_late);
+          CSR_READ_64(VX_CSR_MPM_L2CACHE_PF_POLLUTE, cluster_perf.l2cache.prefetch_polluting);
+          }
+          break;
+        }
+
         uint64_t coalescer_misses = 0;
         for (uint i = 0; i < NUM_LSU_BLOCKS; ++i) {
           coalescer_misses += core_->mem_coalescer(i)->perf_stats().misses;
@@ -633,6 +894,9 @@ void Emulator::set_csr(uint32_t addr, Word value, uint32_t tid, uint32_t wid) {
   case VX_CSR_MSCRATCH:
     csr_mscratch_ = value;
     break;
+  case VX_CSR_MPM_BANK:
+    mpm_bank_ = value;
+    break;
 
 #ifdef EXT_V_ENABLE
   // Vector CRSs
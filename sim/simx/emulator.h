@@ -19,6 +19,8 @@
 #include <stack>
 #include <mem.h>
 #include "types.h"
+#include "decode_cache.h"
+#include "warp_sched.h"
 
 namespace vortex {
 
@@ -27,6 +29,8 @@ class DCRS;
 class Core;
 class Instr;
 class instr_trace_t;
+class CheckpointWriter;
+class CheckpointReader;
 
 class Emulator {
 public:
@@ -38,6 +42,11 @@ public:
 
   void clear();
 
+  // architectural state only, the pipeline must be drained
+  void save(CheckpointWriter& ckpt) const;
+
+  void restore(CheckpointReader& ckpt);
+
   void attach_ram(RAM* ram);
 #ifdef VM_ENABLE
   void set_satp(uint64_t satp) ;
@@ -45,8 +54,16 @@ public:
 
   instr_trace_t* step();
 
+  // execute one instruction on every ready warp without timing,
+  // returns the number of thread instructions executed
+  // (warm_caches also replays the accesses into the core's caches)
+  uint32_t step_functional(bool warm_caches = false);
+
   bool running() const;
 
+  // some warp can issue, the scheduler may still hold it back
+  bool ready() const;
+
   void suspend(uint32_t wid);
 
   void resume(uint32_t wid);
@@ -65,6 +82,10 @@ public:
 
   void dcache_write(const void* data, uint64_t addr, uint32_t size);
 
+  const DecodeCache& decode_cache() const {
+    return decode_cache_;
+  }
+
 private:
 
   struct ipdom_entry_t {
@@ -126,6 +147,14 @@ private:
     Word nextPC;
   };
 
+  void activate_wspawn();
+
+  uint64_t next_uuid(uint32_t wid);
+
+  const Instr& fetch(uint32_t wid, uint64_t uuid);
+
+  void dump_registers(uint32_t wid) const;
+
   std::shared_ptr<Instr> decode(uint32_t code) const;
 
   void execute(const Instr &instr, uint32_t wid, instr_trace_t *trace);
@@ -165,11 +194,15 @@ private:
   std::vector<warp_t> warps_;
   WarpMask    active_warps_;
   WarpMask    stalled_warps_;
+  WarpScheduler warp_sched_;
   std::vector<WarpMask> barriers_;
   std::unordered_map<int, std::stringstream> print_bufs_;
   MemoryUnit  mmu_;
+  DecodeCache decode_cache_;
+  instr_trace_t* ftrace_;
   uint32_t    ipdom_size_;
   Word        csr_mscratch_;
+  uint32_t    mpm_bank_;
   wspawn_t    wspawn_;
   std::vector<Word> scratchpad;
   uint32_t mat_size;
@@ -60,6 +60,8 @@ void AluUnit::tick() {
 		}
 		input.pop();
 	}
+	// all inputs consumed, wait for the next dispatch
+	this->sleep();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -96,6 +98,8 @@ void FpuUnit::tick() {
 		DT(3,this->name() << ": op=" << trace->fpu_type << ", " << *trace);
 		input.pop();
 	}
+	// all inputs consumed, wait for the next dispatch
+	this->sleep();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -103,7 +107,12 @@ void FpuUnit::tick() {
 LsuUnit::LsuUnit(const SimContext& ctx, Core* core)
 	: FuncUnit(ctx, core, "lsu-unit")
 	, pending_loads_(0)
-{}
+{
+	// memory responses are polled from the lmem switches
+	for (auto& lmem_switch : core->lmem_switch_) {
+		lmem_switch->RspIn.set_consumer(this);
+	}
+}
 
 LsuUnit::~LsuUnit()
 {}
@@ -202,6 +211,8 @@ void LsuUnit::tick() {
 		}
 		lsu_req.tag  = tag;
 		lsu_req.cid  = trace->cid;
+		lsu_req.wid  = trace->wid;
+		lsu_req.pc   = trace->PC;
 		lsu_req.uuid = trace->uuid;
 
 		// send memory request
@@ -225,6 +236,27 @@ void LsuUnit::tick() {
 		// remove input
 		input.pop();
 	}
+
+	// sleep once all memory operations completed
+	// (the load latency is accumulated every cycle until then)
+	if (this->idle()) {
+		this->sleep();
+	}
+}
+
+bool LsuUnit::idle() const {
+	if (pending_loads_ != 0)
+		return false;
+	for (uint32_t b = 0; b < NUM_LSU_BLOCKS; ++b) {
+		if (states_.at(b).fence_lock
+		 || !core_->lmem_switch_.at(b)->RspIn.empty())
+			return false;
+	}
+	for (auto& input : Inputs) {
+		if (!input.empty())
+			return false;
+	}
+	return true;
 }
 /*  TO BE FIXED:Tensor_core code
     send_request is not used anymore. Need to be modified number of load
@@ -264,6 +296,8 @@ int LsuUnit::send_requests(instr_trace_t* trace, int block_idx, int tag) {
 			mem_req.type  = type;
 			mem_req.tag   = tag;
 			mem_req.cid   = trace->cid;
+			mem_req.wid   = trace->wid;
+			mem_req.pc    = trace->PC;
 			mem_req.uuid  = trace->uuid;
 
 			dcache_req_port.push(mem_req, 1);
@@ -315,6 +349,8 @@ void TcuUnit::tick() {
         DT(3, "pipeline-execute: op=" << trace->tcu_type << ", " << *trace);
         input.pop();
     }
+    // all inputs consumed, wait for the next dispatch
+    this->sleep();
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -369,4 +405,6 @@ void SfuUnit::tick() {
 
 		input.pop();
 	}
+	// all inputs consumed, wait for the next dispatch
+	this->sleep();
 }
@@ -73,6 +73,8 @@ public:
 
 private:
 
+	bool idle() const;
+
  	struct pending_req_t {
 		instr_trace_t* trace;
 		BitVector<> mask;
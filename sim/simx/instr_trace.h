@@ -130,6 +130,25 @@ public:
 
   ~instr_trace_t() {}
 
+  // reinitialize for reuse (functional mode)
+  void clear() {
+    cid = 0;
+    wid = 0;
+    tmask.reset();
+    PC = 0;
+    wb = false;
+    dst_reg = {RegType::None, 0};
+    std::fill(src_regs.begin(), src_regs.end(), reg_t{RegType::None, 0});
+    fu_type = FUType::ALU;
+    unit_type = 0;
+    data = nullptr;
+    pid = -1;
+    sop = true;
+    eop = true;
+    fetch_stall = false;
+    log_once_ = false;
+  }
+
   bool log_once(bool enable) {
     bool old = log_once_;
     log_once_ = enable;
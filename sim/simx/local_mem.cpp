@@ -54,6 +54,10 @@ public:
 			simobject->Inputs.at(i).bind(&mem_xbar_->ReqIn.at(i));
 			mem_xbar_->RspIn.at(i).bind(&simobject->Outputs.at(i));
 		}
+		// bank requests are polled from the crossbar
+		for (uint32_t i = 0; i < num_banks; ++i) {
+			mem_xbar_->ReqOut.at(i).set_consumer(simobject);
+		}
 	}
 
 	virtual ~Impl() {}
@@ -100,10 +104,26 @@ public:
 		}
 	}
 
+	bool idle() const {
+		for (auto& xbar_req_out : mem_xbar_->ReqOut) {
+			if (!xbar_req_out.empty())
+				return false;
+		}
+		return true;
+	}
+
 	const PerfStats& perf_stats() const {
 		perf_stats_.bank_stalls = mem_xbar_->req_collisions();
 		return perf_stats_;
 	}
+
+	void save(CheckpointWriter& ckpt) const {
+		ram_.save(ckpt);
+	}
+
+	void restore(CheckpointReader& ckpt) {
+		ram_.restore(ckpt);
+	}
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -133,8 +153,19 @@ void LocalMem::write(const void* data, uint64_t addr, uint32_t size) {
 
 void LocalMem::tick() {
   impl_->tick();
+  if (impl_->idle()) {
+    this->sleep();
+  }
 }
 
 const LocalMem::PerfStats& LocalMem::perf_stats() const {
   return impl_->perf_stats();
-}
\ No newline at end of file
+}
+
+void LocalMem::save(CheckpointWriter& ckpt) const {
+  impl_->save(ckpt);
+}
+
+void LocalMem::restore(CheckpointReader& ckpt) {
+  impl_->restore(ckpt);
+}
@@ -18,6 +18,9 @@
 
 namespace vortex {
 
+class CheckpointWriter;
+class CheckpointReader;
+
 class LocalMem : public SimObject<LocalMem> {
 public:
   struct Config {
@@ -63,6 +66,10 @@ public:
 
   const PerfStats& perf_stats() const;
 
+  void save(CheckpointWriter& ckpt) const;
+
+  void restore(CheckpointReader& ckpt);
+
 protected:
 
   class Impl;
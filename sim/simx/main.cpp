@@ -16,8 +16,11 @@
 #include <string>
 #include <sstream>
 #include <fstream>
+#include <stdio.h>
 #include <stdlib.h>
+#include <inttypes.h>
 #include <unistd.h>
+#include <getopt.h>
 #include <sys/stat.h>
 #include "processor.h"
 #include "mem.h"
@@ -29,19 +32,38 @@
 using namespace vortex;
 
 static void show_usage() {
-   std::cout << "Usage: [-c <cores>] [-w <warps>] [-t <threads>] [-v: vector-test] [-s: stats] [-h: help] <program>" << std::endl;
+   std::cout << "Usage: [-c <cores>] [-w <warps>] [-t <threads>] [-j <sim threads>] [-f|--functional] [--sample <fast-forward>:<window>[:<warmup>]] [--checkpoint <cycle>:<file>] [--restore <file>] [--caches <file>|<cache>.<param>=<value>,...] [--scheduler priority|lrr|gto|twolevel[:<pool size>]] [-v: vector-test] [-s: stats] [-h: help] <program>" << std::endl;
 }
 
 uint32_t num_threads = NUM_THREADS;
 uint32_t num_warps = NUM_WARPS;
 uint32_t num_cores = NUM_CORES;
+uint32_t num_sim_threads = 1;
+bool functional = false;
+uint64_t sample_fast_forward = 0;
+uint64_t sample_window = 0;
+uint64_t sample_warmup = 0;
+uint64_t checkpoint_cycle = 0;
+std::string checkpoint_file;
+const char* restore_file = nullptr;
+const char* cache_params = nullptr;
+const char* warp_scheduler = nullptr;
 bool showStats = false;
 bool vector_test = false;
 const char* program = nullptr;
 
 static void parse_args(int argc, char **argv) {
+  	static const struct option long_options[] = {
+      {"functional", no_argument, nullptr, 'f'},
+      {"sample", required_argument, nullptr, 'S'},
+      {"checkpoint", required_argument, nullptr, 'C'},
+      {"restore", required_argument, nullptr, 'R'},
+      {"caches", required_argument, nullptr, 'K'},
+      {"scheduler", required_argument, nullptr, 'W'},
+      {nullptr, 0, nullptr, 0}
+    };
   	int c;
-  	while ((c = getopt(argc, argv, "t:w:c:vsh")) != -1) {
+  	while ((c = getopt_long(argc, argv, "t:w:c:j:fS:C:R:K:W:vsh", long_options, nullptr)) != -1) {
     	switch (c) {
       case 't':
         num_threads = atoi(optarg);
@@ -52,6 +74,38 @@ static void parse_args(int argc, char **argv) {
 		  case 'c':
         num_cores = atoi(optarg);
         break;
+      case 'j':
+        num_sim_threads = atoi(optarg);
+        break;
+      case 'f':
+        functional = true;
+        break;
+      case 'S':
+        // lengths are in thread instructions
+        if (sscanf(optarg, "%" SCNu64 ":%" SCNu64 ":%" SCNu64, &sample_fast_forward, &sample_window, &sample_warmup) < 2
+         || sample_window == 0) {
+          show_usage();
+          exit(-1);
+        }
+        break;
+      case 'C': {
+        char* sep = nullptr;
+        checkpoint_cycle = strtoull(optarg, &sep, 0);
+        if (*sep != ':' || sep[1] == '\0') {
+          show_usage();
+          exit(-1);
+        }
+        checkpoint_file = sep + 1;
+      } break;
+      case 'R':
+        restore_file = optarg;
+        break;
+      case 'K':
+        cache_params = optarg;
+        break;
+      case 'W':
+        warp_scheduler = optarg;
+        break;
       case 'v':
         vector_test = true;
         break;
@@ -85,6 +139,12 @@ int main(int argc, char **argv) {
   {
     // create processor configuation
     Arch arch(num_threads, num_warps, num_cores);
+    if (cache_params && arch.set_cache_params(cache_params) != 0) {
+      return -1;
+    }
+    if (warp_scheduler && arch.set_warp_scheduler(warp_scheduler) != 0) {
+      return -1;
+    }
 
     // create memory module
     RAM ram(0, MEM_PAGE_SIZE);
@@ -95,6 +155,17 @@ int main(int argc, char **argv) {
     // attach memory module
     processor.attach_ram(&ram);
 
+    // set simulation mode
+    processor.set_num_threads(num_sim_threads);
+    processor.set_functional(functional);
+    processor.set_sampling(sample_fast_forward, sample_window, sample_warmup);
+    if (!checkpoint_file.empty()) {
+      processor.set_checkpoint(checkpoint_file.c_str(), checkpoint_cycle);
+    }
+    if (restore_file) {
+      processor.set_restore(restore_file);
+    }
+
 	  // setup base DCRs
     const uint64_t startup_addr(STARTUP_ADDR);
     processor.dcr_write(VX_DCR_BASE_STARTUP_ADDR0, startup_addr & 0xffffffff);
@@ -126,6 +197,10 @@ int main(int argc, char **argv) {
     // else continue as normal
     processor.run();
 
+    if (showStats) {
+      processor.show_stats();
+    }
+
     // read exitcode from @MPM.1
     ram.read(&exitcode, (IO_MPM_ADDR + 8), 4);
   }
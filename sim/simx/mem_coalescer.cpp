@@ -80,8 +80,13 @@ void MemCoalescer::tick() {
   }
 
   // process incoming requests
-  if (ReqIn.empty())
+  if (ReqIn.empty()) {
+    // sleep until new requests or responses arrive
+    if (RspOut.empty()) {
+      this->sleep();
+    }
     return;
+  }
 
   auto& in_req = ReqIn.front();
   assert(in_req.mask.size() == input_size_);
@@ -141,6 +146,8 @@ void MemCoalescer::tick() {
   out_req.write = in_req.write;
   out_req.addrs = out_addrs;
   out_req.cid = in_req.cid;
+  out_req.wid = in_req.wid;
+  out_req.pc = in_req.pc;
   out_req.uuid = in_req.uuid;
 
   // send memory request
@@ -29,6 +29,8 @@ private:
 	Config    config_;
 	MemCrossBar::Ptr mem_xbar_;
 	DramSim   dram_sim_;
+	uint64_t  dram_reqs_;
+	uint64_t  next_cycle_;
 	mutable PerfStats perf_stats_;
 	struct DramCallbackArgs {
 		MemSim::Impl* memsim;
@@ -41,6 +43,8 @@ public:
 		: simobject_(simobject)
 		, config_(config)
 		, dram_sim_(config.num_banks, config.block_size, config.clock_ratio)
+		, dram_reqs_(0)
+		, next_cycle_(0)
 	{
 		char sname[100];
 		snprintf(sname, 100, "%s-xbar", simobject->name().c_str());
@@ -53,6 +57,10 @@ public:
 			simobject->MemReqPorts.at(i).bind(&mem_xbar_->ReqIn.at(i));
 			mem_xbar_->RspIn.at(i).bind(&simobject->MemRspPorts.at(i));
 		}
+		// bank requests are polled from the crossbar
+		for (uint32_t i = 0; i < config.num_banks; ++i) {
+			mem_xbar_->ReqOut.at(i).set_consumer(simobject);
+		}
 	}
 
 	~Impl() {
@@ -66,9 +74,19 @@ public:
 
 	void reset() {
 		dram_sim_.reset();
+		dram_reqs_ = 0;
+		next_cycle_ = SimPlatform::instance().cycles();
 	}
 
+	// the DRAM clock keeps running while asleep, catch up on wake up
+	// (no request is pending, so no response can be missed)
 	void tick() {
+		auto cycle = SimPlatform::instance().cycles();
+		for (; next_cycle_ < cycle; ++next_cycle_) {
+			dram_sim_.tick();
+		}
+		next_cycle_ = cycle + 1;
+
 		dram_sim_.tick();
 
 		for (uint32_t i = 0; i < config_.num_banks; ++i) {
@@ -84,6 +102,7 @@ public:
 				mem_req.write,
 				[](void* arg) {
 					auto rsp_args = reinterpret_cast<const DramCallbackArgs*>(arg);
+					--rsp_args->memsim->dram_reqs_;
 					if (!rsp_args->request.write) {
 						// only send a response for read requests
 						MemRsp mem_rsp{rsp_args->request.tag, rsp_args->request.cid, rsp_args->request.uuid};
@@ -94,11 +113,22 @@ public:
 				},
 				req_args
 			);
+			++dram_reqs_;
 
 			DT(3, simobject_->name() << "-mem-req[" << i << "]: " << mem_req);
 			mem_xbar_->ReqOut.at(i).pop();
 		}
 	}
+
+	bool idle() const {
+		if (dram_reqs_ != 0)
+			return false;
+		for (auto& xbar_req_out : mem_xbar_->ReqOut) {
+			if (!xbar_req_out.empty())
+				return false;
+		}
+		return true;
+	}
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -120,6 +150,9 @@ void MemSim::reset() {
 
 void MemSim::tick() {
   impl_->tick();
+  if (impl_->idle()) {
+    this->sleep();
+  }
 }
 
 const MemSim::PerfStats &MemSim::perf_stats() const {
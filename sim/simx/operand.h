@@ -41,8 +41,11 @@ public:
 		}
 
     virtual void tick() {
-			if (Input.empty())
+			if (Input.empty()) {
+				// sleep until the next instruction arrives
+				this->sleep();
 				return;
+			}
 			auto trace = Input.front();
 
 			uint32_t stalls = 0;
@@ -11,14 +11,60 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <iomanip>
+#include <math.h>
+#include <checkpoint.h>
 #include "processor.h"
 #include "processor_impl.h"
 
 using namespace vortex;
 
+namespace {
+
+// mean and 95% confidence interval of the per-window samples
+class SampleStats {
+public:
+  SampleStats() : count_(0), mean_(0), m2_(0) {}
+
+  void add(double value) {
+    // Welford's online update
+    ++count_;
+    double delta = value - mean_;
+    mean_ += delta / count_;
+    m2_ += delta * (value - mean_);
+  }
+
+  uint64_t count() const {
+    return count_;
+  }
+
+  double mean() const {
+    return mean_;
+  }
+
+  double ci95() const {
+    if (count_ < 2)
+      return 0;
+    return 1.96 * sqrt(m2_ / (count_ - 1)) / sqrt(double(count_));
+  }
+
+private:
+  uint64_t count_;
+  double mean_;
+  double m2_;
+};
+
+}
+
 ProcessorImpl::ProcessorImpl(const Arch& arch)
   : arch_(arch)
   , clusters_(arch.num_clusters())
+  , ram_(nullptr)
+  , functional_(false)
+  , sample_fast_forward_(0)
+  , sample_window_(0)
+  , sample_warmup_(0)
+  , ckpt_cycle_(0)
 {
   SimPlatform::instance().initialize();
 
@@ -33,26 +79,33 @@ ProcessorImpl::ProcessorImpl(const Arch& arch)
   });
 
   // create clusters
+  // (each cluster is a partition that can be ticked on its own thread)
   for (uint32_t i = 0; i < arch.num_clusters(); ++i) {
+    SimPlatform::instance().begin_partition();
     clusters_.at(i) = Cluster::Create(i, this, arch, dcrs_);
+    SimPlatform::instance().end_partition();
   }
 
   // create L3 cache
+  auto& l3cache = arch.l3cache();
   l3cache_ = CacheSim::Create("l3cache", CacheSim::Config{
-    !L3_ENABLED,
-    log2ceil(L3_CACHE_SIZE),  // C
+    !l3cache.enabled,
+    (uint8_t)log2ceil(l3cache.size),   // C
     log2ceil(MEM_BLOCK_SIZE), // L
     log2ceil(L2_LINE_SIZE),   // W
-    log2ceil(L3_NUM_WAYS),    // A
-    log2ceil(L3_NUM_BANKS),   // B
+    (uint8_t)log2ceil(l3cache.num_ways), // A
+    (uint8_t)log2ceil(l3cache.num_banks), // B
     XLEN,                     // address bits
     1,                        // number of ports
     L3_NUM_REQS,              // request size
     L3_MEM_PORTS,             // memory ports
-    L3_WRITEBACK,             // write-back
+    l3cache.write_back,       // write-back
     false,                    // write response
-    L3_MSHR_SIZE,             // mshr size
-    2,                        // pipeline latency
+    l3cache.mshr_size,        // mshr size
+    l3cache.latency,          // pipeline latency
+    l3cache.repl_policy,      // replacement policy
+    l3cache.prefetcher,       // prefetcher
+    l3cache.prefetch_degree,  // prefetch degree
     }
   );
 
@@ -100,11 +153,26 @@ ProcessorImpl::ProcessorImpl(const Arch& arch)
   this->reset();
 }
 
+static void show_event_stats() {
+  auto sim_perf = SimPlatform::instance().perf_stats();
+  std::cout << "PERF: events=" << sim_perf.events
+            << ", peak events=" << sim_perf.peak_events
+            << ", skipped cycles=" << sim_perf.skipped_cycles
+            << ", pool allocs=" << sim_perf.pool_allocs
+            << ", pool slabs=" << sim_perf.pool_slabs
+            << ", pool bytes=" << sim_perf.pool_bytes << std::endl;
+}
+
 ProcessorImpl::~ProcessorImpl() {
+#ifndef NDEBUG
+  // report event allocation activity
+  show_event_stats();
+#endif
   SimPlatform::instance().finalize();
 }
 
 void ProcessorImpl::attach_ram(RAM* ram) {
+  ram_ = ram;
   for (auto cluster : clusters_) {
     cluster->attach_ram(ram);
   }
@@ -117,30 +185,368 @@ void ProcessorImpl::set_satp(uint64_t satp) {
 }
 #endif
 
+void ProcessorImpl::set_num_threads(uint32_t num_threads) {
+  SimPlatform::instance().set_num_threads(num_threads);
+}
+
+void ProcessorImpl::set_functional(bool enable) {
+  functional_ = enable;
+}
+
+void ProcessorImpl::set_sampling(uint64_t fast_forward, uint64_t window, uint64_t warmup) {
+  sample_fast_forward_ = fast_forward;
+  sample_window_ = window;
+  sample_warmup_ = warmup;
+}
+
 int ProcessorImpl::run() {
-  SimPlatform::instance().reset();
-  this->reset();
+  if (functional_) {
+    return this->run_functional();
+  }
+
+  if (sample_window_ != 0) {
+    return this->run_sampled();
+  }
 
+  this->start();
+
+  // stop at every cycle until the checkpoint is taken
+  SimPlatform::instance().set_clock_skip(ckpt_file_.empty());
+
+  do {
+    this->tick();
+    if (this->checkpoint_due()) {
+      // the pipeline state is not saved, let it retire first
+      this->drain();
+      this->save_checkpoint();
+      SimPlatform::instance().set_clock_skip(true);
+    }
+  } while (this->running());
+
+  return this->get_exitcode();
+}
+
+int ProcessorImpl::run_functional() {
+  this->start();
+
+  // step all cores round-robin, bypassing the timing model
   bool done;
-  int exitcode = 0;
   do {
-    SimPlatform::instance().tick();
+    if (this->checkpoint_due()) {
+      this->save_checkpoint();
+    }
     done = true;
-    for (auto cluster : clusters_) {
-      if (cluster->running()) {
-        done = false;
-        continue;
+    for (auto& cluster : clusters_) {
+      for (auto& socket : cluster->sockets()) {
+        for (auto& core : socket->cores()) {
+          if (!core->running())
+            continue;
+          core->tick_functional();
+          done = false;
+        }
       }
-    #ifdef EXT_V_ENABLE
-      exitcode |= cluster->get_exitcode();
-    #endif
     }
-    perf_mem_latency_ += perf_mem_pending_reads_;
   } while (!done);
 
+  return this->get_exitcode();
+}
+
+int ProcessorImpl::run_sampled() {
+  this->start();
+
+  // stop at every cycle until the checkpoint is taken
+  SimPlatform::instance().set_clock_skip(ckpt_file_.empty());
+
+  // collect the per-instruction rates of each measured window
+  SampleStats cpi, icache_mpi, dcache_mpi, l2cache_mpi, l3cache_mpi, mem_latency;
+  uint64_t ff_instrs = 0;
+  while (this->running()) {
+    // the fast-forward does not advance the cycles, a checkpoint due now
+    // is taken before it while the state is still precise
+    if (this->checkpoint_due()) {
+      this->save_checkpoint();
+      SimPlatform::instance().set_clock_skip(true);
+    }
+    ff_instrs += this->fast_forward(sample_fast_forward_);
+    if (!this->running())
+      break;
+
+    // refill the pipeline and the MSHRs before measuring
+    this->run_detailed(sample_warmup_);
+
+    auto start = this->sample_counters();
+    bool complete = this->run_detailed(sample_window_);
+    auto end = this->sample_counters();
+
+    // a window cut short by the end of the program is only kept if it is the only one
+    uint64_t instrs = end.instrs - start.instrs;
+    if ((complete || cpi.count() == 0) && instrs != 0) {
+      cpi.add(double(end.cycles - start.cycles) / instrs);
+      icache_mpi.add(double(end.icache_misses - start.icache_misses) / instrs);
+      dcache_mpi.add(double(end.dcache_misses - start.dcache_misses) / instrs);
+      l2cache_mpi.add(double(end.l2cache_misses - start.l2cache_misses) / instrs);
+      l3cache_mpi.add(double(end.l3cache_misses - start.l3cache_misses) / instrs);
+      uint64_t mem_reads = end.mem_reads - start.mem_reads;
+      if (mem_reads != 0) {
+        mem_latency.add(double(end.mem_latency - start.mem_latency) / mem_reads);
+      }
+    }
+
+    this->drain();
+  }
+
+  auto detailed = this->sample_counters();
+  uint64_t total_instrs = ff_instrs + detailed.instrs;
+
+  std::cout << "PERF: sampled windows=" << cpi.count()
+            << ", detailed instrs=" << detailed.instrs
+            << ", fast-forwarded instrs=" << ff_instrs << std::endl;
+  if (cpi.count() == 0) {
+    std::cout << "PERF: sampled no window was measured, reduce the fast-forward length" << std::endl;
+    return this->get_exitcode();
+  }
+
+  // extrapolate the window averages to the whole run (95% confidence)
+  auto est = [&](const SampleStats& stats)->std::string {
+    return std::to_string(uint64_t(stats.mean() * total_instrs + 0.5))
+         + " (+/-" + std::to_string(uint64_t(stats.ci95() * total_instrs + 0.5)) + ")";
+  };
+  double ipc = 1.0 / cpi.mean();
+  double ipc_ci = cpi.ci95() / (cpi.mean() * cpi.mean());
+  std::cout << std::fixed << std::setprecision(3);
+  std::cout << "PERF: sampled instrs=" << total_instrs
+            << ", cycles=" << est(cpi)
+            << ", IPC=" << ipc << " (+/-" << ipc_ci << ")" << std::endl;
+  std::cout << "PERF: sampled icache misses=" << est(icache_mpi)
+            << ", dcache misses=" << est(dcache_mpi)
+            << ", l2cache misses=" << est(l2cache_mpi)
+            << ", l3cache misses=" << est(l3cache_mpi) << std::endl;
+  if (mem_latency.count() != 0) {
+    std::cout << "PERF: sampled memory latency=" << mem_latency.mean()
+              << " (+/-" << mem_latency.ci95() << ") cycles" << std::endl;
+  }
+  std::cout << std::defaultfloat;
+
+  return this->get_exitcode();
+}
+
+void ProcessorImpl::start() {
+  SimPlatform::instance().reset();
+  this->reset();
+
+  if (!restore_file_.empty()) {
+    this->restore_checkpoint();
+  }
+
+  // clusters share the RAM when ticked in parallel,
+  // the host may also have made it concurrent for accesses during the run
+  if (ram_ && SimPlatform::instance().num_threads() > 1) {
+    ram_->set_concurrent(true);
+  }
+}
+
+void ProcessorImpl::tick() {
+  auto& platform = SimPlatform::instance();
+  auto cycles = platform.cycles();
+  platform.tick();
+  // the platform may skip idle cycles
+  perf_mem_latency_ += perf_mem_pending_reads_ * (platform.cycles() - cycles);
+}
+
+bool ProcessorImpl::running() const {
+  for (auto& cluster : clusters_) {
+    if (cluster->running())
+      return true;
+  }
+  return false;
+}
+
+int ProcessorImpl::get_exitcode() const {
+  int exitcode = 0;
+#ifdef EXT_V_ENABLE
+  for (auto& cluster : clusters_) {
+    exitcode |= cluster->get_exitcode();
+  }
+#endif
   return exitcode;
 }
 
+uint64_t ProcessorImpl::fast_forward(uint64_t num_instrs) {
+  uint64_t instrs = 0;
+  while (instrs < num_instrs) {
+    bool done = true;
+    for (auto& cluster : clusters_) {
+      for (auto& socket : cluster->sockets()) {
+        for (auto& core : socket->cores()) {
+          if (!core->running())
+            continue;
+          instrs += core->fast_forward();
+          done = false;
+        }
+      }
+    }
+    if (done)
+      break;
+  }
+  return instrs;
+}
+
+bool ProcessorImpl::run_detailed(uint64_t num_instrs) {
+  if (num_instrs == 0)
+    return true;
+  uint64_t end = this->committed_instrs() + num_instrs;
+  do {
+    if (!this->running())
+      return false;
+    this->tick();
+    if (this->checkpoint_due()) {
+      // the pipeline state is not saved, let it retire first
+      this->drain();
+      this->save_checkpoint();
+      SimPlatform::instance().set_clock_skip(true);
+    }
+  } while (this->committed_instrs() < end);
+  return true;
+}
+
+uint64_t ProcessorImpl::committed_instrs() const {
+  uint64_t instrs = 0;
+  for (auto& cluster : clusters_) {
+    for (auto& socket : cluster->sockets()) {
+      for (auto& core : socket->cores()) {
+        instrs += core->perf_stats().instrs;
+      }
+    }
+  }
+  return instrs;
+}
+
+void ProcessorImpl::drain() {
+  // let in-flight instructions retire so the emulator state is precise
+  std::vector<Core*> cores;
+  for (auto& cluster : clusters_) {
+    for (auto& socket : cluster->sockets()) {
+      for (auto& core : socket->cores()) {
+        core->drain(true);
+        cores.push_back(core.get());
+      }
+    }
+  }
+  for (;;) {
+    bool drained = true;
+    for (auto core : cores) {
+      drained &= core->drained();
+    }
+    if (drained)
+      break;
+    this->tick();
+  }
+  for (auto core : cores) {
+    core->drain(false);
+  }
+}
+
+ProcessorImpl::SampleCounters ProcessorImpl::sample_counters() const {
+  SampleCounters counters = {};
+  counters.instrs = this->committed_instrs();
+  counters.cycles = SimPlatform::instance().cycles();
+  for (auto& cluster : clusters_) {
+    for (auto& socket : cluster->sockets()) {
+      auto socket_perf = socket->perf_stats();
+      counters.icache_misses += socket_perf.icache.read_misses;
+      counters.dcache_misses += socket_perf.dcache.read_misses + socket_perf.dcache.write_misses;
+    }
+    auto l2cache = cluster->perf_stats().l2cache;
+    counters.l2cache_misses += l2cache.read_misses + l2cache.write_misses;
+  }
+  auto& l3cache = l3cache_->perf_stats();
+  counters.l3cache_misses = l3cache.read_misses + l3cache.write_misses;
+  counters.mem_reads = perf_mem_reads_;
+  counters.mem_latency = perf_mem_latency_;
+  return counters;
+}
+
+void ProcessorImpl::set_checkpoint(const char* filename, uint64_t cycle) {
+  ckpt_file_ = filename;
+  ckpt_cycle_ = cycle;
+}
+
+void ProcessorImpl::set_restore(const char* filename) {
+  restore_file_ = filename;
+}
+
+uint64_t ProcessorImpl::cycles() const {
+  uint64_t cycles = 0;
+  for (auto& cluster : clusters_) {
+    for (auto& socket : cluster->sockets()) {
+      for (auto& core : socket->cores()) {
+        cycles = std::max<uint64_t>(cycles, core->perf_stats().cycles);
+      }
+    }
+  }
+  return cycles;
+}
+
+bool ProcessorImpl::checkpoint_due() const {
+  return !ckpt_file_.empty() && this->cycles() >= ckpt_cycle_;
+}
+
+void ProcessorImpl::save_checkpoint() {
+  CheckpointWriter ckpt(ckpt_file_.c_str());
+  ckpt.section(CKPT_TAG('P','R','O','C'));
+  ckpt.write<uint32_t>(arch_.num_clusters());
+  ckpt.write<uint32_t>(arch_.num_cores());
+  ckpt.write<uint32_t>(arch_.num_warps());
+  ckpt.write<uint32_t>(arch_.num_threads());
+  dcrs_.save(ckpt);
+  for (auto& cluster : clusters_) {
+    cluster->save(ckpt);
+  }
+  l3cache_->save(ckpt);
+  ckpt.write<uint64_t>(perf_mem_reads_);
+  ckpt.write<uint64_t>(perf_mem_writes_);
+  ckpt.write<uint64_t>(perf_mem_latency_);
+  // memory goes last, it is the bulk of the file
+  ckpt.write<bool>(ram_ != nullptr);
+  if (ram_) {
+    ram_->save(ckpt);
+  }
+  std::cout << "Saved checkpoint " << ckpt_file_ << " at cycle " << this->cycles() << std::endl;
+  ckpt_file_.clear();
+}
+
+void ProcessorImpl::restore_checkpoint() {
+  CheckpointReader ckpt(restore_file_.c_str());
+  ckpt.section(CKPT_TAG('P','R','O','C'));
+  auto num_clusters = ckpt.read<uint32_t>();
+  auto num_cores = ckpt.read<uint32_t>();
+  auto num_warps = ckpt.read<uint32_t>();
+  auto num_threads = ckpt.read<uint32_t>();
+  if (num_clusters != arch_.num_clusters()
+   || num_cores != arch_.num_cores()
+   || num_warps != arch_.num_warps()
+   || num_threads != arch_.num_threads()) {
+    std::cout << "error: checkpoint " << restore_file_ << " was taken on another device configuration" << std::endl;
+    std::abort();
+  }
+  dcrs_.restore(ckpt);
+  for (auto& cluster : clusters_) {
+    cluster->restore(ckpt);
+  }
+  l3cache_->restore(ckpt);
+  perf_mem_reads_ = ckpt.read<uint64_t>();
+  perf_mem_writes_ = ckpt.read<uint64_t>();
+  perf_mem_latency_ = ckpt.read<uint64_t>();
+  if (ckpt.read<bool>() && ram_) {
+    ram_->restore(ckpt);
+  }
+  restore_file_.clear();
+}
+
+void ProcessorImpl::warm_l3(uint64_t addr, bool write) {
+  l3cache_->warm(addr, write);
+}
+
 void ProcessorImpl::reset() {
   perf_mem_reads_ = 0;
   perf_mem_writes_ = 0;
@@ -162,18 +568,108 @@ ProcessorImpl::PerfStats ProcessorImpl::perf_stats() const {
   return perf;
 }
 
+void ProcessorImpl::show_cache_stats() const {
+  CacheSim::PerfStats icache, dcache, l2cache;
+  for (auto& cluster : clusters_) {
+    for (auto& socket : cluster->sockets()) {
+      auto socket_perf = socket->perf_stats();
+      icache += socket_perf.icache;
+      dcache += socket_perf.dcache;
+    }
+    l2cache += cluster->perf_stats().l2cache;
+  }
+  auto show = [](const char* name, const CacheParams& params, const CacheSim::PerfStats& perf) {
+    if (!params.enabled)
+      return;
+    uint64_t accesses = perf.reads + perf.writes;
+    uint64_t misses = perf.read_misses + perf.write_misses;
+    int hit_ratio = accesses ? int((1.0 - (double(misses) / double(accesses))) * 100) : 0;
+    std::cout << "PERF: " << name << " policy=" << params.repl_policy
+              << ", accesses=" << accesses << ", misses=" << misses
+              << " (hit ratio=" << hit_ratio << "%)" << std::endl;
+    if (params.prefetcher == CachePrefetcher::None)
+      return;
+    // useful and late prefetches both served a demand miss
+    int accuracy = perf.prefetches ? int((double(perf.prefetch_useful + perf.prefetch_late) / double(perf.prefetches)) * 100) : 0;
+    std::cout << "PERF: " << name << " prefetcher=" << params.prefetcher
+              << ", issued=" << perf.prefetches << ", useful=" << perf.prefetch_useful
+              << ", late=" << perf.prefetch_late << ", polluting=" << perf.prefetch_polluting
+              << " (accuracy=" << accuracy << "%)" << std::endl;
+  };
+  show("icache", arch_.icache(), icache);
+  show("dcache", arch_.dcache(), dcache);
+  show("l2cache", arch_.l2cache(), l2cache);
+  show("l3cache", arch_.l3cache(), l3cache_->perf_stats());
+}
+
+void ProcessorImpl::show_stats() const {
+  uint64_t instrs = 0;
+  uint64_t cycles = 0;
+  uint64_t decode_hits = 0;
+  uint64_t decode_misses = 0;
+  std::vector<uint64_t> warp_issues(arch_.num_warps(), 0);
+  for (auto& cluster : clusters_) {
+    for (auto& socket : cluster->sockets()) {
+      for (auto& core : socket->cores()) {
+        auto& core_perf = core->perf_stats();
+        auto& decode_cache = core->emulator().decode_cache();
+        instrs += core_perf.instrs;
+        cycles = std::max<uint64_t>(cycles, core_perf.cycles);
+        decode_hits += decode_cache.hits();
+        decode_misses += decode_cache.misses();
+        for (uint32_t i = 0; i < arch_.num_warps(); ++i) {
+          warp_issues.at(i) += core_perf.warp_issues[i];
+        }
+      }
+    }
+  }
+  uint64_t decodes = decode_hits + decode_misses;
+  int decode_hit_ratio = decodes ? int((1.0 - (double(decode_misses) / double(decodes))) * 100) : 0;
+  if (functional_) {
+    // no timing in functional mode
+    std::cout << "PERF: instrs=" << instrs << std::endl;
+    return;
+  }
+  if (sample_window_ == 0) {
+    // sampled runs report their extrapolated totals at the end of run()
+    std::cout << "PERF: instrs=" << instrs << ", cycles=" << cycles << std::endl;
+  }
+  std::cout << "PERF: decode cache hits=" << decode_hits << ", misses=" << decode_misses
+            << " (hit ratio=" << decode_hit_ratio << "%)" << std::endl;
+  // issue slots each warp id got across the cores
+  std::cout << "PERF: scheduler=" << arch_.warp_sched();
+  if (arch_.warp_sched() == WarpSchedPolicy::TwoLevel) {
+    std::cout << ":" << arch_.warp_pool_size();
+  }
+  std::cout << ", warp issues=";
+  for (uint32_t i = 0; i < arch_.num_warps(); ++i) {
+    std::cout << (i ? "," : "") << warp_issues.at(i);
+  }
+  std::cout << std::endl;
+  this->show_cache_stats();
+  show_event_stats();
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
+// each processor simulates on its own platform, every entry point binds
+// the calling thread to it
 Processor::Processor(const Arch& arch)
-  : impl_(new ProcessorImpl(arch))
+  : platform_(new SimPlatform())
 {
+  SimPlatform::Scope scope(platform_);
+  impl_ = new ProcessorImpl(arch);
 #ifdef VM_ENABLE
   satp_ = NULL;
 #endif
 }
 
 Processor::~Processor() {
-  delete impl_;
+  {
+    SimPlatform::Scope scope(platform_);
+    delete impl_;
+  }
+  delete platform_;
 #ifdef VM_ENABLE
   if (satp_ != NULL)
     delete satp_;
@@ -181,17 +677,50 @@ Processor::~Processor() {
 }
 
 void Processor::attach_ram(RAM* mem) {
+  SimPlatform::Scope scope(platform_);
   impl_->attach_ram(mem);
 }
 
 int Processor::run() {
+  SimPlatform::Scope scope(platform_);
   return impl_->run();
 }
 
 void Processor::dcr_write(uint32_t addr, uint32_t value) {
+  SimPlatform::Scope scope(platform_);
   return impl_->dcr_write(addr, value);
 }
 
+void Processor::set_num_threads(uint32_t num_threads) {
+  SimPlatform::Scope scope(platform_);
+  impl_->set_num_threads(num_threads);
+}
+
+void Processor::set_functional(bool enable) {
+  SimPlatform::Scope scope(platform_);
+  impl_->set_functional(enable);
+}
+
+void Processor::set_sampling(uint64_t fast_forward, uint64_t window, uint64_t warmup) {
+  SimPlatform::Scope scope(platform_);
+  impl_->set_sampling(fast_forward, window, warmup);
+}
+
+void Processor::set_checkpoint(const char* filename, uint64_t cycle) {
+  SimPlatform::Scope scope(platform_);
+  impl_->set_checkpoint(filename, cycle);
+}
+
+void Processor::set_restore(const char* filename) {
+  SimPlatform::Scope scope(platform_);
+  impl_->set_restore(filename);
+}
+
+void Processor::show_stats() const {
+  SimPlatform::Scope scope(platform_);
+  impl_->show_stats();
+}
+
 #ifdef VM_ENABLE
 int16_t Processor::set_satp_by_addr(uint64_t base_addr) {
   uint16_t asid = 0;
@@ -199,6 +728,7 @@ int16_t Processor::set_satp_by_addr(uint64_t base_addr) {
   if (satp_ == NULL)
     return 1;
   uint64_t satp = satp_->get_satp();
+  SimPlatform::Scope scope(platform_);
   impl_->set_satp(satp);
   return 0;
 }
@@ -17,6 +17,8 @@
 #include <VX_config.h>
 #include <mem.h>
 
+class SimPlatform;
+
 namespace vortex {
 
 class Arch;
@@ -33,9 +35,30 @@ public:
 
   void attach_ram(RAM* mem);
 
+  // tick clusters on multiple host threads (1 = serial)
+  void set_num_threads(uint32_t num_threads);
+
+  // execute instructions only, without the timing model
+  void set_functional(bool enable);
+
+  // sampled simulation: alternate fast_forward instructions of functional
+  // execution with detailed windows of warmup + window instructions,
+  // measuring only the window (window = 0 disables sampling)
+  void set_sampling(uint64_t fast_forward, uint64_t window, uint64_t warmup);
+
+  // save the device state to filename once a run reaches the given cycle
+  // (the pipeline is drained first, so the save point may come a few cycles later)
+  void set_checkpoint(const char* filename, uint64_t cycle);
+
+  // start the next run from a saved device state instead of the reset state,
+  // caches whose geometry differs from the checkpoint start cold
+  void set_restore(const char* filename);
+
   int run();
 
   void dcr_write(uint32_t addr, uint32_t value);
+
+  void show_stats() const;
 #ifdef VM_ENABLE
   bool is_satp_unset();
   uint8_t get_satp_mode();
@@ -44,6 +67,7 @@ public:
 #endif
 
 private:
+  SimPlatform*   platform_;
   ProcessorImpl* impl_;
 #ifdef VM_ENABLE
   SATP_t *satp_;
@@ -36,6 +36,16 @@ public:
 
   void attach_ram(RAM* mem);
 
+  void set_num_threads(uint32_t num_threads);
+
+  void set_functional(bool enable);
+
+  void set_sampling(uint64_t fast_forward, uint64_t window, uint64_t warmup);
+
+  void set_checkpoint(const char* filename, uint64_t cycle);
+
+  void set_restore(const char* filename);
+
   int run();
 
   void dcr_write(uint32_t addr, uint32_t value);
@@ -46,12 +56,67 @@ public:
 
   PerfStats perf_stats() const;
 
+  void show_stats() const;
+
+  void warm_l3(uint64_t addr, bool write);
+
 private:
 
+  struct SampleCounters {
+    uint64_t instrs;
+    uint64_t cycles;
+    uint64_t icache_misses;
+    uint64_t dcache_misses;
+    uint64_t l2cache_misses;
+    uint64_t l3cache_misses;
+    uint64_t mem_reads;
+    uint64_t mem_latency;
+  };
+
+  int run_functional();
+
+  int run_sampled();
+
+  void start();
+
+  void tick();
+
+  uint64_t cycles() const;
+
+  bool checkpoint_due() const;
+
+  void save_checkpoint();
+
+  void restore_checkpoint();
+
+  bool running() const;
+
+  int get_exitcode() const;
+
+  uint64_t fast_forward(uint64_t num_instrs);
+
+  bool run_detailed(uint64_t num_instrs);
+
+  uint64_t committed_instrs() const;
+
+  void show_cache_stats() const;
+
+  void drain();
+
+  SampleCounters sample_counters() const;
+
   void reset();
 
   const Arch& arch_;
   std::vector<std::shared_ptr<Cluster>> clusters_;
+  RAM* ram_;
+  bool functional_;
+  uint64_t sample_fast_forward_;
+  uint64_t sample_window_;
+  uint64_t sample_warmup_;
+  std::string ckpt_file_;
+  uint64_t ckpt_cycle_;
+  std::string restore_file_;
   DCRS dcrs_;
   MemSim::Ptr memsim_;
   CacheSim::Ptr l3cache_;
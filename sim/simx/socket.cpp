@@ -13,6 +13,7 @@
 
 #include "socket.h"
 #include "cluster.h"
+#include <checkpoint.h>
 
 using namespace vortex;
 
@@ -32,39 +33,47 @@ Socket::Socket(const SimContext& ctx,
 
   char sname[100];
   snprintf(sname, 100, "%s-icaches", this->name().c_str());
+  auto& icache = arch.icache();
   icaches_ = CacheCluster::Create(sname, cores_per_socket, NUM_ICACHES, CacheSim::Config{
-    !ICACHE_ENABLED,
-    log2ceil(ICACHE_SIZE),  // C
+    !icache.enabled,
+    (uint8_t)log2ceil(icache.size),  // C
     log2ceil(L1_LINE_SIZE), // L
     log2ceil(sizeof(uint32_t)), // W
-    log2ceil(ICACHE_NUM_WAYS),// A
-    1,                      // B
+    (uint8_t)log2ceil(icache.num_ways),// A
+    (uint8_t)log2ceil(icache.num_banks), // B
     XLEN,                   // address bits
     1,                      // number of ports
     1,                      // number of inputs
     ICACHE_MEM_PORTS,       // memory ports
-    false,                  // write-back
+    icache.write_back,      // write-back
     false,                  // write response
-    (uint8_t)arch.num_warps(), // mshr size
-    2,                      // pipeline latency
+    icache.mshr_size,       // mshr size
+    icache.latency,         // pipeline latency
+    icache.repl_policy,     // replacement policy
+    icache.prefetcher,      // prefetcher
+    icache.prefetch_degree, // prefetch degree
   });
 
   snprintf(sname, 100, "%s-dcaches", this->name().c_str());
+  auto& dcache = arch.dcache();
   dcaches_ = CacheCluster::Create(sname, cores_per_socket, NUM_DCACHES, CacheSim::Config{
-    !DCACHE_ENABLED,
-    log2ceil(DCACHE_SIZE),  // C
+    !dcache.enabled,
+    (uint8_t)log2ceil(dcache.size),  // C
     log2ceil(L1_LINE_SIZE), // L
     log2ceil(DCACHE_WORD_SIZE), // W
-    log2ceil(DCACHE_NUM_WAYS),// A
-    log2ceil(DCACHE_NUM_BANKS), // B
+    (uint8_t)log2ceil(dcache.num_ways),// A
+    (uint8_t)log2ceil(dcache.num_banks), // B
     XLEN,                   // address bits
     1,                      // number of ports
     DCACHE_NUM_REQS,        // number of inputs
     L1_MEM_PORTS,           // memory ports
-    DCACHE_WRITEBACK,       // write-back
+    dcache.write_back,      // write-back
     false,                  // write response
-    DCACHE_MSHR_SIZE,       // mshr size
-    2,                      // pipeline latency
+    dcache.mshr_size,       // mshr size
+    dcache.latency,         // pipeline latency
+    dcache.repl_policy,     // replacement policy
+    dcache.prefetcher,      // prefetcher
+    dcache.prefetch_degree, // prefetch degree
   });
 
   // find overlap
@@ -124,7 +133,8 @@ void Socket::reset() {
 }
 
 void Socket::tick() {
-  //--
+  // nothing to evaluate, caches and cores tick on their own
+  this->sleep();
 }
 
 void Socket::attach_ram(RAM* ram) {
@@ -165,6 +175,35 @@ void Socket::resume(uint32_t core_index) {
   cores_.at(core_index)->resume(-1);
 }
 
+void Socket::warm_icache(uint32_t core_index, uint64_t addr) {
+  bool write = false;
+  if (icaches_->warm(core_index, addr, write)) {
+    cluster_->warm_l2(addr, write);
+  }
+}
+
+void Socket::warm_dcache(uint32_t core_index, uint64_t addr, bool write) {
+  if (dcaches_->warm(core_index, addr, write)) {
+    cluster_->warm_l2(addr, write);
+  }
+}
+
+void Socket::save(CheckpointWriter& ckpt) const {
+  for (auto& core : cores_) {
+    core->save(ckpt);
+  }
+  icaches_->save(ckpt);
+  dcaches_->save(ckpt);
+}
+
+void Socket::restore(CheckpointReader& ckpt) {
+  for (auto& core : cores_) {
+    core->restore(ckpt);
+  }
+  icaches_->restore(ckpt);
+  dcaches_->restore(ckpt);
+}
+
 Socket::PerfStats Socket::perf_stats() const {
   PerfStats perf_stats;
   perf_stats.icache = icaches_->perf_stats();
@@ -51,6 +51,10 @@ public:
     return cluster_;
   }
 
+  const std::vector<Core::Ptr>& cores() const {
+    return cores_;
+  }
+
   void reset();
 
   void tick();
@@ -69,6 +73,14 @@ public:
 
   void resume(uint32_t core_id);
 
+  void warm_icache(uint32_t core_index, uint64_t addr);
+
+  void warm_dcache(uint32_t core_index, uint64_t addr, bool write);
+
+  void save(CheckpointWriter& ckpt) const;
+
+  void restore(CheckpointReader& ckpt);
+
   PerfStats perf_stats() const;
 
 private:
@@ -54,6 +54,8 @@ void LocalMemSwitch::tick() {
     out_dc_req.write = in_req.write;
     out_dc_req.tag   = in_req.tag;
     out_dc_req.cid   = in_req.cid;
+    out_dc_req.wid   = in_req.wid;
+    out_dc_req.pc    = in_req.pc;
     out_dc_req.uuid  = in_req.uuid;
 
     LsuReq out_lmem_req(out_dc_req);
@@ -82,6 +84,11 @@ void LocalMemSwitch::tick() {
     }
     ReqIn.pop();
   }
+
+  // sleep until new requests or responses arrive
+  if (ReqIn.empty() && RspLmem.empty() && RspDC.empty()) {
+    this->sleep();
+  }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -150,6 +157,8 @@ void LsuMemAdapter::tick() {
         out_req.type  = get_addr_type(in_req.addrs.at(i));
         out_req.tag   = in_req.tag;
         out_req.cid   = in_req.cid;
+        out_req.wid   = in_req.wid;
+        out_req.pc    = in_req.pc;
         out_req.uuid  = in_req.uuid;
         // send memory request
         ReqOut.at(i).push(out_req, delay_);
@@ -158,4 +167,13 @@ void LsuMemAdapter::tick() {
     }
     ReqIn.pop();
   }
+
+  // sleep until new requests or responses arrive
+  if (!ReqIn.empty())
+    return;
+  for (auto& rsp_out : RspOut) {
+    if (!rsp_out.empty())
+      return;
+  }
+  this->sleep();
 }
\ No newline at end of file
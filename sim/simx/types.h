@@ -286,7 +286,73 @@ inline std::ostream &operator<<(std::ostream &os, const ArbiterType& type) {
   default: assert(false);
   }
   return os;
-}///////////////////////////////////////////////////////////////////////////////
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+enum class CacheReplPolicy {
+  LRU,
+  PLRU,
+  SRRIP,
+  BRRIP,
+  FIFO,
+  Random
+};
+
+inline std::ostream &operator<<(std::ostream &os, const CacheReplPolicy& policy) {
+  switch (policy) {
+  case CacheReplPolicy::LRU:    os << "lru"; break;
+  case CacheReplPolicy::PLRU:   os << "plru"; break;
+  case CacheReplPolicy::SRRIP:  os << "srrip"; break;
+  case CacheReplPolicy::BRRIP:  os << "brrip"; break;
+  case CacheReplPolicy::FIFO:   os << "fifo"; break;
+  case CacheReplPolicy::Random: os << "random"; break;
+  default: assert(false);
+  }
+  return os;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+enum class CachePrefetcher {
+  None,
+  NextLine,
+  Stride,
+  Stream
+};
+
+inline std::ostream &operator<<(std::ostream &os, const CachePrefetcher& prefetcher) {
+  switch (prefetcher) {
+  case CachePrefetcher::None:     os << "none"; break;
+  case CachePrefetcher::NextLine: os << "nextline"; break;
+  case CachePrefetcher::Stride:   os << "stride"; break;
+  case CachePrefetcher::Stream:   os << "stream"; break;
+  default: assert(false);
+  }
+  return os;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+enum class WarpSchedPolicy {
+  Priority,
+  LRR,
+  GTO,
+  TwoLevel
+};
+
+inline std::ostream &operator<<(std::ostream &os, const WarpSchedPolicy& policy) {
+  switch (policy) {
+  case WarpSchedPolicy::Priority: os << "priority"; break;
+  case WarpSchedPolicy::LRR:      os << "lrr"; break;
+  case WarpSchedPolicy::GTO:      os << "gto"; break;
+  case WarpSchedPolicy::TwoLevel: os << "twolevel"; break;
+  default: assert(false);
+  }
+  return os;
+}
+
+///////////////////////////////////////////////////////////////////////////////
 
 struct LsuReq {
   BitVector<> mask;
@@ -294,6 +360,8 @@ struct LsuReq {
   bool     write;
   uint32_t tag;
   uint32_t cid;
+  uint32_t wid;
+  uint64_t pc;
   uint64_t uuid;
 
   LsuReq(uint32_t size)
@@ -302,6 +370,8 @@ struct LsuReq {
     , write(false)
     , tag(0)
     , cid(0)
+    , wid(0)
+    , pc(0)
     , uuid(0)
   {}
 };
@@ -353,6 +423,8 @@ struct MemReq {
   AddrType type;
   uint32_t tag;
   uint32_t cid;
+  uint32_t wid;   // issuing warp, for prefetch training
+  uint64_t pc;    // issuing instruction, for prefetch training
   uint64_t uuid;
 
   MemReq(uint64_t _addr = 0,
@@ -366,6 +438,8 @@ struct MemReq {
     , type(_type)
     , tag(_tag)
     , cid(_cid)
+    , wid(0)
+    , pc(0)
     , uuid(_uuid)
   {}
 };
@@ -522,8 +596,10 @@ public:
     uint32_t R = 1 << lg2_num_reqs_;
 
     // skip bypass mode
-    if (I == O)
+    if (I == O) {
+      this->sleep();
       return;
+    }
 
     // process inputs
     for (uint32_t o = 0; o < O; ++o) {
@@ -544,6 +620,19 @@ public:
         }
       }
     }
+
+    // sleep until new requests arrive
+    if (this->idle()) {
+      this->sleep();
+    }
+  }
+
+  bool idle() const {
+    for (auto& req_in : Inputs) {
+      if (!req_in.empty())
+        return false;
+    }
+    return true;
   }
 
 protected:
@@ -648,6 +737,19 @@ public:
         collisions_ += has_collision;
       }
     }
+
+    // sleep until new requests arrive
+    if (this->idle()) {
+      this->sleep();
+    }
+  }
+
+  bool idle() const {
+    for (auto& req_in : Inputs) {
+      if (!req_in.empty())
+        return false;
+    }
+    return true;
   }
 
   uint64_t collisions() const {
@@ -729,8 +831,10 @@ public:
     uint32_t R = 1 << lg2_num_reqs_;
 
     // skip bypass mode
-    if (I == O)
+    if (I == O) {
+      this->sleep();
       return;
+    }
 
     // process outgoing responses
     for (uint32_t o = 0; o < O; ++o) {
@@ -771,6 +875,23 @@ public:
         }
       }
     }
+
+    // sleep until new requests or responses arrive
+    if (this->idle()) {
+      this->sleep();
+    }
+  }
+
+  bool idle() const {
+    for (auto& req_in : ReqIn) {
+      if (!req_in.empty())
+        return false;
+    }
+    for (auto& rsp_out : RspOut) {
+      if (!rsp_out.empty())
+        return false;
+    }
+    return true;
   }
 
 protected:
@@ -930,6 +1051,23 @@ public:
         req_collisions_ += has_collision;
       }
     }
+
+    // sleep until new requests or responses arrive
+    if (this->idle()) {
+      this->sleep();
+    }
+  }
+
+  bool idle() const {
+    for (auto& req_in : ReqIn) {
+      if (!req_in.empty())
+        return false;
+    }
+    for (auto& rsp_out : RspOut) {
+      if (!rsp_out.empty())
+        return false;
+    }
+    return true;
   }
 
   uint64_t req_collisions() const {
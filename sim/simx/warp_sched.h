@@ -0,0 +1,157 @@
+// Copyright © 2019-2023
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <bitmanip.h>
+#include <checkpoint.h>
+#include "arch.h"
+
+namespace vortex {
+
+// Picks the warp to issue each cycle among the active, non-stalled ones.
+// The selection works on the warp masks with find-first-set operations,
+// warps are spawned in id order so the lowest id is also the oldest.
+class WarpScheduler {
+public:
+  // cycles a two-level pool warp may stay unready before it gets swapped
+  // out, longer than an icache hit round trip from schedule to decode
+  static constexpr uint32_t POOL_STALL_CYCLES = 16;
+
+  static_assert(MAX_NUM_WARPS <= 32, "invalid size");
+
+  WarpScheduler(const Arch& arch)
+    : policy_(arch.warp_sched())
+    , num_warps_(arch.num_warps())
+    , pool_size_(std::min<uint32_t>(arch.warp_pool_size(), arch.num_warps()))
+    , ready_cycles_(arch.num_warps())
+  {
+    this->clear();
+  }
+
+  void clear() {
+    last_wid_ = num_warps_ - 1;
+    pool_ = 0;
+    promote_wid_ = 0;
+    std::fill(ready_cycles_.begin(), ready_cycles_.end(), 0);
+  }
+
+  // returns the warp to issue, -1 if none is ready
+  int select(const WarpMask& active_warps, const WarpMask& stalled_warps, uint64_t cycle) {
+    uint32_t active = active_warps.to_ulong();
+    uint32_t ready = active & ~uint32_t(stalled_warps.to_ulong());
+
+    uint32_t wid;
+    switch (policy_) {
+    case WarpSchedPolicy::Priority:
+      if (ready == 0)
+        return -1;
+      wid = count_trailing_zeros(ready);
+      break;
+    case WarpSchedPolicy::LRR:
+      if (ready == 0)
+        return -1;
+      wid = find_next(ready, this->next_wid(last_wid_));
+      break;
+    case WarpSchedPolicy::GTO:
+      if (ready == 0)
+        return -1;
+      // keep the last warp until it stalls, then fall back to the oldest
+      wid = ((ready >> last_wid_) & 1) ? last_wid_ : count_trailing_zeros(ready);
+      break;
+    case WarpSchedPolicy::TwoLevel: {
+      uint32_t pool_ready = this->update_pool(active, ready, cycle);
+      if (pool_ready == 0)
+        return -1;
+      wid = find_next(pool_ready, this->next_wid(last_wid_));
+    } break;
+    default:
+      std::abort();
+    }
+
+    last_wid_ = wid;
+    return wid;
+  }
+
+  void save(CheckpointWriter& ckpt) const {
+    ckpt.write<uint32_t>(last_wid_);
+    ckpt.write<uint32_t>(pool_);
+    ckpt.write<uint32_t>(promote_wid_);
+  }
+
+  void restore(CheckpointReader& ckpt) {
+    last_wid_ = ckpt.read<uint32_t>();
+    pool_ = ckpt.read<uint32_t>();
+    promote_wid_ = ckpt.read<uint32_t>();
+    // the simulation clock restarts, pool warps wait from the next cycle
+    std::fill(ready_cycles_.begin(), ready_cycles_.end(), uint64_t(-1));
+  }
+
+private:
+
+  uint32_t next_wid(uint32_t wid) const {
+    return (wid + 1 == num_warps_) ? 0 : (wid + 1);
+  }
+
+  // first set bit at or after wid, wrapping around
+  static uint32_t find_next(uint32_t mask, uint32_t wid) {
+    uint32_t upper = mask & ~((1u << wid) - 1);
+    return count_trailing_zeros(upper ? upper : mask);
+  }
+
+  // two-level scheduling: only a small pool of warps competes for issue,
+  // pool warps stalled for long are swapped out for ready warps outside it.
+  // returns the ready warps of the pool.
+  uint32_t update_pool(uint32_t active, uint32_t ready, uint64_t cycle) {
+    // retired warps leave the pool right away
+    pool_ &= active;
+
+    uint32_t long_stalled = 0;
+    for (uint32_t mask = pool_; mask != 0; mask &= mask - 1) {
+      uint32_t wid = count_trailing_zeros(mask);
+      if (((ready >> wid) & 1) || ready_cycles_[wid] > cycle) {
+        ready_cycles_[wid] = cycle;
+      } else if (cycle - ready_cycles_[wid] >= POOL_STALL_CYCLES) {
+        long_stalled |= (1u << wid);
+      }
+    }
+
+    uint32_t pending = ready & ~pool_;
+    while (pending != 0) {
+      if (uint32_t(__builtin_popcount(pool_)) == pool_size_) {
+        if (long_stalled == 0)
+          break;
+        uint32_t victim = count_trailing_zeros(long_stalled);
+        long_stalled &= long_stalled - 1;
+        pool_ &= ~(1u << victim);
+      }
+      uint32_t wid = find_next(pending, promote_wid_);
+      promote_wid_ = this->next_wid(wid);
+      pending &= ~(1u << wid);
+      pool_ |= (1u << wid);
+      ready_cycles_[wid] = cycle;
+    }
+
+    return ready & pool_;
+  }
+
+  WarpSchedPolicy policy_;
+  uint32_t num_warps_;
+  uint32_t pool_size_;
+  uint32_t last_wid_;
+  uint32_t pool_;
+  uint32_t promote_wid_;
+  std::vector<uint64_t> ready_cycles_; // last cycle each pool warp was ready
+};
+
+}
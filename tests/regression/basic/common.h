@@ -5,6 +5,8 @@ typedef struct {
   uint32_t count;
   uint64_t src_addr;
   uint64_t dst_addr;  
+  uint32_t fdiv;  // divide the source floats by 3 instead of copying them
+  uint32_t frm;   // rounding mode of the division
 } kernel_arg_t;
 
 #endif
\ No newline at end of file
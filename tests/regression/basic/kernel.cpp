@@ -9,6 +9,17 @@ int main() {
 
 	uint32_t offset  = vx_core_id() * count;
 
+	if (arg->fdiv) {
+		// the division uses the dynamic rounding mode
+		csr_write(VX_CSR_FRM, arg->frm);
+		float* fsrc_ptr = (float*)arg->src_addr;
+		float* fdst_ptr = (float*)arg->dst_addr;
+		for (uint32_t i = 0; i < count; ++i) {
+			fdst_ptr[offset + i] = fsrc_ptr[offset + i] / 3.0f;
+		}
+		return 0;
+	}
+
 	for (uint32_t i = 0; i < count; ++i) {
 		dst_ptr[offset + i] = src_ptr[offset + i];
 	}
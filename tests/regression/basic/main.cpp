@@ -4,6 +4,8 @@
 #include <vortex.h>
 #include <chrono>
 #include <vector>
+#include <thread>
+#include <cfenv>
 #include "common.h"
 
 #define NONCE  0xdeadbeef
@@ -33,7 +35,7 @@ kernel_arg_t kernel_arg = {};
 
 static void show_usage() {
    std::cout << "Vortex Test." << std::endl;
-   std::cout << "Usage: [-t testno][-k: kernel][-n words][-h: help]" << std::endl;
+   std::cout << "Usage: [-t testno (0: memcopy, 1: kernel, 2: bandwidth, 3: queue, 4: mapped, 5: multi-device, 6: multi-device fp)][-k: kernel][-n words][-h: help]" << std::endl;
 }
 
 static void parse_args(int argc, char **argv) {
@@ -74,6 +76,17 @@ inline uint32_t shuffle(int i, uint32_t value) {
   return (value << i) | (value & ((1 << i)-1));;
 }
 
+// host reference of the kernel division in a RISC-V rounding mode
+static float fdiv3(float value, uint32_t frm) {
+  static const int modes[] = {FE_TONEAREST, FE_TOWARDZERO, FE_DOWNWARD, FE_UPWARD};
+  fesetround(modes[frm]);
+  // volatile keeps the division between the rounding mode changes
+  volatile float x = value;
+  volatile float result = x / 3.0f;
+  fesetround(FE_TONEAREST);
+  return result;
+}
+
 int run_memcopy_test(const kernel_arg_t& kernel_arg) {
   uint32_t num_points = kernel_arg.count;
   uint32_t buf_size = num_points * sizeof(int32_t);
@@ -125,6 +138,78 @@ int run_memcopy_test(const kernel_arg_t& kernel_arg) {
   return errors;
 }
 
+static int bandwidth_sweep(vx_buffer_h buffer, const uint8_t* h_src, uint8_t* h_dst, uint32_t buf_size) {
+  // sweep transfer sizes, repeating small ones to get a stable measurement
+  printf("%12s %16s %16s\n", "size", "upload (MB/s)", "download (MB/s)");
+  uint32_t last_size = 0;
+  for (uint32_t size = std::min<uint32_t>(4096, buf_size); size <= buf_size; size *= 2) {
+    uint32_t iterations = std::max<uint32_t>(1, (64 << 20) / size);
+
+    auto t0 = std::chrono::high_resolution_clock::now();
+    for (uint32_t i = 0; i < iterations; ++i) {
+      RT_CHECK(vx_copy_to_dev(buffer, h_src, 0, size));
+    }
+    auto t1 = std::chrono::high_resolution_clock::now();
+    for (uint32_t i = 0; i < iterations; ++i) {
+      RT_CHECK(vx_copy_from_dev(h_dst, buffer, 0, size));
+    }
+    auto t2 = std::chrono::high_resolution_clock::now();
+
+    double bytes = double(size) * iterations;
+    double upload = bytes / std::chrono::duration<double>(t1 - t0).count() / 1e6;
+    double download = bytes / std::chrono::duration<double>(t2 - t1).count() / 1e6;
+    printf("%12u %16.1f %16.1f\n", size, upload, download);
+    last_size = size;
+
+    if (size > buf_size / 2)
+      break;
+  }
+
+  // verify the last transfer
+  int errors = 0;
+  std::cout << "verify result" << std::endl;
+  for (uint32_t i = 0; i < last_size; ++i) {
+    if (h_dst[i] != h_src[i]) {
+      printf("*** error: [%d] expected=%d, actual=%d\n", i, h_src[i], h_dst[i]);
+      ++errors;
+      break;
+    }
+  }
+
+  return errors;
+}
+
+int run_bandwidth_test(uint32_t buf_size) {
+  std::vector<uint8_t> h_src(buf_size);
+  std::vector<uint8_t> h_dst(buf_size);
+
+  for (uint32_t i = 0; i < buf_size; ++i) {
+    h_src[i] = (uint8_t)shuffle(i % 24, NONCE);
+  }
+
+  std::cout << "staged transfers" << std::endl;
+  int errors = bandwidth_sweep(dst_buffer, h_src.data(), h_dst.data(), buf_size);
+
+  // pinned buffers transfer directly from page-aligned host memory
+  uint32_t page_size = sysconf(_SC_PAGESIZE);
+  uint32_t pin_size = (buf_size + page_size - 1) & ~(page_size - 1);
+  auto p_src = (uint8_t*)aligned_alloc(page_size, pin_size);
+  auto p_dst = (uint8_t*)aligned_alloc(page_size, pin_size);
+  memcpy(p_src, h_src.data(), buf_size);
+
+  vx_buffer_h pin_buffer = nullptr;
+  RT_CHECK(vx_mem_alloc(device, pin_size, VX_MEM_READ_WRITE | VX_MEM_PIN_MEMORY, &pin_buffer));
+
+  std::cout << "pinned transfers" << std::endl;
+  errors += bandwidth_sweep(pin_buffer, p_src, p_dst, pin_size);
+
+  vx_mem_free(pin_buffer);
+  free(p_src);
+  free(p_dst);
+
+  return errors;
+}
+
 int run_kernel_test(const kernel_arg_t& kernel_arg) {
   uint32_t num_points = kernel_arg.count;
   uint32_t buf_size = num_points * sizeof(int32_t);
@@ -192,6 +277,288 @@ int run_kernel_test(const kernel_arg_t& kernel_arg) {
   return errors;
 }
 
+int run_queue_test(const kernel_arg_t& kernel_arg, uint32_t num_batches) {
+  uint32_t num_points = kernel_arg.count;
+  uint32_t buf_size = num_points * sizeof(int32_t);
+
+  std::vector<std::vector<uint32_t>> h_src(num_batches, std::vector<uint32_t>(num_points));
+  std::vector<std::vector<uint32_t>> h_dst(num_batches, std::vector<uint32_t>(num_points));
+
+  // upload program
+  std::cout << "upload program" << std::endl;
+  RT_CHECK(vx_upload_kernel_file(device, kernel_file, &krnl_buffer));
+
+  // upload kernel argument
+  std::cout << "upload kernel argument" << std::endl;
+  RT_CHECK(vx_upload_bytes(device, &kernel_arg, sizeof(kernel_arg_t), &args_buffer));
+
+  // uploads go through their own queue so that the host can prepare and
+  // submit the next batch while the current one executes
+  vx_queue_h copy_queue, exec_queue;
+  RT_CHECK(vx_queue_create(device, &copy_queue));
+  RT_CHECK(vx_queue_create(device, &exec_queue));
+
+  auto time_start = std::chrono::high_resolution_clock::now();
+
+  std::cout << "submit " << num_batches << " batches" << std::endl;
+  vx_event_h run_event = nullptr;
+  for (uint32_t b = 0; b < num_batches; ++b) {
+    for (uint32_t i = 0; i < num_points; ++i) {
+      h_src[b][i] = shuffle(i, NONCE ^ b);
+    }
+
+    // the source buffer is reused once the previous kernel is done with it
+    if (run_event) {
+      RT_CHECK(vx_queue_wait_event(copy_queue, run_event));
+      RT_CHECK(vx_event_release(run_event));
+    }
+    vx_event_h upload_event;
+    RT_CHECK(vx_enqueue_copy_to_dev(copy_queue, src_buffer, h_src[b].data(), 0, buf_size, &upload_event));
+
+    RT_CHECK(vx_queue_wait_event(exec_queue, upload_event));
+    RT_CHECK(vx_event_release(upload_event));
+    RT_CHECK(vx_enqueue_start(exec_queue, krnl_buffer, args_buffer, &run_event));
+    RT_CHECK(vx_enqueue_copy_from_dev(exec_queue, h_dst[b].data(), dst_buffer, 0, buf_size, nullptr));
+  }
+  auto time_submit = std::chrono::high_resolution_clock::now();
+
+  std::cout << "wait for completion" << std::endl;
+  RT_CHECK(vx_event_wait(run_event, VX_MAX_TIMEOUT));
+  RT_CHECK(vx_event_release(run_event));
+  RT_CHECK(vx_queue_finish(exec_queue, VX_MAX_TIMEOUT));
+
+  auto time_end = std::chrono::high_resolution_clock::now();
+
+  int errors = 0;
+
+  // an upload queued while a kernel runs completes before the kernel does
+  std::cout << "check upload overlap" << std::endl;
+  vx_buffer_h staging_buffer;
+  RT_CHECK(vx_mem_alloc(device, buf_size, VX_MEM_READ, &staging_buffer));
+  RT_CHECK(vx_enqueue_start(exec_queue, krnl_buffer, args_buffer, &run_event));
+  while (vx_ready_wait(device, 0) == 0 && vx_event_wait(run_event, 0) != 0) {
+    std::this_thread::yield(); // wait for the kernel to start
+  }
+  bool running = (vx_event_wait(run_event, 0) != 0);
+  vx_event_h upload_event;
+  RT_CHECK(vx_enqueue_copy_to_dev(copy_queue, staging_buffer, h_src[0].data(), 0, buf_size, &upload_event));
+  RT_CHECK(vx_event_wait(upload_event, VX_MAX_TIMEOUT));
+  RT_CHECK(vx_event_release(upload_event));
+  if (!running) {
+    std::cout << "kernel completed before the upload, overlap not checked" << std::endl;
+  } else if (vx_event_wait(run_event, 0) == 0) {
+    printf("*** error: the upload waited for the running kernel\n");
+    ++errors;
+  }
+  RT_CHECK(vx_event_wait(run_event, VX_MAX_TIMEOUT));
+  RT_CHECK(vx_event_release(run_event));
+  RT_CHECK(vx_mem_free(staging_buffer));
+  RT_CHECK(vx_queue_destroy(copy_queue));
+  RT_CHECK(vx_queue_destroy(exec_queue));
+
+  // verify result
+  std::cout << "verify result" << std::endl;
+  for (uint32_t b = 0; b < num_batches; ++b) {
+    for (uint32_t i = 0; i < num_points; ++i) {
+      auto cur = h_dst[b][i];
+      auto ref = shuffle(i, NONCE ^ b);
+      if (cur != ref) {
+        printf("*** error: batch %d: [%d] expected=%d, actual=%d\n", b, i, ref, cur);
+        ++errors;
+        break;
+      }
+    }
+  }
+
+  double elapsed;
+  elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(time_submit - time_start).count();
+  printf("submit time: %lg ms\n", elapsed);
+  elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(time_end - time_start).count();
+  printf("Total elapsed time: %lg ms\n", elapsed);
+
+  return errors;
+}
+
+int run_mapped_test(const kernel_arg_t& kernel_arg) {
+  uint32_t num_points = kernel_arg.count;
+  uint32_t buf_size = num_points * sizeof(int32_t);
+
+  // pinned buffers are accessed in place through their host mapping
+  vx_buffer_h pin_src_buffer = nullptr;
+  vx_buffer_h pin_dst_buffer = nullptr;
+  RT_CHECK(vx_mem_alloc(device, buf_size, VX_MEM_READ | VX_MEM_PIN_MEMORY, &pin_src_buffer));
+  RT_CHECK(vx_mem_alloc(device, buf_size, VX_MEM_WRITE | VX_MEM_PIN_MEMORY, &pin_dst_buffer));
+
+  kernel_arg_t pin_kernel_arg = kernel_arg;
+  RT_CHECK(vx_mem_address(pin_src_buffer, &pin_kernel_arg.src_addr));
+  RT_CHECK(vx_mem_address(pin_dst_buffer, &pin_kernel_arg.dst_addr));
+
+  // upload program
+  std::cout << "upload program" << std::endl;
+  RT_CHECK(vx_upload_kernel_file(device, kernel_file, &krnl_buffer));
+
+  // upload kernel argument
+  std::cout << "upload kernel argument" << std::endl;
+  RT_CHECK(vx_upload_bytes(device, &pin_kernel_arg, sizeof(kernel_arg_t), &args_buffer));
+
+  auto time_start = std::chrono::high_resolution_clock::now();
+
+  // fill source buffer in place
+  std::cout << "write source buffer through its mapping" << std::endl;
+  uint32_t* h_src;
+  RT_CHECK(vx_mem_map(pin_src_buffer, (void**)&h_src));
+  for (uint32_t i = 0; i < num_points; ++i) {
+    h_src[i] = shuffle(i, NONCE);
+  }
+  RT_CHECK(vx_mem_unmap(pin_src_buffer));
+
+  // start device
+  std::cout << "start execution" << std::endl;
+  RT_CHECK(vx_start(device, krnl_buffer, args_buffer));
+  RT_CHECK(vx_ready_wait(device, VX_MAX_TIMEOUT));
+
+  // verify result in place
+  int errors = 0;
+  std::cout << "verify result" << std::endl;
+  uint32_t* h_dst;
+  RT_CHECK(vx_mem_map(pin_dst_buffer, (void**)&h_dst));
+  for (uint32_t i = 0; i < num_points; ++i) {
+    auto cur = h_dst[i];
+    auto ref = shuffle(i, NONCE);
+    if (cur != ref) {
+      printf("*** error: [%d] expected=%d, actual=%d\n", i, ref, cur);
+      ++errors;
+    }
+  }
+  RT_CHECK(vx_mem_unmap(pin_dst_buffer));
+
+  auto time_end = std::chrono::high_resolution_clock::now();
+
+  double elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(time_end - time_start).count();
+  printf("Total elapsed time: %lg ms\n", elapsed);
+
+  vx_mem_free(pin_src_buffer);
+  vx_mem_free(pin_dst_buffer);
+
+  return errors;
+}
+
+// runs the copy kernel on a single device, the device is private to the calling thread.
+// with fdiv set, the kernel divides floats in a rounding mode that differs
+// between neighbouring devices, a floating-point state shared by the devices
+// shows up as misrounded results
+static int run_device_kernel(uint32_t index, uint32_t count, bool fdiv) {
+  #define DEV_CHECK(_expr)                                                   \
+    do {                                                                     \
+      int _ret = _expr;                                                      \
+      if (0 == _ret)                                                         \
+        break;                                                               \
+      printf("Error: device %d: '%s' returned %d!\n", index, #_expr, _ret); \
+      errors = 1;                                                            \
+      goto cleanup;                                                          \
+    } while (false)
+
+  int errors = 0;
+  vx_device_h hdevice = nullptr;
+  vx_buffer_h hsrc = nullptr;
+  vx_buffer_h hdst = nullptr;
+  vx_buffer_h hkernel = nullptr;
+  vx_buffer_h hargs = nullptr;
+  kernel_arg_t arg = {};
+  uint64_t num_cores = 0;
+  uint32_t num_points = 0;
+  uint32_t buf_size = 0;
+  std::vector<uint32_t> h_src;
+  std::vector<uint32_t> h_dst;
+
+  DEV_CHECK(vx_dev_open_index(index, &hdevice));
+  DEV_CHECK(vx_dev_caps(hdevice, VX_CAPS_NUM_CORES, &num_cores));
+
+  num_points = count * num_cores;
+  buf_size = num_points * sizeof(int32_t);
+  h_src.resize(num_points);
+  h_dst.resize(num_points);
+  for (uint32_t i = 0; i < num_points; ++i) {
+    // each device gets its own data
+    h_src[i] = shuffle(i, NONCE + index);
+  }
+
+  DEV_CHECK(vx_mem_alloc(hdevice, buf_size, VX_MEM_READ, &hsrc));
+  DEV_CHECK(vx_mem_address(hsrc, &arg.src_addr));
+  DEV_CHECK(vx_mem_alloc(hdevice, buf_size, VX_MEM_WRITE, &hdst));
+  DEV_CHECK(vx_mem_address(hdst, &arg.dst_addr));
+  arg.count = count;
+  arg.fdiv = fdiv;
+  arg.frm = (index & 1) ? 3 : 2; // round up or down
+  if (fdiv) {
+    for (uint32_t i = 0; i < num_points; ++i) {
+      float value = float(i + index + 1);
+      memcpy(&h_src[i], &value, sizeof(float));
+    }
+  }
+
+  DEV_CHECK(vx_upload_kernel_file(hdevice, kernel_file, &hkernel));
+  DEV_CHECK(vx_upload_bytes(hdevice, &arg, sizeof(kernel_arg_t), &hargs));
+  DEV_CHECK(vx_copy_to_dev(hsrc, h_src.data(), 0, buf_size));
+  DEV_CHECK(vx_start(hdevice, hkernel, hargs));
+  DEV_CHECK(vx_ready_wait(hdevice, VX_MAX_TIMEOUT));
+  DEV_CHECK(vx_copy_from_dev(h_dst.data(), hdst, 0, buf_size));
+
+  for (uint32_t i = 0; i < num_points; ++i) {
+    auto cur = h_dst[i];
+    auto ref = h_src[i];
+    if (fdiv) {
+      float value;
+      memcpy(&value, &h_src[i], sizeof(float));
+      float result = fdiv3(value, arg.frm);
+      memcpy(&ref, &result, sizeof(float));
+    }
+    if (cur != ref) {
+      printf("*** error: device %d: [%d] expected=0x%x, actual=0x%x\n", index, i, ref, cur);
+      ++errors;
+    }
+  }
+
+cleanup:
+  vx_mem_free(hsrc);
+  vx_mem_free(hdst);
+  vx_mem_free(hkernel);
+  vx_mem_free(hargs);
+  vx_dev_close(hdevice);
+  return errors;
+
+  #undef DEV_CHECK
+}
+
+int run_multi_device_test(uint32_t count, bool fdiv) {
+  uint32_t num_devices;
+  RT_CHECK(vx_dev_count(&num_devices));
+  std::cout << "number of devices: " << num_devices << std::endl;
+
+  auto time_start = std::chrono::high_resolution_clock::now();
+
+  std::vector<int> errors(num_devices, 0);
+  std::vector<std::thread> threads;
+  for (uint32_t i = 0; i < num_devices; ++i) {
+    threads.emplace_back([&errors, i, count, fdiv]() {
+      errors[i] = run_device_kernel(i, count, fdiv);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  auto time_end = std::chrono::high_resolution_clock::now();
+  double elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(time_end - time_start).count();
+  printf("Total elapsed time: %lg ms\n", elapsed);
+
+  int total_errors = 0;
+  for (auto err : errors) {
+    total_errors += err;
+  }
+  return total_errors;
+}
+
 int main(int argc, char *argv[]) {
   // parse command arguments
   parse_args(argc, argv);
@@ -238,6 +605,31 @@ int main(int argc, char *argv[]) {
     errors = run_kernel_test(kernel_arg);
   }
 
+  if (2 == test) {
+    std::cout << "run bandwidth test" << std::endl;
+    errors = run_bandwidth_test(buf_size);
+  }
+
+  if (3 == test) {
+    std::cout << "run queue test" << std::endl;
+    errors = run_queue_test(kernel_arg, 8);
+  }
+
+  if (4 == test) {
+    std::cout << "run mapped test" << std::endl;
+    errors = run_mapped_test(kernel_arg);
+  }
+
+  if (5 == test) {
+    std::cout << "run multi-device test" << std::endl;
+    errors = run_multi_device_test(count, false);
+  }
+
+  if (6 == test) {
+    std::cout << "run multi-device fp test" << std::endl;
+    errors = run_multi_device_test(count, true);
+  }
+
   // cleanup
   std::cout << "cleanup" << std::endl;
   cleanup();
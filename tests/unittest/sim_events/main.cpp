@@ -0,0 +1,245 @@
+#include <simobject.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include <chrono>
+#include <vector>
+
+// Event scheduler microbenchmark.
+// A single object keeps a constant number of packets in flight through its
+// own port, re-sending every arriving packet with a pseudo-random delay.
+// Reports simulated cycles per second for increasing event queue depths and
+// checks that same-cycle events fire in the order they were scheduled.
+// A second pass ticks several loops as partitions on worker threads, always
+// and adaptively, and checks that they produce the same event history as a
+// serial run.
+// A last pass lets a sparse loop sleep between packets and checks that
+// skipping idle cycles preserves the event history.
+// The event pool is finally checked to stop doubling its slabs.
+
+struct packet_t {
+  uint64_t seq;
+};
+
+class EventLoop : public SimObject<EventLoop> {
+public:
+  SimPort<packet_t> Port;
+
+  EventLoop(const SimContext& ctx, uint32_t depth, uint32_t max_delay, bool sleepy = false)
+    : SimObject<EventLoop>(ctx, "event_loop")
+    , Port(this)
+    , depth_(depth)
+    , max_delay_(max_delay)
+    , sleepy_(sleepy)
+  {}
+
+  void reset() {
+    seq_ = 0;
+    rand_ = 1;
+    last_cycle_ = 0;
+    last_seq_ = 0;
+    errors_ = 0;
+    fired_ = 0;
+    checksum_ = 0;
+    for (uint32_t i = 0; i < depth_; ++i) {
+      this->send();
+    }
+  }
+
+  void tick() {
+    auto cycle = SimPlatform::instance().cycles();
+    while (!Port.empty()) {
+      auto& pkt = Port.front();
+      if (cycle == last_cycle_ && pkt.seq < last_seq_) {
+        ++errors_;
+      }
+      last_cycle_ = cycle;
+      last_seq_ = pkt.seq;
+      checksum_ = (checksum_ * 31) + (cycle ^ pkt.seq);
+      Port.pop();
+      ++fired_;
+      this->send();
+    }
+    if (sleepy_) {
+      // woken up by the next packet delivery
+      this->sleep();
+    }
+  }
+
+  uint64_t errors() const {
+    return errors_;
+  }
+
+  uint64_t fired() const {
+    return fired_;
+  }
+
+  uint64_t checksum() const {
+    return checksum_;
+  }
+
+private:
+
+  void send() {
+    // xorshift keeps the delay sequence deterministic
+    rand_ ^= rand_ << 13;
+    rand_ ^= rand_ >> 7;
+    rand_ ^= rand_ << 17;
+    uint64_t delay = 1 + (rand_ % max_delay_);
+    Port.push(packet_t{seq_++}, delay);
+  }
+
+  uint32_t depth_;
+  uint32_t max_delay_;
+  bool     sleepy_;
+  uint64_t seq_;
+  uint64_t rand_;
+  uint64_t last_cycle_;
+  uint64_t last_seq_;
+  uint64_t errors_;
+  uint64_t fired_;
+  uint64_t checksum_;
+};
+
+static int run_test(uint32_t depth, uint32_t max_delay, uint64_t num_cycles) {
+  auto loop = EventLoop::Create(depth, max_delay);
+
+  SimPlatform::instance().reset();
+
+  auto start = std::chrono::high_resolution_clock::now();
+  for (uint64_t i = 0; i < num_cycles; ++i) {
+    SimPlatform::instance().tick();
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+
+  double elapsed = std::chrono::duration<double>(end - start).count();
+  printf("depth=%6u, max_delay=%4u: %10.0f cycles/sec, %10.0f events/sec\n",
+         depth, max_delay, num_cycles / elapsed, loop->fired() / elapsed);
+
+  int errors = loop->errors();
+  SimPlatform::instance().release_object(loop);
+  if (errors != 0) {
+    printf("Error: %d events fired out of order!\n", errors);
+    return -1;
+  }
+  return 0;
+}
+
+static uint64_t run_partitions(uint32_t num_partitions, uint32_t num_threads, bool adaptive, uint64_t num_cycles) {
+  std::vector<EventLoop::Ptr> loops;
+  for (uint32_t i = 0; i < num_partitions; ++i) {
+    SimPlatform::instance().begin_partition();
+    loops.push_back(EventLoop::Create(256 + i, 64));
+    SimPlatform::instance().end_partition();
+  }
+
+  SimPlatform::instance().set_num_threads(num_threads);
+  SimPlatform::instance().set_adaptive_threads(adaptive);
+  SimPlatform::instance().reset();
+
+  auto start = std::chrono::high_resolution_clock::now();
+  for (uint64_t i = 0; i < num_cycles; ++i) {
+    SimPlatform::instance().tick();
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+
+  double elapsed = std::chrono::duration<double>(end - start).count();
+  printf("partitions=%u, threads=%u%s: %10.0f cycles/sec\n",
+         num_partitions, num_threads, adaptive ? " (adaptive)" : "", num_cycles / elapsed);
+
+  uint64_t checksum = 0;
+  for (auto& loop : loops) {
+    checksum = (checksum * 131) + loop->checksum();
+    SimPlatform::instance().release_object(loop);
+  }
+  SimPlatform::instance().set_num_threads(1);
+  SimPlatform::instance().set_adaptive_threads(true);
+  return checksum;
+}
+
+static int run_sleep(uint32_t depth, uint32_t max_delay, uint64_t num_events) {
+  uint64_t checksums[2], cycles[2];
+  auto skipped = SimPlatform::instance().perf_stats().skipped_cycles;
+  for (int sleepy = 0; sleepy < 2; ++sleepy) {
+    auto loop = EventLoop::Create(depth, max_delay, sleepy != 0);
+    SimPlatform::instance().reset();
+    while (loop->fired() < num_events) {
+      SimPlatform::instance().tick();
+    }
+    checksums[sleepy] = loop->checksum();
+    cycles[sleepy] = SimPlatform::instance().cycles();
+    SimPlatform::instance().release_object(loop);
+  }
+  skipped = SimPlatform::instance().perf_stats().skipped_cycles - skipped;
+  printf("depth=%6u, max_delay=%4u: %" PRIu64 " cycles, %" PRIu64 " cycles skipped\n",
+         depth, max_delay, cycles[1], skipped);
+  if (checksums[0] != checksums[1] || cycles[0] != cycles[1]) {
+    printf("Error: sleeping run diverged from awake run!\n");
+    return -1;
+  }
+  if (skipped == 0) {
+    printf("Error: no idle cycles were skipped!\n");
+    return -1;
+  }
+  return 0;
+}
+
+static int run_pool(uint32_t num_objects) {
+  MemoryPoolStats stats = {0, 0, 0};
+  MemoryPool<uint64_t> pool(64, &stats);
+  std::vector<void*> objects(num_objects);
+  for (auto& object : objects) {
+    object = pool.allocate();
+  }
+  for (auto object : objects) {
+    pool.deallocate(object);
+  }
+  uint64_t capacity = stats.bytes / sizeof(uint64_t);
+  printf("pool objects=%u: %" PRIu64 " slabs, capacity=%" PRIu64 "\n", num_objects, stats.slabs, capacity);
+  // once capped, the pool overshoots its peak by less than a slab
+  if (capacity >= uint64_t(num_objects) + MemoryPool<uint64_t>::MAX_SLAB_SIZE) {
+    printf("Error: pool slabs grew past their maximum size!\n");
+    return -1;
+  }
+  return 0;
+}
+
+int main() {
+  SimPlatform::instance().initialize();
+
+  for (uint32_t depth = 16; depth <= 16384; depth *= 4) {
+    // short delays stay in the wheel, long ones exercise the overflow queue
+    if (run_test(depth, 64, 200000) != 0)
+      return -1;
+    if (run_test(depth, 1024, 200000) != 0)
+      return -1;
+  }
+
+  // always parallel, then switching between serial and parallel ticking
+  auto serial = run_partitions(4, 1, false, 200000);
+  for (uint32_t num_threads = 2; num_threads <= 4; ++num_threads) {
+    if (run_partitions(4, num_threads, false, 200000) != serial
+     || run_partitions(4, num_threads, true, 200000) != serial) {
+      printf("Error: parallel run diverged from serial run!\n");
+      return -1;
+    }
+  }
+
+  // sparse traffic, in the wheel and in the overflow queue
+  if (run_sleep(4, 64, 20000) != 0)
+    return -1;
+  if (run_sleep(4, 4096, 2000) != 0)
+    return -1;
+
+  if (run_pool(600000) != 0)
+    return -1;
+
+  auto perf = SimPlatform::instance().perf_stats();
+  printf("events=%" PRIu64 ", peak events=%" PRIu64 ", pool allocs=%" PRIu64 ", pool slabs=%" PRIu64 ", pool bytes=%" PRIu64 "\n",
+         perf.events, perf.peak_events, perf.pool_allocs, perf.pool_slabs, perf.pool_bytes);
+
+  SimPlatform::instance().finalize();
+
+  printf("PASSED!\n");
+
+  return 0;
+}
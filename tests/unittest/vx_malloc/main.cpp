@@ -1,5 +1,9 @@
 #include <mem_alloc.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <map>
+#include <vector>
 
 #define RT_CHECK(_expr)                                         \
    do {                                                         \
@@ -10,13 +14,22 @@
      return -1;                                                 \
    } while (false)
 
+#define RT_ASSERT(_cond)                                        \
+   do {                                                         \
+     if (_cond)                                                 \
+       break;                                                   \
+     printf("Error: assertion '%s' failed!\n", #_cond);         \
+     return -1;                                                 \
+   } while (false)
+
 static uint64_t minAddress = 0;
 static uint64_t maxAddress = 0xffffffff;
 static uint32_t pageAlign  = 4096;
 static uint32_t blockAlign = 64;
 
-int main() {
+static uint32_t benchAllocs = 50000;
 
+static int test_basic() {
     auto allocator = new vortex::MemoryAllocator(
         minAddress, maxAddress, pageAlign, blockAlign
     );
@@ -44,9 +57,223 @@ int main() {
     RT_CHECK(allocator->release(a2));
     RT_CHECK(allocator->release(a3));
 
+    RT_ASSERT(allocator->allocated() == 0);
+
+    delete allocator;
+
+    return 0;
+}
+
+static int test_reserve() {
+    auto allocator = new vortex::MemoryAllocator(
+        minAddress, maxAddress, pageAlign, blockAlign
+    );
+
+    uint64_t a0, a1;
+
+    // reserved ranges are skipped by allocations
+    RT_CHECK(allocator->reserve(0, 4096));
+    RT_CHECK(allocator->allocate(64, &a0));
+    RT_ASSERT(a0 >= 4096);
+
+    // overlapping reservations are rejected
+    RT_ASSERT(allocator->reserve(a0, 64) != 0);
+
+    // a released reservation returns to the address space
+    RT_CHECK(allocator->release(0));
+    RT_CHECK(allocator->allocate(4096, &a1));
+    RT_ASSERT(a1 == 0);
+
+    // unknown addresses are rejected
+    RT_ASSERT(allocator->release(a1 + 64) != 0);
+
+    RT_CHECK(allocator->release(a0));
+    RT_CHECK(allocator->release(a1));
+    RT_ASSERT(allocator->allocated() == 0);
+
+    delete allocator;
+
+    return 0;
+}
+
+static int test_placement() {
+    auto allocator = new vortex::MemoryAllocator(
+        minAddress, maxAddress, pageAlign, blockAlign
+    );
+
+    uint64_t a0, a1, a2, a3, a4;
+
+    // pages grow upward from the base address
+    RT_CHECK(allocator->allocate(8192, &a0));
+    RT_CHECK(allocator->allocate(4096, &a1));
+    RT_CHECK(allocator->allocate(4096, &a2));
+    RT_CHECK(allocator->allocate(4096, &a3));
+    RT_ASSERT(a0 == minAddress);
+    RT_ASSERT(a1 == a0 + 8192 && a2 == a1 + 4096 && a3 == a2 + 4096);
+
+    // the lowest unused range that fits is picked, not the smallest one
+    RT_CHECK(allocator->release(a0));
+    RT_CHECK(allocator->release(a2));
+    RT_CHECK(allocator->allocate(4096, &a4));
+    RT_ASSERT(a4 == a0);
+
+    RT_CHECK(allocator->release(a1));
+    RT_CHECK(allocator->release(a3));
+    RT_CHECK(allocator->release(a4));
+    RT_ASSERT(allocator->allocated() == 0);
+
+    delete allocator;
+
+    return 0;
+}
+
+static int test_random() {
+    auto allocator = new vortex::MemoryAllocator(
+        minAddress, maxAddress, pageAlign, blockAlign
+    );
+
+    struct buffer_t {
+        uint64_t addr;
+        uint64_t size;
+    };
+    std::vector<buffer_t> buffers;
+
+    srand(0);
+
+    uint64_t allocated = 0;
+    for (uint32_t i = 0; i < 20000; ++i) {
+        if (buffers.empty() || (rand() % 3) != 0) {
+            uint64_t size = 1 + ((rand() % 4) ? (rand() % 512) : (rand() % 65536));
+            uint64_t addr;
+            RT_CHECK(allocator->allocate(size, &addr));
+            RT_ASSERT(0 == (addr % blockAlign));
+            buffers.push_back({addr, size});
+            allocated += (size + blockAlign - 1) & ~uint64_t(blockAlign - 1);
+        } else {
+            uint32_t index = rand() % buffers.size();
+            auto buffer = buffers[index];
+            buffers[index] = buffers.back();
+            buffers.pop_back();
+            RT_CHECK(allocator->release(buffer.addr));
+            allocated -= (buffer.size + blockAlign - 1) & ~uint64_t(blockAlign - 1);
+        }
+        RT_ASSERT(allocator->allocated() == allocated);
+    }
+
+    // live buffers must not overlap
+    std::map<uint64_t, uint64_t> ranges;
+    for (auto& buffer : buffers) {
+        ranges[buffer.addr] = buffer.size;
+    }
+    uint64_t end = 0;
+    for (auto& range : ranges) {
+        RT_ASSERT(range.first >= end);
+        end = range.first + range.second;
+    }
+
+    for (auto& buffer : buffers) {
+        RT_CHECK(allocator->release(buffer.addr));
+    }
+    RT_ASSERT(allocator->allocated() == 0);
+
+    delete allocator;
+
+    return 0;
+}
+
+static int bench_throughput() {
+    auto allocator = new vortex::MemoryAllocator(
+        minAddress, maxAddress, pageAlign, blockAlign
+    );
+
+    std::vector<uint64_t> addrs(benchAllocs);
+
+    auto t0 = std::chrono::high_resolution_clock::now();
+
+    // many small live buffers, as created by OpenCL applications
+    for (uint32_t i = 0; i < benchAllocs; ++i) {
+        RT_CHECK(allocator->allocate(64 + (i % 16) * 64, &addrs[i]));
+    }
+    // release every other buffer, then refill the holes
+    for (uint32_t i = 0; i < benchAllocs; i += 2) {
+        RT_CHECK(allocator->release(addrs[i]));
+    }
+    for (uint32_t i = 0; i < benchAllocs; i += 2) {
+        RT_CHECK(allocator->allocate(64, &addrs[i]));
+    }
+    for (uint32_t i = 0; i < benchAllocs; ++i) {
+        RT_CHECK(allocator->release(addrs[i]));
+    }
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+
+    RT_ASSERT(allocator->allocated() == 0);
+
     delete allocator;
 
+    uint64_t num_ops = 3 * uint64_t(benchAllocs);
+    double elapsed = std::chrono::duration<double>(t1 - t0).count();
+    printf("throughput: %lu ops in %.3f ms (%.2f Mops/s)\n",
+        num_ops, elapsed * 1000, (num_ops / elapsed) / 1e6);
+
+    return 0;
+}
+
+static int bench_placement() {
+    auto allocator = new vortex::MemoryAllocator(
+        minAddress, maxAddress, pageAlign, blockAlign
+    );
+
+    std::vector<uint64_t> addrs(benchAllocs);
+
+    // leave a page-sized hole after every other page
+    for (uint32_t i = 0; i < benchAllocs; ++i) {
+        RT_CHECK(allocator->allocate(pageAlign, &addrs[i]));
+    }
+    for (uint32_t i = 0; i < benchAllocs; i += 2) {
+        RT_CHECK(allocator->release(addrs[i]));
+    }
+
+    auto t0 = std::chrono::high_resolution_clock::now();
+
+    // larger pages fit none of the holes
+    uint64_t end = addrs[benchAllocs - 1] + pageAlign;
+    for (uint32_t i = 0; i < benchAllocs; i += 2) {
+        RT_CHECK(allocator->allocate(2 * pageAlign, &addrs[i]));
+        RT_ASSERT(addrs[i] == end);
+        end += 2 * pageAlign;
+    }
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+
+    for (uint32_t i = 0; i < benchAllocs; ++i) {
+        RT_CHECK(allocator->release(addrs[i]));
+    }
+    RT_ASSERT(allocator->allocated() == 0);
+
+    delete allocator;
+
+    uint64_t num_ops = (benchAllocs + 1) / 2;
+    double elapsed = std::chrono::duration<double>(t1 - t0).count();
+    printf("placement: %lu pages past %lu holes in %.3f ms (%.2f Mops/s)\n",
+        num_ops, num_ops, elapsed * 1000, (num_ops / elapsed) / 1e6);
+
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1) {
+        benchAllocs = atoi(argv[1]);
+    }
+
+    RT_CHECK(test_basic());
+    RT_CHECK(test_reserve());
+    RT_CHECK(test_placement());
+    RT_CHECK(test_random());
+    RT_CHECK(bench_throughput());
+    RT_CHECK(bench_placement());
+
     printf("PASSED!\n");
 
     return 0;
-}
\ No newline at end of file
+}